@@ -0,0 +1,108 @@
+// Timings for the parts of File that are meant to be fast, kept apart from
+// the unit tests so those only pass or fail. Run UnitTest with "bench".
+// All of the times are wall-clock.
+
+#include "File_Wrapper.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#define flags(f) static_cast<File::Mode>(f)
+
+namespace
+{
+  typedef std::chrono::steady_clock Clock;
+
+  double SecondsSince(Clock::time_point start)
+  {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+  }
+
+  // Counting a pattern in a file large enough to be searched on every core.
+  void CountEverywhere()
+  {
+    File::File large("bench_count.txt", flags(File::MODE_WRITE | File::MODE_CREATE | File::MODE_CLEAR));
+    std::vector<char> block(1024 * 1024, 'x');
+    for(size_t i = 0; i < block.size(); i += 4093)
+      std::memcpy(&block[i], "ab", 2);
+    for(int i = 0; i < 10; ++i)
+      large.Write(&block[0], block.size() - 1);
+
+    const Clock::time_point start = Clock::now();
+    const File::Position count = large.Count("xab");
+    std::printf("Count: %u matches in 10 MB in %.3fs\n", static_cast<unsigned>(count), SecondsSince(start));
+
+    large.Close(false);
+    std::remove("bench_count.txt");
+  }
+
+  // Lots of small writes, the way reports get written.
+  void FormatRows()
+  {
+    File::File report("bench_format.txt", flags(File::MODE_WRITE | File::MODE_CREATE | File::MODE_CLEAR));
+
+    const Clock::time_point start = Clock::now();
+    for(unsigned i = 0; i < 100000; ++i)
+      report.Format("row ", i, ": ", i * 0.5, '\n');
+    std::printf("Format: 100000 rows in %.3fs\n", SecondsSince(start));
+
+    report.Close(false);
+    std::remove("bench_format.txt");
+  }
+
+  // Whole blocks of numbers read back in at once.
+  void ReadNumbers()
+  {
+    File::File numbers("bench_numbers.txt", flags(File::MODE_WRITE | File::MODE_CREATE | File::MODE_CLEAR));
+    for(int i = 0; i < 200000; ++i)
+      numbers.Format(i * 37 - 1000000, i % 10 ? ' ' : '\n');
+    numbers.Close();
+
+    std::vector<int> values(200000);
+    File::File inMemory("bench_numbers.txt", flags(File::MODE_READ | File::MODE_TEXT));
+
+    const Clock::time_point start = Clock::now();
+    const File::Position read = inMemory.ReadInts(&values[0], values.size());
+    std::printf("ReadInts: %u numbers in %.3fs\n", static_cast<unsigned>(read), SecondsSince(start));
+
+    inMemory.Close();
+    std::remove("bench_numbers.txt");
+  }
+
+  // Inserts close together in a large file, and filling in placeholders,
+  // which only move what's between one edit and the next.
+  void EditInPlace()
+  {
+    File::File large("bench_edit.txt", flags(File::MODE_WRITE | File::MODE_CREATE | File::MODE_CLEAR));
+    std::vector<char> block(8 * 1024 * 1024, '.');
+    large.Write(&block[0], block.size());
+
+    Clock::time_point start = Clock::now();
+    for(unsigned i = 0; i < 100000; ++i)
+      large.Insert(1024 * 1024 + (i % 64) * 16, "{{name}}", 8);
+    std::printf("Insert: 100000 inserts into 8 MB in %.3fs\n", SecondsSince(start));
+
+    large.SetPos(0);
+    unsigned replaced = 0;
+    start = Clock::now();
+    for(File::Position at; replaced < 2000 && (at = large.FindNext("{{name}}")) != File::NotFound; ++replaced)
+    {
+      large.Erase(at, 8);
+      large.Insert(at, "Bob", 3);
+    }
+    std::printf("Replace: %u placeholders in %.3fs\n", replaced, SecondsSince(start));
+
+    large.Close(false);
+    std::remove("bench_edit.txt");
+  }
+}
+
+void RunBenchmarks(void)
+{
+  CountEverywhere();
+  FormatRows();
+  ReadNumbers();
+  EditInPlace();
+}
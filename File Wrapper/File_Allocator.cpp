@@ -0,0 +1,282 @@
+#include "File_Allocator.h"
+#include "File_ErrorCodes.h"
+
+#include <mutex>
+#include <new>
+
+namespace File
+{
+  namespace
+  {
+    // The smallest and largest blocks PoolAllocator keeps, as powers of two.
+    const unsigned SmallestClass = 6;  // 64 bytes
+    const unsigned LargestClass  = 22; // 4 MB
+
+    // ArenaAllocator hands out memory on this boundary.
+    const std::size_t ArenaAlignment = 16;
+
+    char* NewBlock(std::size_t size)
+    {
+      try
+      {
+        return new char[size];
+      }
+      catch ( std::bad_alloc )
+      {
+        throw File_Exception(E_OUTOFMEMORY);
+      }
+    }
+
+    // Made under call_once, the same as ThreadPool::Default.
+    std::once_flag DefaultOnce;
+    Allocator*     DefaultAllocator = NULL;
+  }
+
+  Allocator::~Allocator()
+  {
+  }
+
+  void Allocator::Trim()
+  {
+  }
+
+  Allocator& Allocator::Default()
+  {
+    std::call_once(DefaultOnce, []()
+    {
+      static PoolAllocator pool;
+      DefaultAllocator = &pool;
+    });
+
+    return *DefaultAllocator;
+  }
+
+  char* NewAllocator::Allocate(std::size_t size)
+  {
+    return NewBlock(size);
+  }
+
+  void NewAllocator::Free(char* memory, std::size_t)
+  {
+    delete [] memory;
+  }
+
+  struct PoolAllocator::Lists
+  {
+    // Unused blocks are chained together through their first bytes.
+    struct FreeBlock
+    {
+      FreeBlock* next;
+    };
+
+    std::mutex              lock;
+    std::vector<FreeBlock*> free;   // The unused blocks of each size class.
+    std::size_t             cached; // How many bytes are in free.
+  };
+
+  PoolAllocator::PoolAllocator(std::size_t maxCached) : lists_(NULL), maxCached_(maxCached)
+  {
+    try
+    {
+      lists_ = new Lists;
+      lists_->free.resize(Classes(), NULL);
+      lists_->cached = 0;
+    }
+    catch ( std::bad_alloc )
+    {
+      delete lists_;
+      throw File_Exception(E_OUTOFMEMORY);
+    }
+  }
+
+  PoolAllocator::~PoolAllocator()
+  {
+    Trim();
+    delete lists_;
+  }
+
+  unsigned PoolAllocator::Classes()
+  {
+    return LargestClass - SmallestClass + 1;
+  }
+
+  unsigned PoolAllocator::ClassOf(std::size_t size)
+  {
+    unsigned sizeClass = 0;
+
+    while(sizeClass < Classes() && (static_cast<std::size_t>(1) << (sizeClass + SmallestClass)) < size)
+      ++sizeClass;
+
+    return sizeClass;
+  }
+
+  char* PoolAllocator::Allocate(std::size_t size)
+  {
+    const unsigned sizeClass = ClassOf(size);
+
+    // Too large to pool.
+    if(sizeClass == Classes())
+      return NewBlock(size);
+
+    {
+      std::lock_guard<std::mutex> guard(lists_->lock);
+
+      Lists::FreeBlock* block = lists_->free[sizeClass];
+
+      if(block != NULL)
+      {
+        lists_->free[sizeClass] = block->next;
+        lists_->cached         -= static_cast<std::size_t>(1) << (sizeClass + SmallestClass);
+        return reinterpret_cast<char*>(block);
+      }
+    }
+
+    // Nothing to reuse. Allocate the whole class size, so the block can be
+    // handed out for anything else in the class later.
+    return NewBlock(static_cast<std::size_t>(1) << (sizeClass + SmallestClass));
+  }
+
+  void PoolAllocator::Free(char* memory, std::size_t size)
+  {
+    if(memory == NULL)
+      return;
+
+    const unsigned sizeClass = ClassOf(size);
+
+    if(sizeClass != Classes())
+    {
+      const std::size_t classSize = static_cast<std::size_t>(1) << (sizeClass + SmallestClass);
+
+      std::lock_guard<std::mutex> guard(lists_->lock);
+
+      if(lists_->cached + classSize <= maxCached_)
+      {
+        Lists::FreeBlock* block = reinterpret_cast<Lists::FreeBlock*>(memory);
+        block->next             = lists_->free[sizeClass];
+        lists_->free[sizeClass] = block;
+        lists_->cached         += classSize;
+        return;
+      }
+    }
+
+    delete [] memory;
+  }
+
+  void PoolAllocator::Trim()
+  {
+    std::lock_guard<std::mutex> guard(lists_->lock);
+
+    for(unsigned sizeClass = 0; sizeClass < Classes(); ++sizeClass)
+    {
+      while(lists_->free[sizeClass] != NULL)
+      {
+        Lists::FreeBlock* block = lists_->free[sizeClass];
+        lists_->free[sizeClass] = block->next;
+        delete [] reinterpret_cast<char*>(block);
+      }
+    }
+
+    lists_->cached = 0;
+  }
+
+  std::size_t PoolAllocator::Cached() const
+  {
+    std::lock_guard<std::mutex> guard(lists_->lock);
+    return lists_->cached;
+  }
+
+  ArenaAllocator::ArenaAllocator(std::size_t blockSize) : blockSize_(blockSize), next_(0), used_(0)
+  {
+  }
+
+  ArenaAllocator::~ArenaAllocator()
+  {
+    for(std::size_t i = 0; i < blocks_.size(); ++i)
+      delete [] blocks_[i].memory;
+  }
+
+  char* ArenaAllocator::Allocate(std::size_t size)
+  {
+    // Keep everything handed out aligned.
+    const std::size_t rounded = (size + ArenaAlignment - 1) & ~(ArenaAlignment - 1);
+
+    if(rounded < size)
+      throw File_Exception(E_OUTOFMEMORY);
+
+    // Make room for the new block up front, so a failure can't lose it.
+    try
+    {
+      blocks_.reserve(blocks_.size() + 1);
+    }
+    catch ( std::bad_alloc )
+    {
+      throw File_Exception(E_OUTOFMEMORY);
+    }
+
+    // Something too large for a block gets one of its own, slotted in before
+    // the block that's being handed out from.
+    if(rounded > blockSize_)
+    {
+      Block block = {NewBlock(rounded), rounded};
+      blocks_.insert(blocks_.end() - (blocks_.empty() ? 0 : 1), block);
+      used_ += rounded;
+      return block.memory;
+    }
+
+    // Start a new block when the current one is full.
+    if(blocks_.empty() || blocks_.back().size - next_ < rounded)
+    {
+      Block block = {NewBlock(blockSize_), blockSize_};
+      blocks_.push_back(block);
+      next_ = 0;
+    }
+
+    char* memory = &blocks_.back().memory[next_];
+    next_ += rounded;
+    used_ += rounded;
+    return memory;
+  }
+
+  void ArenaAllocator::Free(char* memory, std::size_t size)
+  {
+    if(memory == NULL || blocks_.empty())
+      return;
+
+    const std::size_t rounded = (size + ArenaAlignment - 1) & ~(ArenaAlignment - 1);
+
+    // Freeing the last thing handed out (like a buffer that was just grown
+    // out of) can hand the same memory out again.
+    if(rounded <= next_ && memory == &blocks_.back().memory[next_ - rounded])
+    {
+      next_ -= rounded;
+      used_ -= rounded;
+    }
+  }
+
+  void ArenaAllocator::Reset()
+  {
+    // Keep one regular block, so the next batch doesn't start from nothing.
+    Block keep = {NULL, 0};
+
+    for(std::size_t i = 0; i < blocks_.size(); ++i)
+    {
+      if(keep.memory == NULL && blocks_[i].size == blockSize_)
+        keep = blocks_[i];
+      else
+        delete [] blocks_[i].memory;
+    }
+
+    blocks_.clear();
+
+    if(keep.memory != NULL)
+      blocks_.push_back(keep);
+
+    next_ = 0;
+    used_ = 0;
+  }
+
+  std::size_t ArenaAllocator::Used() const
+  {
+    return used_;
+  }
+}
\ No newline at end of file
@@ -0,0 +1,142 @@
+/* File_Allocator.h
+ * Purpose: Let the memory for File buffers and filenames come from
+ * somewhere other than new[], so it can be recycled between opens.
+ */
+
+#ifndef FILE_ALLOCATOR_H
+#define FILE_ALLOCATOR_H
+
+#include "File_Exception.h"
+
+#include <cstddef>
+#include <vector>
+
+namespace File
+{
+  // Where a File gets the memory for its buffer and filename from. Pass one
+  // to the File constructor. Files copied from that File use it too. It has
+  // to outlive every File (and copy of a File) using it.
+  class Allocator
+  {
+  public:
+    virtual ~Allocator() throw();
+
+    /* Gets a block of memory.
+     *
+     * size: How many bytes are needed.
+     *
+     * Throws: E_OUTOFMEMORY - There's no memory left.
+     */
+    virtual char* Allocate(std::size_t size) throw(File_Exception) = 0;
+
+    /* Gives back a block of memory.
+     *
+     * memory: What Allocate returned.
+     * size: The size that was passed to Allocate.
+     */
+    virtual void Free(char* memory, std::size_t size) throw() = 0;
+
+    /* Gives back to the system any memory being kept around for reuse.
+     * Does nothing unless the allocator keeps memory around.
+     */
+    virtual void Trim() throw();
+
+    /* The allocator Files use unless told otherwise. A PoolAllocator, so
+     * opening and closing lots of small files doesn't keep going to new[].
+     */
+    static Allocator& Default() throw();
+  };
+
+  // Plain new[] and delete[]. Nothing is kept around.
+  class NewAllocator : public Allocator
+  {
+  public:
+    char* Allocate(std::size_t size) throw(File_Exception);
+    void Free(char* memory, std::size_t size) throw();
+  };
+
+  // Keeps freed blocks around in size classes (powers of two) and hands them
+  // out again, so a File that's opened and closed over and over only really
+  // allocates the first time. Blocks too large to be worth keeping go
+  // straight to new[] and delete[]. Safe to use from several threads.
+  class PoolAllocator : public Allocator
+  {
+  public:
+    /* maxCached: The most memory to keep around unused. Anything freed past
+     *            that is given back to the system.
+     */
+    explicit PoolAllocator(std::size_t maxCached = 64 * 1024 * 1024) throw(File_Exception);
+    ~PoolAllocator() throw();
+
+    char* Allocate(std::size_t size) throw(File_Exception);
+    void Free(char* memory, std::size_t size) throw();
+
+    /* Gives every unused block back to the system.
+     */
+    void Trim() throw();
+
+    /* How much memory is being kept around unused.
+     */
+    std::size_t Cached() const throw();
+
+  private:
+    PoolAllocator(const PoolAllocator&);
+    PoolAllocator& operator=(const PoolAllocator&);
+
+    // Which size class a block of size bytes goes in. Classes() if it's too large to pool.
+    static unsigned ClassOf(std::size_t size) throw();
+    static unsigned Classes() throw();
+
+    // The unused blocks and the lock guarding them. Kept in the .cpp, along
+    // with <mutex>.
+    struct Lists;
+    Lists* lists_;
+
+    std::size_t maxCached_; // The most memory to keep in lists_.
+  };
+
+  // Hands out memory from large blocks, one after another, and only gives
+  // it all back at once (see: Reset). Good for a batch of files that are
+  // all closed before the next batch starts. Not safe to use from several
+  // threads, so don't hand copies of Files using it to other threads.
+  class ArenaAllocator : public Allocator
+  {
+  public:
+    /* blockSize: How much memory to get from the system at a time. Anything
+     *            larger gets a block of its own.
+     */
+    explicit ArenaAllocator(std::size_t blockSize = 1024 * 1024) throw();
+    ~ArenaAllocator() throw();
+
+    char* Allocate(std::size_t size) throw(File_Exception);
+
+    // Only the most recent allocation actually gets freed. The rest waits for Reset.
+    void Free(char* memory, std::size_t size) throw();
+
+    /* Frees everything handed out so far in one go, keeping a block around
+     * for the next batch. Every File using the arena has to be closed first.
+     */
+    void Reset() throw();
+
+    /* How much memory has been handed out since the last Reset.
+     */
+    std::size_t Used() const throw();
+
+  private:
+    ArenaAllocator(const ArenaAllocator&);
+    ArenaAllocator& operator=(const ArenaAllocator&);
+
+    struct Block
+    {
+      char*       memory;
+      std::size_t size;
+    };
+
+    std::vector<Block> blocks_; // Every block gotten from the system. The last one is being handed out from.
+    std::size_t blockSize_;     // How large a block normally is.
+    std::size_t next_;          // Where in the last block the next allocation goes.
+    std::size_t used_;          // How much has been handed out since the last Reset.
+  };
+}
+
+#endif
\ No newline at end of file
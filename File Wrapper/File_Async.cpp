@@ -0,0 +1,676 @@
+#include "File_Async.h"
+#include "File_ErrorCodes.h"
+#include "File_ThreadPool.h"
+
+#include <algorithm>
+#include <cstring>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// On Linux, files are read in through io_uring when the kernel has it. It's
+// set up with system calls directly, so liburing isn't needed.
+#ifdef __linux__
+  #include <sys/syscall.h>
+
+  #ifdef __NR_io_uring_setup
+    #define FILE_IO_URING
+
+    #include <linux/io_uring.h>
+    #include <sys/mman.h>
+    #include <sys/uio.h>
+    #include <unistd.h>
+    #include <cerrno>
+  #endif
+#endif
+
+namespace File
+{
+  namespace
+  {
+    // Threads spend most of their time waiting on the disk, so there are more
+    // of them than cores, to keep a few requests going at once.
+    const unsigned ThreadsPerCore = 2;
+    const unsigned MinThreads     = 4;
+
+    // Made under call_once, the same as ThreadPool::Default.
+    std::once_flag IOOnce;
+    ThreadPool*    IOThreads = NULL;
+
+    ThreadPool& IOPool()
+    {
+      std::call_once(IOOnce, []()
+      {
+        // Make sure the default allocator outlives the pool, since the pool
+        // finishes whatever's queued before it goes.
+        Allocator::Default();
+
+        static ThreadPool pool(std::max(std::thread::hardware_concurrency() * ThreadsPerCore, MinThreads));
+        IOThreads = &pool;
+      });
+
+      return *IOThreads;
+    }
+
+    // Opens a file on the pool, the ordinary way.
+    void OpenOnPool(std::shared_ptr<std::vector<char> > name, Mode mode, Allocator* memory, std::shared_ptr<std::promise<File> > done) throw(File_Exception)
+    {
+      IOPool().Run([name, mode, memory, done]()
+      {
+        try
+        {
+          done->set_value(File(&(*name)[0], mode, *memory));
+        }
+        catch ( ... )
+        {
+          done->set_exception(std::current_exception());
+        }
+      });
+    }
+
+    // Gives up on a file whose save failed, without trying to save it again.
+    void Abandon(File& file) throw()
+    {
+      try
+      {
+        file.Close(false);
+      }
+      catch ( File_Exception )
+      {
+      }
+    }
+
+    // Deletes a file nobody took back out of an Unsaved_Exception, without
+    // its destructor trying to save it again.
+    void Discard(File* file) throw()
+    {
+      Abandon(*file);
+      delete file;
+    }
+
+    // Hands a file whose save failed back through the future. Only if
+    // there isn't the memory to is it given up on.
+    template <typename T>
+    void GiveBack(std::promise<T>& done, const File_Exception& error, File& file) throw()
+    {
+      try
+      {
+        done.set_exception(std::make_exception_ptr(Unsaved_Exception(error, std::move(file))));
+      }
+      catch ( File_Exception )
+      {
+        Abandon(file);
+        done.set_exception(std::make_exception_ptr(error));
+      }
+    }
+  }
+
+  Unsaved_Exception::Unsaved_Exception(const File_Exception& error, File&& file) : File_Exception(error)
+  {
+    try
+    {
+      file_ = std::shared_ptr<File>(new File(std::move(file)), Discard);
+    }
+    catch ( std::bad_alloc )
+    {
+      throw File_Exception(E_OUTOFMEMORY);
+    }
+  }
+
+  File Unsaved_Exception::TakeFile()
+  {
+    return std::move(*file_);
+  }
+
+#ifdef FILE_IO_URING
+  // Reads files in for OpenAsync through io_uring, so that any number of
+  // reads are kept going at once by one thread waiting on all of them, rather
+  // than a thread each. Set up the first time it's needed, if the kernel lets
+  // it be. Anything it can't take, or that goes wrong, is opened on the pool.
+  class IORing
+  {
+  public:
+    /* The ring, set up if this is the first time.
+     *
+     * Returns: NULL if io_uring isn't there or isn't allowed.
+     */
+    static IORing* Get() throw();
+
+    /* Opens the file and starts reading it in. The File is made and handed
+     * to done once it's all read.
+     *
+     * Returns: Whether it was started. If it wasn't, nothing happened.
+     */
+    bool Open(std::shared_ptr<std::vector<char> > name, Mode mode, Allocator& allocator, std::shared_ptr<std::promise<File> > done) throw();
+
+    ~IORing() throw();
+
+  private:
+    // A file being read in.
+    struct Read
+    {
+      std::shared_ptr<std::vector<char> >  name;
+      Mode                                 mode;
+      Allocator*                           allocator;
+      std::shared_ptr<std::promise<File> > done;
+
+      int      file;   // The file, open.
+      Buffer*  buffer; // Where it's read into. As large as the file was.
+      Position read;   // How much of it is in so far.
+      iovec    part;   // Where the read going on now goes. The kernel can read it any time until it's done.
+    };
+
+    // How many requests the ring holds. One is kept for the request that stops it.
+    static const unsigned Entries = 64;
+
+    IORing() throw();
+
+    // Maps the ring and starts the thread reaping it. Returns false if either can't be done.
+    bool Setup() throw();
+
+    // Asks for the rest of read to be read in. Returns false if the kernel didn't take it.
+    bool Submit(Read* read) throw();
+
+    // Waits for reads to finish and finishes them off, until the ring is stopped.
+    void Reap() throw();
+
+    // Deals with a read finishing. result is what read(2) would have returned, or -errno.
+    void Completed(Read* read, int result) throw();
+
+    // Makes the File, now that it's all read in.
+    void Finish(Read* read) throw();
+
+    // Gives up on the ring for this file, and opens it on the pool instead.
+    void Fallback(Read* read) throw();
+
+    IORing(const IORing&);
+    IORing& operator=(const IORing&);
+
+    int ring_; // The ring. -1 if there isn't one.
+
+    void*    sqRing_;   // The submission queue.
+    size_t   sqSize_;
+    unsigned* sqHead_;
+    unsigned* sqTail_;
+    unsigned* sqMask_;
+    unsigned* sqArray_;
+    io_uring_sqe* sqes_;
+    size_t   sqesSize_;
+
+    void*    cqRing_;   // The completion queue. The same mapping as the submission queue on newer kernels.
+    size_t   cqSize_;
+    unsigned* cqHead_;
+    unsigned* cqTail_;
+    unsigned* cqMask_;
+    io_uring_cqe* cqes_;
+
+    std::mutex  lock_;     // Held while submitting, and while changing inFlight_.
+    unsigned    inFlight_; // How many requests are in the ring.
+    std::thread reaper_;
+  };
+
+  namespace
+  {
+    int Enter(int ring, unsigned toSubmit, unsigned minComplete, unsigned flags)
+    {
+      return static_cast<int>(syscall(__NR_io_uring_enter, ring, toSubmit, minComplete, flags, NULL, 0));
+    }
+
+    std::once_flag RingOnce;
+    IORing*        Ring = NULL;
+  }
+
+  IORing* IORing::Get()
+  {
+    std::call_once(RingOnce, []()
+    {
+      // Files the ring gives up on are opened on the pool, so the pool has
+      // to outlive it. Made first, it's destroyed last.
+      IOPool();
+
+      static IORing ring;
+
+      if(ring.ring_ >= 0)
+        Ring = &ring;
+    });
+
+    return Ring;
+  }
+
+  IORing::IORing() : ring_(-1), sqRing_(MAP_FAILED), sqSize_(0), sqes_(static_cast<io_uring_sqe*>(MAP_FAILED)), sqesSize_(0),
+                     cqRing_(MAP_FAILED), cqSize_(0), inFlight_(0)
+  {
+    if(!Setup() && ring_ >= 0)
+    {
+      // Tidy up whatever did get set up.
+      if(sqes_ != MAP_FAILED)
+        munmap(sqes_, sqesSize_);
+      if(cqRing_ != MAP_FAILED && cqRing_ != sqRing_)
+        munmap(cqRing_, cqSize_);
+      if(sqRing_ != MAP_FAILED)
+        munmap(sqRing_, sqSize_);
+
+      close(ring_);
+      ring_ = -1;
+    }
+  }
+
+  IORing::~IORing()
+  {
+    if(ring_ < 0)
+      return;
+
+    // A request that reads nothing tells the reaper to stop, once everything before it is done.
+    {
+      std::lock_guard<std::mutex> locked(lock_);
+
+      const unsigned tail  = *sqTail_;
+      const unsigned index = tail & *sqMask_;
+
+      std::memset(&sqes_[index], 0, sizeof(io_uring_sqe));
+      sqes_[index].opcode = IORING_OP_NOP;
+      sqArray_[index] = index;
+
+      __atomic_store_n(sqTail_, tail + 1, __ATOMIC_RELEASE);
+
+      while(Enter(ring_, 1, 0, 0) < 0 && errno == EINTR)
+        ;
+    }
+
+    reaper_.join();
+
+    munmap(sqes_, sqesSize_);
+    if(cqRing_ != sqRing_)
+      munmap(cqRing_, cqSize_);
+    munmap(sqRing_, sqSize_);
+    close(ring_);
+  }
+
+  bool IORing::Setup()
+  {
+    io_uring_params params;
+    std::memset(&params, 0, sizeof(params));
+
+    // Fails with ENOSYS before Linux 5.1, and EPERM where it's been turned off.
+    ring_ = static_cast<int>(syscall(__NR_io_uring_setup, Entries, &params));
+
+    if(ring_ < 0)
+      return false;
+
+    sqSize_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cqSize_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+
+    // Newer kernels put both queues in the one mapping.
+    const bool single = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+
+    if(single)
+      sqSize_ = cqSize_ = std::max(sqSize_, cqSize_);
+
+    sqRing_ = mmap(NULL, sqSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_, IORING_OFF_SQ_RING);
+
+    if(sqRing_ == MAP_FAILED)
+      return false;
+
+    cqRing_ = (single ? sqRing_ : mmap(NULL, cqSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_, IORING_OFF_CQ_RING));
+
+    if(cqRing_ == MAP_FAILED)
+      return false;
+
+    sqesSize_ = params.sq_entries * sizeof(io_uring_sqe);
+    sqes_     = static_cast<io_uring_sqe*>(mmap(NULL, sqesSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_, IORING_OFF_SQES));
+
+    if(sqes_ == MAP_FAILED)
+      return false;
+
+    char* sq = static_cast<char*>(sqRing_);
+    char* cq = static_cast<char*>(cqRing_);
+
+    sqHead_  = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+    sqTail_  = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+    sqMask_  = reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+    sqArray_ = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+    cqHead_  = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+    cqTail_  = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+    cqMask_  = reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+    cqes_    = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+
+    try
+    {
+      reaper_ = std::thread(&IORing::Reap, this);
+    }
+    catch ( std::exception )
+    {
+      return false;
+    }
+
+    return true;
+  }
+
+  bool IORing::Open(std::shared_ptr<std::vector<char> > name, Mode mode, Allocator& allocator, std::shared_ptr<std::promise<File> > done)
+  {
+    // Anything that goes wrong here goes wrong again on the pool, where it's
+    // reported properly. Opened for writing, the same as Open does.
+    Platform::Handle file = Platform::InvalidHandle;
+    Buffer* buffer = NULL;
+    Read* read = NULL;
+
+    try
+    {
+      file = Platform::OpenFile(&(*name)[0], true, (mode & MODE_CREATE) != 0);
+
+      // An empty file has nothing to read.
+      const Position size = Platform::FileSize(file);
+
+      if(size > 0)
+      {
+        buffer = Buffer::Allocate(size, allocator);
+
+        read = new Read;
+        read->name      = name;
+        read->mode      = mode;
+        read->allocator = &allocator;
+        read->done      = done;
+        read->file      = static_cast<int>(file);
+        read->buffer    = buffer;
+        read->read      = 0;
+      }
+    }
+    catch ( File_Exception )
+    {
+    }
+    catch ( std::bad_alloc )
+    {
+    }
+
+    // Keep one slot back for stopping.
+    bool reserved = false;
+
+    if(read != NULL)
+    {
+      std::lock_guard<std::mutex> locked(lock_);
+
+      reserved = (inFlight_ + 1 < Entries);
+      inFlight_ += (reserved ? 1 : 0);
+    }
+
+    if(reserved && Submit(read))
+      return true;
+
+    if(reserved)
+    {
+      std::lock_guard<std::mutex> locked(lock_);
+      --inFlight_;
+    }
+
+    delete read;
+
+    if(buffer != NULL)
+      buffer->Release();
+
+    Platform::CloseFile(file);
+    return false;
+  }
+
+  bool IORing::Submit(Read* read)
+  {
+    read->part.iov_base = read->buffer->Data() + read->read;
+    read->part.iov_len  = static_cast<size_t>(read->buffer->Size() - read->read);
+
+    std::lock_guard<std::mutex> locked(lock_);
+
+    // Only ever submitted to under the lock, so nobody else moves the tail.
+    const unsigned tail  = *sqTail_;
+    const unsigned index = tail & *sqMask_;
+    io_uring_sqe& request = sqes_[index];
+
+    std::memset(&request, 0, sizeof(request));
+    request.opcode    = IORING_OP_READV;
+    request.fd        = read->file;
+    request.addr      = reinterpret_cast<unsigned long long>(&read->part);
+    request.len       = 1;
+    request.off       = read->read;
+    request.user_data = reinterpret_cast<unsigned long long>(read);
+    sqArray_[index]   = index;
+
+    __atomic_store_n(sqTail_, tail + 1, __ATOMIC_RELEASE);
+
+    int submitted;
+    while((submitted = Enter(ring_, 1, 0, 0)) < 0 && errno == EINTR)
+      ;
+
+    // The kernel only takes requests while it's entered, so one it didn't
+    // take can be taken back.
+    if(submitted < 1)
+    {
+      __atomic_store_n(sqTail_, tail, __ATOMIC_RELEASE);
+      return false;
+    }
+
+    return true;
+  }
+
+  void IORing::Reap()
+  {
+    bool stopping = false;
+
+    for(;;)
+    {
+      {
+        std::lock_guard<std::mutex> locked(lock_);
+
+        if(stopping && inFlight_ == 0)
+          return;
+      }
+
+      Enter(ring_, 0, 1, IORING_ENTER_GETEVENTS);
+
+      // Only this thread takes completions, so only it moves the head.
+      unsigned head = *cqHead_;
+      const unsigned tail = __atomic_load_n(cqTail_, __ATOMIC_ACQUIRE);
+
+      for(; head != tail; ++head)
+      {
+        const io_uring_cqe& completion = cqes_[head & *cqMask_];
+        Read* read = reinterpret_cast<Read*>(completion.user_data);
+        const int result = completion.res;
+
+        // Give the slot back before anything is resubmitted.
+        __atomic_store_n(cqHead_, head + 1, __ATOMIC_RELEASE);
+
+        if(read == NULL)
+          stopping = true;
+        else
+          Completed(read, result);
+      }
+    }
+  }
+
+  void IORing::Completed(Read* read, int result)
+  {
+    if(result < 0)
+    {
+      Fallback(read);
+      return;
+    }
+
+    read->read += result;
+
+    // Reads can come up short. Ask for the rest, unless the file got shorter.
+    if(result > 0 && read->read < read->buffer->Size())
+    {
+      if(!Submit(read))
+        Fallback(read);
+
+      return;
+    }
+
+    Finish(read);
+  }
+
+  void IORing::Finish(Read* read)
+  {
+    {
+      std::lock_guard<std::mutex> locked(lock_);
+      --inFlight_;
+    }
+
+    close(read->file);
+
+    try
+    {
+      read->done->set_value(File(&(*read->name)[0], read->mode, *read->allocator, read->buffer, read->read));
+    }
+    catch ( ... )
+    {
+      read->done->set_exception(std::current_exception());
+    }
+
+    delete read;
+  }
+
+  void IORing::Fallback(Read* read)
+  {
+    {
+      std::lock_guard<std::mutex> locked(lock_);
+      --inFlight_;
+    }
+
+    close(read->file);
+    read->buffer->Release();
+
+    try
+    {
+      OpenOnPool(read->name, read->mode, read->allocator, read->done);
+    }
+    catch ( ... )
+    {
+      read->done->set_exception(std::current_exception());
+    }
+
+    delete read;
+  }
+#endif
+
+  std::future<File> OpenAsync(const char* filename, Mode mode, Allocator& allocator)
+  {
+    try
+    {
+      // The task outlives the caller's filename. It holds everything it needs itself.
+      std::shared_ptr<std::vector<char> > name = std::make_shared<std::vector<char> >(filename, filename + std::strlen(filename) + 1);
+      std::shared_ptr<std::promise<File> > done = std::make_shared<std::promise<File> >();
+      std::future<File> result = done->get_future();
+
+#ifdef FILE_IO_URING
+      // Only files read into memory whole go through the ring.
+      if(!(mode & (MODE_MMAP | MODE_STREAM | MODE_PIECES | MODE_COMPRESSED | MODE_CLEAR | MODE_SAME)))
+      {
+        IORing* ring = IORing::Get();
+
+        if(ring != NULL && ring->Open(name, mode, allocator, done))
+          return result;
+      }
+#endif
+
+      OpenOnPool(name, mode, &allocator, done);
+      return result;
+    }
+    catch ( std::bad_alloc )
+    {
+      throw File_Exception(E_OUTOFMEMORY);
+    }
+  }
+
+  std::future<File> FlushAsync(File&& file)
+  {
+    try
+    {
+      std::shared_ptr<std::promise<File> > done = std::make_shared<std::promise<File> >();
+      std::future<File> result = done->get_future();
+
+      // Take the file last. If queueing it up fails, it's given back.
+      std::shared_ptr<File> taken = std::make_shared<File>(std::move(file));
+
+      try
+      {
+        IOPool().Run([taken, done]()
+        {
+          try
+          {
+            taken->Flush();
+            done->set_value(std::move(*taken));
+          }
+          catch ( File_Exception error )
+          {
+            GiveBack(*done, error, *taken);
+          }
+          catch ( ... )
+          {
+            Abandon(*taken);
+            done->set_exception(std::current_exception());
+          }
+        });
+      }
+      catch ( File_Exception )
+      {
+        // Never got going. Give the file back as it was.
+        file = std::move(*taken);
+        throw;
+      }
+
+      return result;
+    }
+    catch ( std::bad_alloc )
+    {
+      throw File_Exception(E_OUTOFMEMORY);
+    }
+  }
+
+  std::future<void> CloseAsync(File&& file, bool save)
+  {
+    try
+    {
+      std::shared_ptr<std::promise<void> > done = std::make_shared<std::promise<void> >();
+      std::future<void> result = done->get_future();
+
+      // Take the file last. If queueing it up fails, it's given back.
+      std::shared_ptr<File> taken = std::make_shared<File>(std::move(file));
+
+      try
+      {
+        IOPool().Run([taken, save, done]()
+        {
+          try
+          {
+            taken->Close(save);
+            done->set_value();
+          }
+          catch ( File_Exception error )
+          {
+            GiveBack(*done, error, *taken);
+          }
+          catch ( ... )
+          {
+            Abandon(*taken);
+            done->set_exception(std::current_exception());
+          }
+        });
+      }
+      catch ( File_Exception )
+      {
+        // Never got going. Give the file back as it was.
+        file = std::move(*taken);
+        throw;
+      }
+
+      return result;
+    }
+    catch ( std::bad_alloc )
+    {
+      throw File_Exception(E_OUTOFMEMORY);
+    }
+  }
+}
\ No newline at end of file
@@ -0,0 +1,76 @@
+/* File_Async.h
+ * Purpose: Open, save and close files in the background, so the thread
+ * asking for it can get on with something else.
+ */
+
+#ifndef FILE_ASYNC_H
+#define FILE_ASYNC_H
+
+#include "File_Wrapper.h"
+
+#include <future>
+#include <memory>
+
+namespace File
+{
+  // Each of these hands the File over to a pool of threads kept for file
+  // I/O, and gives back a future for when it's done. While a File is in the
+  // background, nobody else has it, so there's nothing to read or write by
+  // mistake while it's still loading: get() on the future waits for it, and
+  // throws whatever the operation threw.
+  //
+  // On Linux, files read into memory whole are read in through io_uring
+  // where the kernel has it, so one thread keeps all of the reads going at
+  // once. Everything else, and everything on other platforms, is done on
+  // the pool.
+
+  // What the futures from FlushAsync and CloseAsync throw when saving fails.
+  // The file comes back with it, edits and all, the same as a Flush or
+  // Close that throws leaves it, so the save can be tried again.
+  class Unsaved_Exception : public File_Exception
+  {
+  public:
+    Unsaved_Exception(const File_Exception& error, File&& file) throw(File_Exception);
+
+    /* Takes back the file that couldn't be saved. Only the first call gets
+     * it open; copies of the exception share the same file. If nobody takes
+     * it, it's closed without being saved.
+     */
+    File TakeFile() throw();
+
+  private:
+    std::shared_ptr<File> file_;
+  };
+
+  /* Opens a file in the background. See: File::File
+   *
+   * Returns: The open file, once it's loaded.
+   *
+   * Throws: E_OUTOFMEMORY - The open couldn't be queued up.
+   *         The future throws whatever opening the file threw.
+   */
+  std::future<File> OpenAsync(const char* filename, Mode mode = MODE_READ, Allocator& allocator = Allocator::Default()) throw(File_Exception);
+
+  /* Saves a file in the background, then hands it back. See: File::Flush
+   *
+   * file: The file to save. Left closed here until the future gives it back.
+   *
+   * Throws: E_OUTOFMEMORY - The save couldn't be queued up.
+   *         The future throws an Unsaved_Exception with whatever saving
+   *         the file threw, and the file to try again with.
+   */
+  std::future<File> FlushAsync(File&& file) throw(File_Exception);
+
+  /* Closes a file in the background. See: File::Close
+   *
+   * file: The file to close. Left closed here straight away.
+   * save: Whether to save the file before closing it.
+   *
+   * Throws: E_OUTOFMEMORY - The close couldn't be queued up.
+   *         The future throws an Unsaved_Exception with whatever saving
+   *         the file threw, and the file, still open, to try again with.
+   */
+  std::future<void> CloseAsync(File&& file, bool save = true) throw(File_Exception);
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,101 @@
+#include "File_Buffer.h"
+#include "File_ErrorCodes.h"
+#include "File_Platform.h"
+
+#include <limits>
+#include <new>
+
+namespace File
+{
+  namespace
+  {
+    // How far after the start of a Buffer its data starts. Rounded up, so
+    // the data is as well aligned as the memory it's in.
+    const std::size_t HeaderSize = (sizeof(Buffer) + 15) & ~static_cast<std::size_t>(15);
+  }
+
+  Buffer::Buffer(char* data, Position size, bool mapped, Allocator& allocator) : data_(data), size_(size), mapped_(mapped),
+                                                                                 allocator_(&allocator), references_(1)
+  {
+  }
+
+  Buffer::~Buffer()
+  {
+    if(mapped_)
+      Platform::UnmapFile(data_, size_);
+  }
+
+  std::size_t Buffer::Footprint() const
+  {
+    return (mapped_ ? HeaderSize : HeaderSize + static_cast<std::size_t>(size_));
+  }
+
+  Buffer* Buffer::Allocate(Position size, Allocator& allocator)
+  {
+    if(size > std::numeric_limits<std::size_t>::max() - HeaderSize)
+      throw File_Exception(E_FILETOOLARGE);
+
+    char* memory = allocator.Allocate(HeaderSize + static_cast<std::size_t>(size));
+    return new (memory) Buffer(memory + HeaderSize, size, false, allocator);
+  }
+
+  Buffer* Buffer::Adopt(char* mapping, Position size, Allocator& allocator)
+  {
+    char* memory;
+
+    try
+    {
+      memory = allocator.Allocate(HeaderSize);
+    }
+    catch ( File_Exception )
+    {
+      Platform::UnmapFile(mapping, size);
+      throw;
+    }
+
+    return new (memory) Buffer(mapping, size, true, allocator);
+  }
+
+  Buffer* Buffer::Share()
+  {
+    // Whoever is sharing it already holds a reference, so nothing needs ordering here.
+    references_.fetch_add(1, std::memory_order_relaxed);
+    return this;
+  }
+
+  void Buffer::Release()
+  {
+    // Make sure every other File's use of the memory is done before it's freed.
+    if(references_.fetch_sub(1, std::memory_order_acq_rel) == 1)
+    {
+      Allocator*        allocator = allocator_;
+      const std::size_t footprint = Footprint();
+      char*             memory    = reinterpret_cast<char*>(this);
+
+      this->~Buffer();
+      allocator->Free(memory, footprint);
+    }
+  }
+
+  bool Buffer::Shared() const
+  {
+    // Acquire, so that once the other Files have let go, their reads are
+    // finished before we start writing.
+    return references_.load(std::memory_order_acquire) > 1;
+  }
+
+  bool Buffer::Mapped() const
+  {
+    return mapped_;
+  }
+
+  char* Buffer::Data() const
+  {
+    return data_;
+  }
+
+  Position Buffer::Size() const
+  {
+    return size_;
+  }
+}
\ No newline at end of file
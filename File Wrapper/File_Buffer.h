@@ -0,0 +1,90 @@
+/* File_Buffer.h
+ * Purpose: Hold the contents of a file in memory, shared between copies
+ * of a File until one of them changes it.
+ */
+
+#ifndef FILE_BUFFER_H
+#define FILE_BUFFER_H
+
+#include "File_Types.h"
+#include "File_Exception.h"
+#include "File_Allocator.h"
+
+#include <atomic>
+
+namespace File
+{
+  // A reference counted block of memory holding a file, or a window of one.
+  // Copying a File just shares its Buffer. Whoever wants to change a Buffer
+  // that's shared has to make a copy of their own first (see: Shared). The
+  // memory is freed (or unmapped) when the last File using it lets go.
+  // The Buffer itself lives at the front of the memory it manages, so a
+  // buffer is just one allocation.
+  class Buffer
+  {
+  public:
+    /* Allocates a new buffer. The contents start off uninitialized.
+     *
+     * size: How large the buffer is in bytes.
+     * allocator: Where to get the memory from. It's given back there too.
+     *
+     * Throws: E_FILETOOLARGE - size doesn't fit in the address space of the process.
+     *         E_OUTOFMEMORY  - allocator ran out of memory.
+     */
+    static Buffer* Allocate(Position size, Allocator& allocator) throw(File_Exception);
+
+    /* Takes over a mapping made by Platform::MapFile. The mapping is
+     * unmapped when the buffer is freed, or right away if this throws.
+     *
+     * Throws: E_OUTOFMEMORY - allocator ran out of memory.
+     */
+    static Buffer* Adopt(char* mapping, Position size, Allocator& allocator) throw(File_Exception);
+
+    /* Starts sharing the buffer with one more File.
+     *
+     * Returns: this
+     */
+    Buffer* Share() throw();
+
+    /* Stops using the buffer. Frees it if nothing else is using it. The
+     * buffer mustn't be touched afterwards.
+     */
+    void Release() throw();
+
+    /* Whether more than one File is using the buffer, in which case it
+     * mustn't be changed. Can't go from false to true behind your back,
+     * since only the File(s) using the buffer can share it further.
+     */
+    bool Shared() const throw();
+
+    /* Whether the buffer is a read-only mapping of a file.
+     */
+    bool Mapped() const throw();
+
+    /* The memory itself, and how large it is.
+     */
+    char*    Data() const throw();
+    Position Size() const throw();
+
+  private:
+    Buffer(char* data, Position size, bool mapped, Allocator& allocator) throw();
+    ~Buffer() throw();
+
+    // How much memory the Buffer was allocated with, itself included.
+    std::size_t Footprint() const throw();
+
+    // Buffers are only ever shared, never copied.
+    Buffer(const Buffer&);
+    Buffer& operator=(const Buffer&);
+
+    char*    data_;   // The memory holding the file.
+    Position size_;   // How large data_ is.
+    bool     mapped_; // Whether data_ came from Platform::MapFile rather than right after the Buffer.
+
+    Allocator* allocator_; // Where the memory came from.
+
+    std::atomic<unsigned long> references_; // How many Files are using the buffer.
+  };
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,459 @@
+#include "File_Compress.h"
+#include "File_ErrorCodes.h"
+#include "File_Endian.h"
+#include "File_ThreadPool.h"
+
+#include <cstring>
+#include <new>
+
+namespace File
+{
+  namespace Compress
+  {
+    namespace
+    {
+      const char        Magic[4]    = {'O', 'O', 'F', 'Z'};
+      const unsigned    Version     = 1;
+      const std::size_t HeaderSize  = 32;
+      const std::size_t MinMatch    = 4;     // The shortest match worth a sequence.
+      const std::size_t MaxDistance = 65535; // The furthest back a match can be, to fit in 2 bytes.
+      const unsigned    HashBits    = 13;    // How many entries the table of earlier positions has, as a power of 2.
+
+      // How many blocks each thread packs per batch when saving.
+      const std::size_t BlocksPerThread = 4;
+
+      unsigned Load32(const char* data)
+      {
+        unsigned value;
+        std::memcpy(&value, data, sizeof(value));
+        return value;
+      }
+
+      template <typename T>
+      void Store(char* output, T value)
+      {
+        Endian::Convert<LittleEndian>(value);
+        std::memcpy(output, &value, sizeof(value));
+      }
+
+      template <typename T>
+      T Load(const char* data)
+      {
+        T value;
+        std::memcpy(&value, data, sizeof(value));
+        Endian::Convert<LittleEndian>(value);
+        return value;
+      }
+
+      // Writes out a length that didn't fit in the token: 255 for every 255
+      // of it, then whatever's left.
+      std::size_t PutLength(char* output, std::size_t length)
+      {
+        std::size_t written = 0;
+
+        for(; length >= 255; length -= 255)
+          output[written++] = static_cast<char>(255);
+
+        output[written++] = static_cast<char>(length);
+        return written;
+      }
+
+      // Reads a length written by PutLength, adding it to length.
+      bool GetLength(const unsigned char*& at, const unsigned char* end, std::size_t& length)
+      {
+        for(;;)
+        {
+          if(at == end)
+            return false;
+
+          const unsigned next = *at++;
+          length += next;
+
+          if(next != 255)
+            return true;
+        }
+      }
+
+      // Writes out one sequence: a token holding both lengths (15 meaning
+      // more follows), the literals, and then the match, unless it's the
+      // last sequence, which has none.
+      bool Sequence(char* output, std::size_t capacity, std::size_t& used, const char* literals, std::size_t literalLength, std::size_t distance, std::size_t matchLength)
+      {
+        const std::size_t worst = 1 + (literalLength / 255 + 1) + literalLength + 2 + (matchLength / 255 + 1);
+
+        if(worst > capacity - used)
+          return false;
+
+        const std::size_t token = used++;
+        output[token] = static_cast<char>((literalLength < 15 ? literalLength : 15) << 4);
+
+        if(literalLength >= 15)
+          used += PutLength(&output[used], literalLength - 15);
+
+        std::memcpy(&output[used], literals, literalLength);
+        used += literalLength;
+
+        if(matchLength == 0)
+          return true;
+
+        output[used++] = static_cast<char>(distance & 0xFF);
+        output[used++] = static_cast<char>(distance >> 8);
+
+        const std::size_t extra = matchLength - MinMatch;
+        output[token] = static_cast<char>(output[token] | (extra < 15 ? extra : 15));
+
+        if(extra >= 15)
+          used += PutLength(&output[used], extra - 15);
+
+        return true;
+      }
+    }
+
+    std::size_t Block(const char* input, std::size_t size, char* output, std::size_t capacity)
+    {
+      // Where each hash of 4 bytes was last seen, plus 1. 0 if it hasn't been.
+      unsigned seen[1 << HashBits];
+      std::memset(seen, 0, sizeof(seen));
+
+      std::size_t used   = 0;
+      std::size_t anchor = 0; // Where the literals not yet written out start.
+      std::size_t at     = 0;
+
+      while(at + MinMatch <= size)
+      {
+        const unsigned sequence = Load32(&input[at]);
+        const unsigned hash     = (sequence * 2654435761U) >> (32 - HashBits);
+        const std::size_t last  = seen[hash];
+
+        seen[hash] = static_cast<unsigned>(at + 1);
+
+        if(last == 0 || at - (last - 1) > MaxDistance || Load32(&input[last - 1]) != sequence)
+        {
+          // The longer it's been since a match, the less likely the next
+          // one is, so skip ahead faster through data that doesn't pack.
+          at += 1 + ((at - anchor) >> 6);
+          continue;
+        }
+
+        const std::size_t match = last - 1;
+        std::size_t length = MinMatch;
+
+        while(at + length < size && input[match + length] == input[at + length])
+          ++length;
+
+        if(!Sequence(output, capacity, used, &input[anchor], at - anchor, at - match, length))
+          return 0;
+
+        at    += length;
+        anchor = at;
+      }
+
+      // Whatever's left over is literals.
+      if(!Sequence(output, capacity, used, &input[anchor], size - anchor, 0, 0))
+        return 0;
+
+      return used;
+    }
+
+    bool Unblock(const char* input, std::size_t size, char* output, std::size_t outputSize)
+    {
+      const unsigned char* at  = reinterpret_cast<const unsigned char*>(input);
+      const unsigned char* end = at + size;
+      std::size_t used = 0;
+
+      while(at < end)
+      {
+        const unsigned token = *at++;
+        std::size_t literals = token >> 4;
+
+        if(literals == 15 && !GetLength(at, end, literals))
+          return false;
+
+        if(literals > static_cast<std::size_t>(end - at) || literals > outputSize - used)
+          return false;
+
+        std::memcpy(&output[used], at, literals);
+        at   += literals;
+        used += literals;
+
+        // The last sequence has no match.
+        if(at == end)
+          break;
+
+        if(end - at < 2)
+          return false;
+
+        const std::size_t distance = at[0] | (at[1] << 8);
+        at += 2;
+
+        if(distance == 0 || distance > used)
+          return false;
+
+        std::size_t length = token & 15;
+
+        if(length == 15 && !GetLength(at, end, length))
+          return false;
+
+        length += MinMatch;
+
+        if(length > outputSize - used)
+          return false;
+
+        // A match can overlap what it's copying, repeating it.
+        char*       to   = &output[used];
+        const char* from = to - distance;
+
+        if(distance >= length)
+          std::memcpy(to, from, length);
+        else
+        {
+          for(std::size_t i = 0; i < length; ++i)
+            to[i] = from[i];
+        }
+
+        used += length;
+      }
+
+      return used == outputSize;
+    }
+
+    Position Pack(Platform::Handle file, const char* data, Position size)
+    {
+      const Position blocks = (size + BlockSize - 1) / BlockSize;
+
+      // The index only has 4 bytes for the number of blocks.
+      if(blocks > 0xFFFFFFFFULL)
+        throw File_Exception(E_FILETOOLARGE);
+
+      ThreadPool& pool = ThreadPool::Default();
+      const std::size_t batch = pool.Threads() * BlocksPerThread;
+
+      std::vector<char> index;
+      std::vector<std::vector<char> > packed;
+      std::vector<Platform::Slice> slices;
+
+      try
+      {
+        index.resize(static_cast<std::size_t>(blocks) * 4);
+        packed.resize(static_cast<std::size_t>(blocks < batch ? blocks : batch));
+        slices.resize(packed.size());
+
+        for(std::size_t i = 0; i < packed.size(); ++i)
+          packed[i].resize(BlockSize);
+      }
+      catch ( std::bad_alloc )
+      {
+        throw File_Exception(E_OUTOFMEMORY);
+      }
+
+      Position written = HeaderSize;
+
+      for(Position first = 0; first < blocks; first += batch)
+      {
+        const std::size_t count = static_cast<std::size_t>(blocks - first < batch ? blocks - first : batch);
+
+        pool.ForEach(count, [&](std::size_t i)
+        {
+          const Position block = first + i;
+          const char*    raw   = &data[block * BlockSize];
+          const std::size_t rawSize = static_cast<std::size_t>(size - block * BlockSize < BlockSize ? size - block * BlockSize : BlockSize);
+
+          // Anything that doesn't come out smaller is stored as-is.
+          const std::size_t length = Block(raw, rawSize, &packed[i][0], rawSize - 1);
+
+          slices[i].data = (length != 0 ? &packed[i][0] : raw);
+          slices[i].size = (length != 0 ? length : rawSize);
+          Store(&index[static_cast<std::size_t>(block) * 4], static_cast<unsigned>(slices[i].size));
+        });
+
+        Platform::WriteGatherAt(file, &slices[0], count, written);
+
+        for(std::size_t i = 0; i < count; ++i)
+          written += slices[i].size;
+      }
+
+      char header[HeaderSize];
+      std::memcpy(header, Magic, sizeof(Magic));
+      Store(&header[4],  static_cast<unsigned>(Version));
+      Store(&header[8],  static_cast<unsigned>(BlockSize));
+      Store(&header[12], static_cast<unsigned>(blocks));
+      Store(&header[16], static_cast<unsigned long long>(size));
+      Store(&header[24], static_cast<unsigned long long>(written));
+
+      if(!index.empty())
+        Platform::WriteAt(file, &index[0], index.size(), written);
+
+      Platform::WriteAt(file, header, sizeof(header), 0);
+
+      return written + index.size();
+    }
+  }
+
+  Packed::Packed(Platform::Handle file) : file_(Platform::InvalidHandle), size_(0), blockSize_(Compress::BlockSize), remaining_(0)
+  {
+    const Position fileSize = Platform::FileSize(file);
+
+    // Nothing's been written to it yet.
+    if(fileSize == 0)
+    {
+      file_ = file;
+      return;
+    }
+
+    char header[Compress::HeaderSize];
+
+    if(fileSize < sizeof(header) || Platform::ReadAt(file, header, sizeof(header), 0) != sizeof(header))
+      throw File_Exception(E_BADFORMAT);
+
+    const unsigned           version     = Compress::Load<unsigned>(&header[4]);
+    const unsigned           blockSize   = Compress::Load<unsigned>(&header[8]);
+    const unsigned           blocks      = Compress::Load<unsigned>(&header[12]);
+    const unsigned long long size        = Compress::Load<unsigned long long>(&header[16]);
+    const unsigned long long indexOffset = Compress::Load<unsigned long long>(&header[24]);
+
+    if(std::memcmp(header, Compress::Magic, sizeof(Compress::Magic)) != 0 || version != Compress::Version || blockSize == 0 ||
+       blocks != (size + blockSize - 1) / blockSize || indexOffset < sizeof(header) || indexOffset > fileSize || (fileSize - indexOffset) / 4 < blocks)
+    {
+      throw File_Exception(E_BADFORMAT);
+    }
+
+    std::vector<char> index;
+
+    try
+    {
+      index.resize(static_cast<std::size_t>(blocks) * 4);
+      offsets_.resize(static_cast<std::size_t>(blocks) + 1);
+      unpacked_.resize(blocks);
+    }
+    catch ( std::bad_alloc )
+    {
+      throw File_Exception(E_OUTOFMEMORY);
+    }
+
+    if(!index.empty() && Platform::ReadAt(file, &index[0], index.size(), indexOffset) != index.size())
+      throw File_Exception(E_BADFORMAT);
+
+    // Every block has to fit between the header and the index, and can't
+    // be packed into more bytes than it started with.
+    offsets_[0] = Compress::HeaderSize;
+
+    for(std::size_t block = 0; block < blocks; ++block)
+    {
+      const Position length = Compress::Load<unsigned>(&index[block * 4]);
+      const Position raw    = (size - block * static_cast<Position>(blockSize) < blockSize ? size - block * static_cast<Position>(blockSize) : blockSize);
+
+      if(length == 0 || length > raw || length > indexOffset - offsets_[block])
+        throw File_Exception(E_BADFORMAT);
+
+      offsets_[block + 1] = offsets_[block] + length;
+    }
+
+    file_      = file;
+    size_      = size;
+    blockSize_ = blockSize;
+    remaining_ = blocks;
+  }
+
+  Packed::~Packed()
+  {
+    Platform::CloseFile(file_);
+  }
+
+  Position Packed::Size() const
+  {
+    return size_;
+  }
+
+  bool Packed::Unpacked() const
+  {
+    return remaining_ == 0;
+  }
+
+  Position Packed::Unpack(char* data, Position start, Position end)
+  {
+    if(start >= size_ || start >= end)
+      return (start < size_ ? start : size_);
+
+    const std::size_t first = static_cast<std::size_t>(start / blockSize_);
+    const std::size_t last  = static_cast<std::size_t>(((end < size_ ? end : size_) - 1) / blockSize_);
+    const Position    stop  = ((last + 1) * blockSize_ < size_ ? (last + 1) * blockSize_ : size_);
+
+    // The usual case: reading on into the next block.
+    if(first == last)
+    {
+      if(!unpacked_[first])
+      {
+        UnpackBlock(first, data);
+        unpacked_[first] = 1;
+        --remaining_;
+      }
+
+      return stop;
+    }
+
+    std::vector<std::size_t> waiting;
+
+    try
+    {
+      for(std::size_t block = first; block <= last; ++block)
+      {
+        if(!unpacked_[block])
+          waiting.push_back(block);
+      }
+    }
+    catch ( std::bad_alloc )
+    {
+      throw File_Exception(E_OUTOFMEMORY);
+    }
+
+    // Each block only marks itself, so the threads never write to the same place.
+    try
+    {
+      ThreadPool::Default().ForEach(waiting.size(), [&](std::size_t i)
+      {
+        UnpackBlock(waiting[i], data);
+        unpacked_[waiting[i]] = 1;
+      });
+    }
+    catch ( File_Exception )
+    {
+      for(std::size_t i = 0; i < waiting.size(); ++i)
+        remaining_ -= unpacked_[waiting[i]];
+
+      throw;
+    }
+
+    remaining_ -= waiting.size();
+    return stop;
+  }
+
+  void Packed::UnpackBlock(std::size_t block, char* data) const
+  {
+    const Position    start  = block * blockSize_;
+    const std::size_t raw    = static_cast<std::size_t>(size_ - start < blockSize_ ? size_ - start : blockSize_);
+    const std::size_t length = static_cast<std::size_t>(offsets_[block + 1] - offsets_[block]);
+
+    // Stored as-is, so it can go straight where it belongs.
+    if(length == raw)
+    {
+      if(Platform::ReadAt(file_, &data[start], raw, offsets_[block]) != raw)
+        throw File_Exception(E_BADFORMAT);
+
+      return;
+    }
+
+    std::vector<char> packed;
+
+    try
+    {
+      packed.resize(length);
+    }
+    catch ( std::bad_alloc )
+    {
+      throw File_Exception(E_OUTOFMEMORY);
+    }
+
+    if(Platform::ReadAt(file_, &packed[0], length, offsets_[block]) != length || !Compress::Unblock(&packed[0], length, &data[start], raw))
+      throw File_Exception(E_BADFORMAT);
+  }
+}
\ No newline at end of file
@@ -0,0 +1,119 @@
+/* File_Compress.h
+ * Purpose: Store files compressed, in blocks that can each be unpacked on
+ * their own, so a compressed file can still be read from anywhere and its
+ * blocks packed and unpacked on every core at once.
+ */
+
+#ifndef FILE_COMPRESS_H
+#define FILE_COMPRESS_H
+
+#include "File_Types.h"
+#include "File_Exception.h"
+#include "File_Platform.h"
+
+#include <cstddef>
+#include <vector>
+
+namespace File
+{
+  // A compressed file is laid out as:
+  //
+  //   Header: "OOFZ", then as little endian numbers: the format version (4
+  //           bytes), the block size (4), the number of blocks (4), the
+  //           size of the file unpacked (8) and where the index is (8).
+  //   Blocks: Every block, one after another, each packed on its own.
+  //   Index:  How many bytes each block was packed into (4 bytes each). A
+  //           block packed into as many bytes as it started with is stored as-is.
+  namespace Compress
+  {
+    // How many bytes of the file go into each block, other than the last.
+    const std::size_t BlockSize = 256 * 1024;
+
+    /* Packs a block with an LZ77 scheme, the same shape as LZ4's: runs of
+     * literal bytes, each followed by a match copying earlier bytes from up
+     * to 64 KB back, found through a hash of every 4 bytes. Fast both ways,
+     * and needs nothing from outside.
+     *
+     * capacity: How much room there is at output.
+     *
+     * Returns: How many bytes it was packed into. 0 if it doesn't fit into
+     *          capacity, in which case it's better off stored as-is.
+     */
+    std::size_t Block(const char* input, std::size_t size, char* output, std::size_t capacity) throw();
+
+    /* Unpacks a block packed by Block. Checks everything it reads, so a
+     * damaged block can't write outside of output.
+     *
+     * Returns: Whether the block unpacked to exactly outputSize bytes.
+     */
+    bool Unblock(const char* input, std::size_t size, char* output, std::size_t outputSize) throw();
+
+    /* Writes data out as a compressed file, from the start of file. The
+     * blocks are packed on every core at once, a batch at a time, and each
+     * batch written out in one go.
+     *
+     * Returns: How many bytes were written.
+     *
+     * Throws: E_IOERROR      - Writing the file failed.
+     *         E_OUTOFMEMORY  - There wasn't room to pack a batch of blocks into.
+     *         E_THREADERROR  - The threads to pack on couldn't be started.
+     */
+    Position Pack(Platform::Handle file, const char* data, Position size) throw(File_Exception);
+  }
+
+  // A compressed file that's being unpacked a few blocks at a time, as
+  // they're needed. Keeps the file open until every block is unpacked.
+  class Packed
+  {
+  public:
+    /* Reads the header and the index of a compressed file. An empty file
+     * is an empty compressed file. Takes over file if it doesn't throw.
+     *
+     * Throws: E_BADFORMAT - The file isn't a compressed file, or is cut short.
+     *         E_IOERROR   - Reading the file failed.
+     *         E_OUTOFMEMORY - There wasn't room for the index.
+     */
+    explicit Packed(Platform::Handle file) throw(File_Exception);
+
+    ~Packed() throw();
+
+    /* How large the file is unpacked.
+     */
+    Position Size() const throw();
+
+    /* Whether every block has been unpacked.
+     */
+    bool Unpacked() const throw();
+
+    /* Unpacks every block holding part of [start, end) that hasn't been
+     * unpacked yet, into the same place in data. More than one block is
+     * unpacked on several cores at once.
+     *
+     * data: The whole file, unpacked. Has to have room for Size() bytes.
+     *
+     * Returns: Where the last of those blocks ends.
+     *
+     * Throws: E_BADFORMAT   - A block is damaged.
+     *         E_IOERROR     - Reading the file failed.
+     *         E_OUTOFMEMORY - There wasn't room to read the blocks into.
+     * Status after Throw: The blocks that were unpacked stay unpacked.
+     */
+    Position Unpack(char* data, Position start, Position end) throw(File_Exception);
+
+  private:
+    // Unpacks one block into its place in data.
+    void UnpackBlock(std::size_t block, char* data) const throw(File_Exception);
+
+    Packed(const Packed&);
+    Packed& operator=(const Packed&);
+
+    Platform::Handle      file_;      // The compressed file.
+    Position              size_;      // How large it is unpacked.
+    Position              blockSize_; // How much of it is in each block.
+    std::vector<Position> offsets_;   // Where each block starts in the file, and where the last one ends.
+    std::vector<char>     unpacked_;  // Whether each block has been unpacked.
+    std::size_t           remaining_; // How many blocks haven't been.
+  };
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,55 @@
+#include "File_Endian.h"
+
+// SSE2 is always there on x64, and on x86 when the compiler is told so.
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+  #define FILE_ENDIAN_SSE2
+  #include <emmintrin.h>
+#endif
+
+namespace File
+{
+  namespace Endian
+  {
+    void SwapArray(void* data, std::size_t size, std::size_t count)
+    {
+      char* bytes = static_cast<char*>(data);
+      std::size_t i = 0;
+
+#ifdef FILE_ENDIAN_SSE2
+      // Swap the bytes of each 16 bit half, then put the halves in reverse order.
+      const std::size_t perBlock = (size > 1 ? 16 / size : 0);
+
+      for(; perBlock != 0 && i + perBlock <= count; i += perBlock)
+      {
+        __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&bytes[i * size]));
+        block = _mm_or_si128(_mm_slli_epi16(block, 8), _mm_srli_epi16(block, 8));
+
+        if(size == 4)
+          block = _mm_shufflehi_epi16(_mm_shufflelo_epi16(block, _MM_SHUFFLE(2, 3, 0, 1)), _MM_SHUFFLE(2, 3, 0, 1));
+        else if(size == 8)
+          block = _mm_shufflehi_epi16(_mm_shufflelo_epi16(block, _MM_SHUFFLE(0, 1, 2, 3)), _MM_SHUFFLE(0, 1, 2, 3));
+
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(&bytes[i * size]), block);
+      }
+#endif
+
+      switch(size)
+      {
+        case 2:
+          for(; i < count; ++i)
+            Swapper<2>::Swap(&bytes[i * 2]);
+          break;
+
+        case 4:
+          for(; i < count; ++i)
+            Swapper<4>::Swap(&bytes[i * 4]);
+          break;
+
+        case 8:
+          for(; i < count; ++i)
+            Swapper<8>::Swap(&bytes[i * 8]);
+          break;
+      }
+    }
+  }
+}
\ No newline at end of file
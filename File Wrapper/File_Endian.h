@@ -0,0 +1,141 @@
+/* File_Endian.h
+ * Purpose: Convert numbers between the byte order of the machine and the
+ * byte order they're stored in, with the choice made at compile time.
+ */
+
+#ifndef FILE_ENDIAN_H
+#define FILE_ENDIAN_H
+
+#include <cstddef>
+#include <cstring>
+#include <type_traits>
+
+#ifdef _MSC_VER
+  #include <cstdlib> // _byteswap_ulong and _byteswap_uint64
+#endif
+
+namespace File
+{
+  // Byte orders, for File::Read and File::Write. Least significant byte first...
+  struct LittleEndian {};
+
+  // ...or most significant byte first, the way network protocols do it.
+  struct BigEndian {};
+
+  // The byte order of the machine the program is built for.
+#if defined(__BYTE_ORDER__) && defined(__ORDER_BIG_ENDIAN__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+  typedef BigEndian NativeEndian;
+#else
+  typedef LittleEndian NativeEndian;
+#endif
+
+  namespace Endian
+  {
+    /* Reverses the bytes of each of count values, in place, 16 bytes at a
+     * time where possible.
+     *
+     * size: How large each value is. 1, 2, 4 or 8. 1 does nothing.
+     */
+    void SwapArray(void* data, std::size_t size, std::size_t count) throw();
+
+    // Whether values stored in Order have to be swapped on this machine.
+    // Only defined for LittleEndian and BigEndian.
+    template <typename Order> struct NeedsSwap;
+    template <> struct NeedsSwap<NativeEndian> { static const bool value = false; };
+    template <> struct NeedsSwap<std::conditional<std::is_same<NativeEndian, LittleEndian>::value, BigEndian, LittleEndian>::type> { static const bool value = true; };
+
+    // Whether a T can be read or written in Order: anything in the machine's
+    // own order, but only numbers (and enums) of 1, 2, 4 or 8 bytes in the
+    // other one, since the bytes of anything else don't have an order.
+    template <typename Order, typename T> struct CanConvert
+    {
+      static const bool value = !NeedsSwap<Order>::value || sizeof(T) == 1 ||
+                                ((std::is_arithmetic<T>::value || std::is_enum<T>::value) && (sizeof(T) == 2 || sizeof(T) == 4 || sizeof(T) == 8));
+    };
+
+    // Result, but only for the byte order tags, so that anything else
+    // passed as Order picks a different overload.
+    template <typename Order, typename Result> struct IfOrder;
+    template <typename Result> struct IfOrder<LittleEndian, Result> { typedef Result type; };
+    template <typename Result> struct IfOrder<BigEndian, Result>    { typedef Result type; };
+
+    // Reverses the bytes of one value of Size bytes.
+    template <std::size_t Size> struct Swapper;
+
+    template <> struct Swapper<1>
+    {
+      static void Swap(void*) throw()
+      {
+      }
+    };
+
+    template <> struct Swapper<2>
+    {
+      static void Swap(void* value) throw()
+      {
+        unsigned short bits;
+        std::memcpy(&bits, value, 2);
+        bits = static_cast<unsigned short>((bits << 8) | (bits >> 8));
+        std::memcpy(value, &bits, 2);
+      }
+    };
+
+    template <> struct Swapper<4>
+    {
+      static void Swap(void* value) throw()
+      {
+        unsigned bits;
+        std::memcpy(&bits, value, 4);
+#if defined(_MSC_VER)
+        bits = _byteswap_ulong(bits);
+#elif defined(__GNUC__)
+        bits = __builtin_bswap32(bits);
+#else
+        bits = (bits << 24) | ((bits << 8) & 0xFF0000) | ((bits >> 8) & 0xFF00) | (bits >> 24);
+#endif
+        std::memcpy(value, &bits, 4);
+      }
+    };
+
+    template <> struct Swapper<8>
+    {
+      static void Swap(void* value) throw()
+      {
+        unsigned long long bits;
+        std::memcpy(&bits, value, 8);
+#if defined(_MSC_VER)
+        bits = _byteswap_uint64(bits);
+#elif defined(__GNUC__)
+        bits = __builtin_bswap64(bits);
+#else
+        bits = (static_cast<unsigned long long>(Low(bits)) << 32) | Low(bits >> 32);
+#endif
+        std::memcpy(value, &bits, 8);
+      }
+
+#if !defined(_MSC_VER) && !defined(__GNUC__)
+      // Swaps the bytes of the low 32 bits.
+      static unsigned Low(unsigned long long bits) throw()
+      {
+        unsigned low = static_cast<unsigned>(bits);
+        Swapper<4>::Swap(&low);
+        return low;
+      }
+#endif
+    };
+
+    /* Converts a value between the byte order of the machine and Order.
+     * Going either way is the same swap. See: CanConvert
+     */
+    template <typename Order, typename T>
+    void Convert(T& value) throw()
+    {
+      static_assert(CanConvert<Order, T>::value, "Only numbers can be converted to another byte order. Read or write the members one at a time.");
+
+      // Values that don't need swapping might not be a size Swapper knows.
+      Swapper<NeedsSwap<Order>::value ? sizeof(T) : 1>::Swap(&value);
+    }
+  }
+}
+
+#endif
\ No newline at end of file
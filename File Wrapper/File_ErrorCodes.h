@@ -17,6 +17,13 @@ namespace File
     E_BADFLAGS,
     E_PROTECTED,
     E_INVALIDPOSITION,
+    E_MMAPERROR,
+    E_IOERROR,
+    E_INVALIDSIZE,
+    E_THREADERROR,
+    E_FORMATERROR,
+    E_NOTRANSACTION,
+    E_BADFORMAT,
   };
 
   static const char* ErrorStrings[] = {
@@ -24,10 +31,17 @@ namespace File
     0,                                       // E_CUSTOMSTRING
     "fopen returned an error.",              // E_FOPENERROR
     "Out of system memory.",                 // E_OUTOFMEMORY
-    "File is larger than int max.",          // E_FILETOOLARGE
+    "File is too large to hold in memory.",  // E_FILETOOLARGE
     "Inappropriate flags specified.",        // E_BADFLAGS
     "Attempt to write into protected file.", // E_PROTECTED
     "Invalid position specified.",           // E_INVALIDPOSITION
+    "Unable to map the file into memory.",   // E_MMAPERROR
+    "Reading or writing the file failed.",   // E_IOERROR
+    "Invalid size specified.",               // E_INVALIDSIZE
+    "Unable to start a thread.",             // E_THREADERROR
+    "Unable to format the output.",          // E_FORMATERROR
+    "No transaction has been started.",      // E_NOTRANSACTION
+    "File is not in the expected format.",   // E_BADFORMAT
   };
 }
 
@@ -29,12 +29,15 @@ namespace File
     sprintf(errorString, "%s%s", prefix, ErrorStrings[errorCode]);
   }
 
-  File_Exception::File_Exception(const File_Exception& rhs)
+  File_Exception::File_Exception(const File_Exception& rhs) : errorCode(rhs.errorCode), errorString(NULL)
   {
-    errorCode = rhs.errorCode;
-    unsigned len = strlen(rhs.errorString);
-    errorString = new char[len + 1]; // Include null terminator
-    strcpy(&errorString[0], &rhs.errorString[0]);
+    // A default constructed exception has no string to copy.
+    if(rhs.errorString != NULL)
+    {
+      unsigned len = strlen(rhs.errorString);
+      errorString = new char[len + 1]; // Include null terminator
+      strcpy(&errorString[0], &rhs.errorString[0]);
+    }
   }
 
   File_Exception::~File_Exception()
@@ -49,10 +52,21 @@ namespace File
 
   File_Exception& File_Exception::operator=(const File_Exception& rhs)
   {
-    errorCode = rhs.errorCode;
-    unsigned len = strlen(rhs.errorString);
-    errorString = new char[len + 1]; // Include null terminator
-    strcpy(&errorString[0], &rhs.errorString[0]);
+    if(this == &rhs)
+      return *this;
+
+    // Copy their string before letting go of ours.
+    char* copy = NULL;
+    if(rhs.errorString != NULL)
+    {
+      unsigned len = strlen(rhs.errorString);
+      copy = new char[len + 1]; // Include null terminator
+      strcpy(&copy[0], &rhs.errorString[0]);
+    }
+
+    delete [] errorString;
+    errorCode   = rhs.errorCode;
+    errorString = copy;
 
     return *this;
   }
@@ -0,0 +1,167 @@
+#include "File_FileSet.h"
+#include "File_ErrorCodes.h"
+#include "File_Platform.h"
+
+#include <algorithm>
+#include <cstring>
+#include <new>
+
+namespace File
+{
+  namespace
+  {
+    // Sorts entries by where they are on the disk.
+    struct ByDiskOrder
+    {
+      explicit ByDiskOrder(const std::vector<unsigned long long>& orders) : orders_(orders)
+      {
+      }
+
+      bool operator()(std::size_t lhs, std::size_t rhs) const
+      {
+        return orders_[lhs] < orders_[rhs];
+      }
+
+      const std::vector<unsigned long long>& orders_;
+    };
+  }
+
+  FileSet::FileSet(Allocator& allocator) : allocator_(&allocator)
+  {
+  }
+
+  FileSet::~FileSet()
+  {
+    for(std::size_t i = 0; i < entries_.size(); ++i)
+    {
+      delete entries_[i].file;
+      allocator_->Free(entries_[i].filename, std::strlen(entries_[i].filename) + 1);
+    }
+  }
+
+  std::size_t FileSet::Add(const char* filename, Mode mode)
+  {
+    // Same as the File constructor.
+    if(mode == MODE_SAME)
+      throw File_Exception(E_BADFLAGS);
+
+    Entry entry;
+    entry.filename = allocator_->Allocate(std::strlen(filename) + 1);
+    entry.mode     = mode;
+    entry.loaded   = false;
+    entry.file     = NULL;
+    std::strcpy(entry.filename, filename);
+
+    try
+    {
+      entries_.push_back(entry);
+    }
+    catch ( std::bad_alloc )
+    {
+      allocator_->Free(entry.filename, std::strlen(filename) + 1);
+      throw File_Exception(E_OUTOFMEMORY);
+    }
+
+    return entries_.size() - 1;
+  }
+
+  void FileSet::Load(ThreadPool& pool)
+  {
+    std::vector<std::size_t> pending;
+    std::vector<unsigned long long> orders;
+
+    try
+    {
+      for(std::size_t i = 0; i < entries_.size(); ++i)
+      {
+        if(!entries_[i].loaded)
+          pending.push_back(i);
+      }
+
+      orders.resize(entries_.size(), 0);
+    }
+    catch ( std::bad_alloc )
+    {
+      throw File_Exception(E_OUTOFMEMORY);
+    }
+
+    // Queue the files up in disk order. The pool takes them off the queue
+    // in the same order.
+    for(std::size_t i = 0; i < pending.size(); ++i)
+      orders[pending[i]] = Platform::DiskOrder(entries_[pending[i]].filename);
+
+    std::stable_sort(pending.begin(), pending.end(), ByDiskOrder(orders));
+
+    std::size_t queued = 0;
+
+    try
+    {
+      for(; queued < pending.size(); ++queued)
+      {
+        Entry* entry = &entries_[pending[queued]];
+        pool.Run([this, entry]() { Open(*entry); });
+      }
+    }
+    catch ( File_Exception )
+    {
+      // Don't leave the queued ones running into the set after we've gone.
+      pool.Wait();
+      throw;
+    }
+
+    pool.Wait();
+  }
+
+  void FileSet::Load(unsigned threads)
+  {
+    ThreadPool pool(threads);
+    Load(pool);
+  }
+
+  void FileSet::Open(Entry& entry)
+  {
+    try
+    {
+      entry.file = new File(entry.filename, entry.mode, *allocator_);
+    }
+    catch ( File_Exception e )
+    {
+      entry.error = e;
+    }
+    catch ( std::bad_alloc )
+    {
+      entry.error = File_Exception(E_OUTOFMEMORY);
+    }
+
+    entry.loaded = true;
+  }
+
+  std::size_t FileSet::Count() const
+  {
+    return entries_.size();
+  }
+
+  bool FileSet::Failed(std::size_t index) const
+  {
+    return index < entries_.size() && entries_[index].loaded && entries_[index].file == NULL;
+  }
+
+  File_Exception FileSet::Error(std::size_t index) const
+  {
+    if(index >= entries_.size())
+      throw File_Exception(E_INVALIDPOSITION);
+
+    return entries_[index].error;
+  }
+
+  File& FileSet::Get(std::size_t index)
+  {
+    if(index >= entries_.size() || !entries_[index].loaded)
+      throw File_Exception(E_INVALIDPOSITION);
+
+    if(entries_[index].file == NULL)
+      throw entries_[index].error;
+
+    return *entries_[index].file;
+  }
+}
\ No newline at end of file
@@ -0,0 +1,102 @@
+/* File_FileSet.h
+ * Purpose: Open a batch of files side by side rather than one after
+ * another, for when there are lots of small files to load.
+ */
+
+#ifndef FILE_FILESET_H
+#define FILE_FILESET_H
+
+#include "File_Wrapper.h"
+#include "File_ThreadPool.h"
+
+#include <cstddef>
+#include <vector>
+
+namespace File
+{
+  // A batch of files to open all at once. Add the files, Load them on a
+  // ThreadPool, then get each one (or why it couldn't be opened) by the
+  // order it was added in.
+  //
+  // Files are opened in the order they sit on the disk (see:
+  // Platform::DiskOrder) rather than the order they were added, so the
+  // disk isn't seeking back and forth between them.
+  class FileSet
+  {
+  public:
+    /* allocator: Where the files get their memory from. It's used from
+     *            several threads at once, so it has to be thread safe,
+     *            which ArenaAllocator isn't.
+     */
+    explicit FileSet(Allocator& allocator = Allocator::Default()) throw();
+    ~FileSet() throw();
+
+    /* Adds a file to be opened by the next Load.
+     *
+     * filename: The name of the file. Copied, so it doesn't have to stay around.
+     * mode: How to open it. See: File::Open
+     *
+     * Returns: Where the file is in the set. See: Get
+     *
+     * Throws: E_BADFLAGS    - mode is MODE_SAME.
+     *         E_OUTOFMEMORY - The set couldn't grow.
+     */
+    std::size_t Add(const char* filename, Mode mode = MODE_READ) throw(File_Exception);
+
+    /* Opens every file added since the last Load, and waits for them.
+     * A file that can't be opened doesn't stop the others. See: Failed
+     *
+     * pool: Where to open the files. Waits for everything else queued on
+     *       it too, so don't call from one of its tasks.
+     * threads: How many threads to open the files on, in a pool of their
+     *          own. 0 means one per core. See: ThreadPool
+     *
+     * Throws: E_THREADERROR - A thread couldn't be started.
+     *         E_OUTOFMEMORY - The files couldn't be queued up.
+     */
+    void Load(ThreadPool& pool) throw(File_Exception);
+    void Load(unsigned threads = 0) throw(File_Exception);
+
+    /* How many files are in the set.
+     */
+    std::size_t Count() const throw();
+
+    /* Whether a file couldn't be opened. False until it's been loaded.
+     */
+    bool Failed(std::size_t index) const throw();
+
+    /* Gets why a file couldn't be opened. Only meaningful if Failed.
+     */
+    File_Exception Error(std::size_t index) const throw(File_Exception);
+
+    /* Gets an opened file. It stays in the set, and is closed along with
+     * it. Move it out to keep it longer: File kept = std::move(set.Get(i));
+     *
+     * Throws: E_INVALIDPOSITION - There's no such file, or it hasn't been loaded.
+     *         Whatever opening the file threw, if it Failed.
+     */
+    File& Get(std::size_t index) throw(File_Exception);
+
+  private:
+    FileSet(const FileSet&);
+    FileSet& operator=(const FileSet&);
+
+    // A file in the set.
+    struct Entry
+    {
+      char*              filename; // From allocator_.
+      Mode               mode;
+      bool               loaded;
+      File*              file;     // NULL until it's loaded, and if it couldn't be.
+      File_Exception     error;    // Why it couldn't be.
+    };
+
+    // Opens one file. Runs on the pool.
+    void Open(Entry& entry) throw();
+
+    Allocator*         allocator_;
+    std::vector<Entry> entries_;
+  };
+}
+
+#endif
\ No newline at end of file
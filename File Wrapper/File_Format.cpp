@@ -0,0 +1,178 @@
+#include "File_Format.h"
+#include "File_Wrapper.h"
+
+#include <cstdio>
+#include <cstdlib>
+
+namespace File
+{
+  namespace Text
+  {
+    namespace
+    {
+      // "00" to "99", so two digits can be written at once.
+      const char DigitPairs[] =
+        "00010203040506070809"
+        "10111213141516171819"
+        "20212223242526272829"
+        "30313233343536373839"
+        "40414243444546474849"
+        "50515253545556575859"
+        "60616263646566676869"
+        "70717273747576777879"
+        "80818283848586878889"
+        "90919293949596979899";
+
+      // How many decimal digits value has.
+      unsigned Digits(unsigned long long value)
+      {
+        unsigned digits = 1;
+
+        for(;;)
+        {
+          if(value < 10)    return digits;
+          if(value < 100)   return digits + 1;
+          if(value < 1000)  return digits + 2;
+          if(value < 10000) return digits + 3;
+
+          value  /= 10000;
+          digits += 4;
+        }
+      }
+    }
+
+    std::size_t Integer(char* output, unsigned long long value)
+    {
+      const unsigned length = Digits(value);
+
+      // Fill in from the back, two digits at a time.
+      char* digit = output + length;
+
+      while(value >= 100)
+      {
+        const unsigned pair = static_cast<unsigned>(value % 100) * 2;
+        value /= 100;
+
+        *--digit = DigitPairs[pair + 1];
+        *--digit = DigitPairs[pair];
+      }
+
+      if(value >= 10)
+      {
+        const unsigned pair = static_cast<unsigned>(value) * 2;
+
+        *--digit = DigitPairs[pair + 1];
+        *--digit = DigitPairs[pair];
+      }
+      else
+        *--digit = static_cast<char>('0' + value);
+
+      return length;
+    }
+
+    std::size_t Integer(char* output, long long value)
+    {
+      if(value >= 0)
+        return Integer(output, static_cast<unsigned long long>(value));
+
+      // Negate as unsigned, so the most negative number works too.
+      *output = '-';
+      return 1 + Integer(output + 1, 0 - static_cast<unsigned long long>(value));
+    }
+
+    std::size_t Float(char* output, double value)
+    {
+      // Whole numbers are common and don't need printf at all.
+      if(value > -1e15 && value < 1e15 && value == static_cast<double>(static_cast<long long>(value)) && (value != 0 || 1 / value > 0))
+        return Integer(output, static_cast<long long>(value));
+
+      // 15 digits is usually enough to get the same number back. If it
+      // isn't, 17 always is. None come close to MaxNumberLength.
+      int length = std::sprintf(output, "%.15g", value);
+
+      for(int digits = 16; digits <= 17 && value == value && std::strtod(output, NULL) != value; ++digits)
+        length = std::sprintf(output, "%.*g", digits, value);
+
+      return (length > 0 ? static_cast<std::size_t>(length) : 0);
+    }
+
+    int Print(char* output, std::size_t size, const char* format, va_list args)
+    {
+#if defined(_MSC_VER) && _MSC_VER < 1900
+      // Measure it separately, since _vsnprintf only says it didn't fit.
+      va_list copy;
+      va_copy(copy, args);
+      const int length = _vscprintf(format, copy);
+      va_end(copy);
+
+      if(size > 0)
+        _vsnprintf_s(output, size, _TRUNCATE, format, args);
+
+      return length;
+#else
+      return std::vsnprintf(output, size, format, args);
+#endif
+    }
+
+    Formatter::Formatter(File& file) : file_(&file), used_(0)
+    {
+    }
+
+    void Formatter::Flush()
+    {
+      if(used_ == 0)
+        return;
+
+      // Start over even if the write fails, so nothing's written twice.
+      const std::size_t used = used_;
+      used_ = 0;
+
+      file_->Write(buffer_, used);
+    }
+
+    void Formatter::Add(const char* string)
+    {
+      Add(string, std::strlen(string));
+    }
+
+    void Formatter::Add(const View& view)
+    {
+      Add(view.Data(), static_cast<std::size_t>(view.Size()));
+    }
+
+    void Formatter::Add(char character)
+    {
+      Room(1);
+      buffer_[used_++] = character;
+    }
+
+    void Formatter::Add(bool value)
+    {
+      if(value)
+        Add("true", 4);
+      else
+        Add("false", 5);
+    }
+
+    void Formatter::Add(double value)
+    {
+      Room(MaxNumberLength);
+      used_ += Float(&buffer_[used_], value);
+    }
+
+    void Formatter::Add(const char* data, std::size_t length)
+    {
+      Room(length);
+
+      // Too long to be worth copying twice.
+      if(length > sizeof(buffer_))
+      {
+        file_->Write(data, length);
+        return;
+      }
+
+      std::memcpy(&buffer_[used_], data, length);
+      used_ += length;
+    }
+  }
+}
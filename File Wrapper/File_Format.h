@@ -0,0 +1,145 @@
+/* File_Format.h
+ * Purpose: Turn numbers into text quickly, and collect the pieces of
+ * File::Format so they go into the file in one write.
+ */
+
+#ifndef FILE_FORMAT_H
+#define FILE_FORMAT_H
+
+#include "File_Exception.h"
+#include "File_View.h"
+
+#include <cstdarg>
+#include <cstddef>
+#include <cstring>
+#include <type_traits>
+
+// Lets the compiler check Printf's arguments against its format string, the
+// way it does for printf. index is where the format string is, counting the
+// File itself as 1.
+#if defined(__GNUC__)
+  #define FILE_PRINTF_FORMAT(index) __attribute__((format(printf, index, index + 1)))
+#else
+  #define FILE_PRINTF_FORMAT(index)
+#endif
+
+// The same check for MSVC's /analyze, which marks the parameter instead.
+#if defined(_MSC_VER)
+  #include <sal.h>
+  #define FILE_FORMAT_STRING _Printf_format_string_
+#else
+  #define FILE_FORMAT_STRING
+#endif
+
+// MSVC before 2013 has no va_copy, but its va_list is a plain pointer.
+#if defined(_MSC_VER) && _MSC_VER < 1800 && !defined(va_copy)
+  #define va_copy(destination, source) ((destination) = (source))
+#endif
+
+namespace File
+{
+  class File;
+
+  namespace Text
+  {
+    // The most characters Integer or Float can give back.
+    const std::size_t MaxNumberLength = 32;
+
+    /* Writes out a number in decimal, two digits at a time. Not
+     * null-terminated.
+     *
+     * output: Where to put it. Needs room for MaxNumberLength characters.
+     *
+     * Returns: How many characters it took.
+     */
+    std::size_t Integer(char* output, unsigned long long value) throw();
+    std::size_t Integer(char* output, long long value) throw();
+
+    /* Writes out a number with as few digits as it takes to read the same
+     * number back again, like 0.1 rather than 0.10000000000000001. Not
+     * null-terminated.
+     *
+     * output: Where to put it. Needs room for MaxNumberLength characters.
+     *
+     * Returns: How many characters it took.
+     */
+    std::size_t Float(char* output, double value) throw();
+
+    /* vsnprintf, except it always gives back how long the whole output is,
+     * even where vsnprintf gives back -1 when it doesn't fit (MSVC before 2015).
+     *
+     * Returns: How many characters the output takes, not counting the null.
+     *          Negative if it can't be formatted at all.
+     */
+    int Print(char* output, std::size_t size, const char* format, va_list args) throw();
+
+    // Collects the pieces of a File::Format call, and writes them to the
+    // file whenever it runs out of room and once more at the end.
+    // Anything it doesn't know how to write is caught at compile time.
+    class Formatter
+    {
+    public:
+      explicit Formatter(File& file) throw();
+
+      // Writes out everything collected so far. Whatever hasn't been
+      // flushed when the Formatter goes away is dropped.
+      void Flush() throw(File_Exception);
+
+      void Add(const char* string) throw(File_Exception);
+      void Add(char* string) throw(File_Exception) { Add(static_cast<const char*>(string)); }
+      void Add(const View& view) throw(File_Exception);
+      void Add(char character) throw(File_Exception);
+      void Add(bool value) throw(File_Exception);
+      void Add(double value) throw(File_Exception);
+
+      // Every other number is an integer or a float.
+      template <typename T>
+      void Add(const T& value) throw(File_Exception)
+      {
+        static_assert(std::is_arithmetic<T>::value, "File::Format only writes strings, characters, views and numbers.");
+
+        AddNumber(value, std::integral_constant<int, std::is_floating_point<T>::value ? 2 : std::is_signed<T>::value ? 1 : 0>());
+      }
+
+    private:
+      template <typename T>
+      void AddNumber(T value, std::integral_constant<int, 0>) throw(File_Exception)
+      {
+        Room(MaxNumberLength);
+        used_ += Integer(&buffer_[used_], static_cast<unsigned long long>(value));
+      }
+
+      template <typename T>
+      void AddNumber(T value, std::integral_constant<int, 1>) throw(File_Exception)
+      {
+        Room(MaxNumberLength);
+        used_ += Integer(&buffer_[used_], static_cast<long long>(value));
+      }
+
+      template <typename T>
+      void AddNumber(T value, std::integral_constant<int, 2>) throw(File_Exception)
+      {
+        Add(static_cast<double>(value));
+      }
+
+      // Adds a run of characters, going straight to the file if it's long.
+      void Add(const char* data, std::size_t length) throw(File_Exception);
+
+      // Makes sure there's room for length more characters.
+      void Room(std::size_t length) throw(File_Exception)
+      {
+        if(length > sizeof(buffer_) - used_)
+          Flush();
+      }
+
+      Formatter(const Formatter&);
+      Formatter& operator=(const Formatter&);
+
+      File* file_;
+      std::size_t used_;
+      char buffer_[512];
+    };
+  }
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,135 @@
+#include "File_Journal.h"
+#include "File_ErrorCodes.h"
+
+#include <new>
+
+namespace File
+{
+  Journal::Journal()
+  {
+  }
+
+  void Journal::Begin(Position filePointer)
+  {
+    const Savepoint savepoint = {edits_.size(), filePointer};
+
+    try
+    {
+      savepoints_.push_back(savepoint);
+    }
+    catch ( std::bad_alloc )
+    {
+      throw File_Exception(E_OUTOFMEMORY);
+    }
+  }
+
+  Position Journal::End()
+  {
+    const Position filePointer = savepoints_.back().filePointer;
+    savepoints_.pop_back();
+
+    // Nothing left that could be rolled back.
+    if(savepoints_.empty())
+    {
+      edits_.clear();
+      saved_.clear();
+    }
+
+    return filePointer;
+  }
+
+  unsigned Journal::Depth() const
+  {
+    return static_cast<unsigned>(savepoints_.size());
+  }
+
+  char* Journal::Record(Position position, Position inserted, Position savedLength)
+  {
+    if(savepoints_.empty() || (inserted == 0 && savedLength == 0))
+      return NULL;
+
+    const std::size_t start = saved_.size();
+
+    try
+    {
+      saved_.resize(start + static_cast<std::size_t>(savedLength));
+    }
+    catch ( std::bad_alloc )
+    {
+      throw File_Exception(E_OUTOFMEMORY);
+    }
+
+    char* saved = (savedLength > 0 ? &saved_[start] : NULL);
+
+    // Carrying on from the last edit, with the bytes it took the place of
+    // and this one's already next to each other.
+    if(edits_.size() > savepoints_.back().edits && edits_.back().position + edits_.back().inserted == position)
+    {
+      edits_.back().inserted    += inserted;
+      edits_.back().savedLength += savedLength;
+      return saved;
+    }
+
+    const Edit edit = {position, inserted, start, savedLength};
+
+    try
+    {
+      edits_.push_back(edit);
+    }
+    catch ( std::bad_alloc )
+    {
+      saved_.resize(start);
+      throw File_Exception(E_OUTOFMEMORY);
+    }
+
+    return saved;
+  }
+
+  void Journal::Cancel(Position inserted, Position savedLength)
+  {
+    if(savepoints_.empty() || (inserted == 0 && savedLength == 0))
+      return;
+
+    // It was either added on to the last edit or is the last edit, and
+    // its saved bytes are the last ones either way.
+    edits_.back().inserted    -= inserted;
+    edits_.back().savedLength -= savedLength;
+    saved_.resize(saved_.size() - static_cast<std::size_t>(savedLength));
+
+    if(edits_.back().inserted == 0 && edits_.back().savedLength == 0)
+      edits_.pop_back();
+  }
+
+  const Journal::Edit* Journal::Last() const
+  {
+    if(savepoints_.empty() || edits_.size() == savepoints_.back().edits)
+      return NULL;
+
+    return &edits_.back();
+  }
+
+  const char* Journal::Saved(const Edit& edit) const
+  {
+    return (edit.savedLength > 0 ? &saved_[static_cast<std::size_t>(edit.savedStart)] : NULL);
+  }
+
+  void Journal::Undo()
+  {
+    saved_.resize(static_cast<std::size_t>(edits_.back().savedStart));
+    edits_.pop_back();
+  }
+
+  void Journal::Clear()
+  {
+    edits_.clear();
+    saved_.clear();
+    savepoints_.clear();
+  }
+
+  void Journal::Swap(Journal& rhs)
+  {
+    edits_.swap(rhs.edits_);
+    saved_.swap(rhs.saved_);
+    savepoints_.swap(rhs.savepoints_);
+  }
+}
\ No newline at end of file
@@ -0,0 +1,105 @@
+/* File_Journal.h
+ * Purpose: Remember what edits wrote over, so that a transaction can be
+ * rolled back by putting just those bytes back.
+ */
+
+#ifndef FILE_JOURNAL_H
+#define FILE_JOURNAL_H
+
+#include "File_Types.h"
+#include "File_Exception.h"
+
+#include <cstddef>
+#include <vector>
+
+namespace File
+{
+  // Every edit made since a transaction began, each as the bytes that were
+  // put in at a position and the bytes they took the place of, with
+  // savepoints marking where nested transactions began. Only what was
+  // overwritten or erased is kept, so it's as large as the edits, not the file.
+  class Journal
+  {
+  public:
+    // One edit: inserted bytes at position took the place of savedLength bytes.
+    struct Edit
+    {
+      Position position;    // Where the edit starts in the file.
+      Position inserted;    // How many bytes are there now.
+      Position savedStart;  // Where the bytes that were there are kept.
+      Position savedLength; // How many bytes were there.
+    };
+
+    Journal() throw();
+
+    /* Starts a transaction, or a savepoint inside of the current one.
+     *
+     * filePointer: Where the file pointer was, to go back to on rollback.
+     *
+     * Throws: E_OUTOFMEMORY - The savepoint couldn't be added.
+     * Status after Throw: No change.
+     */
+    void Begin(Position filePointer) throw(File_Exception);
+
+    /* Ends the innermost transaction, giving back where the file pointer was
+     * when it began. The edits since then are kept, as part of the
+     * transaction around it. See: Undo, for rolling them back first.
+     */
+    Position End() throw();
+
+    /* How many transactions are going on inside each other. Edits are
+     * only recorded when this isn't 0.
+     */
+    unsigned Depth() const throw();
+
+    /* Records an edit, before it's made. An edit starting where the last one
+     * ended is merged into it, so writing sequentially adds one edit, not
+     * one for every write. Does nothing outside of a transaction.
+     *
+     * Returns: Where to copy the savedLength bytes that are about to be
+     *          written over or erased. NULL if savedLength is 0 or nothing
+     *          was recorded.
+     *
+     * Throws: E_OUTOFMEMORY - There wasn't room to record the edit.
+     * Status after Throw: No change.
+     */
+    char* Record(Position position, Position inserted, Position savedLength) throw(File_Exception);
+
+    /* Takes back the last Record, when the edit couldn't be made after all.
+     */
+    void Cancel(Position inserted, Position savedLength) throw();
+
+    /* Gets the latest edit of the innermost transaction, and the bytes it
+     * took the place of.
+     *
+     * Returns: NULL once every edit since it began has been undone.
+     */
+    const Edit* Last() const throw();
+    const char* Saved(const Edit& edit) const throw();
+
+    /* Forgets the latest edit, once it's been undone.
+     */
+    void Undo() throw();
+
+    /* Forgets every transaction and edit.
+     */
+    void Clear() throw();
+
+    /* Swaps the edits of two journals, without copying any of them.
+     */
+    void Swap(Journal& rhs) throw();
+
+  private:
+    struct Savepoint
+    {
+      std::size_t edits;       // How many edits there were when it began.
+      Position    filePointer; // Where the file pointer was.
+    };
+
+    std::vector<Edit>      edits_;      // Every edit, in the order they were made.
+    std::vector<char>      saved_;      // What each edit took the place of, one after another.
+    std::vector<Savepoint> savepoints_; // Where each transaction began, outermost first.
+  };
+}
+
+#endif
\ No newline at end of file
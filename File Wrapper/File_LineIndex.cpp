@@ -0,0 +1,83 @@
+#include "File_LineIndex.h"
+#include "File_ErrorCodes.h"
+#include "File_Scan.h"
+
+#include <algorithm>
+#include <new>
+#include <utility>
+
+namespace File
+{
+  LineIndex::LineIndex() : indexed_(0)
+  {
+  }
+
+  void LineIndex::Clear()
+  {
+    starts_.clear();
+    indexed_ = 0;
+  }
+
+  void LineIndex::Truncate(Position position)
+  {
+    if(position >= indexed_)
+      return;
+
+    // A line starting after position starts after a byte that may have changed.
+    starts_.erase(std::upper_bound(starts_.begin(), starts_.end(), position), starts_.end());
+    indexed_ = position;
+  }
+
+  void LineIndex::Extend(const char* data, std::size_t size)
+  {
+    std::size_t searched = 0;
+
+    while(searched < size)
+    {
+      const std::size_t newline = searched + Scan::Find(&data[searched], size - searched, '\n');
+
+      if(newline == size)
+        break;
+
+      try
+      {
+        starts_.push_back(indexed_ + newline + 1);
+      }
+      catch ( std::bad_alloc )
+      {
+        indexed_ += searched;
+        throw File_Exception(E_OUTOFMEMORY);
+      }
+
+      searched = newline + 1;
+    }
+
+    indexed_ += size;
+  }
+
+  Position LineIndex::Indexed() const
+  {
+    return indexed_;
+  }
+
+  Position LineIndex::Found() const
+  {
+    return starts_.size();
+  }
+
+  Position LineIndex::Start(Position line) const
+  {
+    return (line == 0 ? 0 : starts_[static_cast<std::size_t>(line - 1)]);
+  }
+
+  Position LineIndex::LineOf(Position position) const
+  {
+    return std::upper_bound(starts_.begin(), starts_.end(), position) - starts_.begin();
+  }
+
+  void LineIndex::Swap(LineIndex& rhs)
+  {
+    starts_.swap(rhs.starts_);
+    std::swap(indexed_, rhs.indexed_);
+  }
+}
\ No newline at end of file
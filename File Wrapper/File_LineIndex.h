@@ -0,0 +1,72 @@
+/* File_LineIndex.h
+ * Purpose: Remember where each line of a file starts, so getting to a line
+ * doesn't mean reading every line before it.
+ */
+
+#ifndef FILE_LINEINDEX_H
+#define FILE_LINEINDEX_H
+
+#include "File_Types.h"
+#include "File_Exception.h"
+
+#include <cstddef>
+#include <vector>
+
+namespace File
+{
+  // Where the lines of a file start, from the beginning of the file up to
+  // however far it's been indexed. Built up a piece at a time (see: Extend),
+  // so only as much of the file as is needed ever gets looked at. Line 0
+  // always starts at 0. Every other line starts right after a \n.
+  class LineIndex
+  {
+  public:
+    LineIndex() throw();
+
+    /* Forgets every line.
+     */
+    void Clear() throw();
+
+    /* Forgets everything that depends on the bytes from position on, for
+     * when they've changed. Lines starting at or before position are kept.
+     */
+    void Truncate(Position position) throw();
+
+    /* Indexes the next part of the file.
+     *
+     * data: The bytes of the file starting at Indexed().
+     * size: How many bytes there are.
+     *
+     * Throws: E_OUTOFMEMORY - The index couldn't grow. Whatever was indexed
+     *                         before running out is kept.
+     */
+    void Extend(const char* data, std::size_t size) throw(File_Exception);
+
+    /* How far into the file has been indexed.
+     */
+    Position Indexed() const throw();
+
+    /* How many lines after line 0 have been found. The last one may start
+     * right at the end of the file.
+     */
+    Position Found() const throw();
+
+    /* Where a line starts. line has to be at most Found().
+     */
+    Position Start(Position line) const throw();
+
+    /* Which line a position is on. position has to be at most Indexed().
+     */
+    Position LineOf(Position position) const throw();
+
+    /* Swaps the contents of two indexes, without copying them.
+     */
+    void Swap(LineIndex& rhs) throw();
+
+  private:
+    std::vector<Position> starts_;  // Where lines 1 and up start.
+    Position              indexed_; // How far into the file starts_ is complete.
+  };
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,115 @@
+#include "File_Newlines.h"
+
+#include <cstring>
+
+// SSE2 is always there on x64, and on x86 when the compiler is told so.
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+  #define FILE_NEWLINES_SSE2
+  #include <emmintrin.h>
+#endif
+
+namespace File
+{
+  namespace Newlines
+  {
+    std::size_t ToLF(char* data, std::size_t size)
+    {
+      std::size_t read  = 0;
+      std::size_t write = 0;
+
+#ifdef FILE_NEWLINES_SSE2
+      // Move 16 bytes at a time until one of them is a \r. Writing never
+      // gets ahead of reading, so the store only touches bytes already read.
+      const __m128i cr = _mm_set1_epi8('\r');
+
+      while(read + 16 <= size)
+      {
+        const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&data[read]));
+
+        if(_mm_movemask_epi8(_mm_cmpeq_epi8(block, cr)) != 0)
+        {
+          // Do this block a byte at a time.
+          for(const std::size_t end = read + 16; read < end; ++read)
+          {
+            if(data[read] != '\r' || read + 1 == size || data[read + 1] != '\n')
+              data[write++] = data[read];
+          }
+
+          continue;
+        }
+
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(&data[write]), block);
+        read  += 16;
+        write += 16;
+      }
+#endif
+
+      for(; read < size; ++read)
+      {
+        if(data[read] != '\r' || read + 1 == size || data[read + 1] != '\n')
+          data[write++] = data[read];
+      }
+
+      return write;
+    }
+
+    std::size_t ToCRLF(const char* input, std::size_t size, char* output)
+    {
+      std::size_t read  = 0;
+      std::size_t write = 0;
+
+#ifdef FILE_NEWLINES_SSE2
+      // Copy 16 bytes at a time until one of them is a \n.
+      const __m128i lf = _mm_set1_epi8('\n');
+
+      while(read + 16 <= size)
+      {
+        const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&input[read]));
+        unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(block, lf)));
+
+        if(mask == 0)
+        {
+          _mm_storeu_si128(reinterpret_cast<__m128i*>(&output[write]), block);
+          read  += 16;
+          write += 16;
+          continue;
+        }
+
+        // Copy the block over a line at a time.
+        std::size_t copied = 0;
+
+        while(mask != 0)
+        {
+          // Where the next \n is in the block.
+          std::size_t newline = 0;
+          while(!(mask & (1u << newline)))
+            ++newline;
+
+          mask &= mask - 1;
+
+          // Everything up to it, then \r\n.
+          std::memcpy(&output[write], &input[read + copied], newline - copied);
+          write += newline - copied;
+          output[write++] = '\r';
+          output[write++] = '\n';
+          copied = newline + 1;
+        }
+
+        std::memcpy(&output[write], &input[read + copied], 16 - copied);
+        write += 16 - copied;
+        read  += 16;
+      }
+#endif
+
+      for(; read < size; ++read)
+      {
+        if(input[read] == '\n')
+          output[write++] = '\r';
+
+        output[write++] = input[read];
+      }
+
+      return write;
+    }
+  }
+}
\ No newline at end of file
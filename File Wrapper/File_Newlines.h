@@ -0,0 +1,37 @@
+/* File_Newlines.h
+ * Purpose: Translate between \r\n and \n line endings, so text mode works
+ * the same on every platform instead of depending on the C runtime.
+ */
+
+#ifndef FILE_NEWLINES_H
+#define FILE_NEWLINES_H
+
+#include <cstddef>
+
+namespace File
+{
+  namespace Newlines
+  {
+    /* Turns every \r\n into \n, in place. A \r on its own is left alone.
+     *
+     * data: The text to translate.
+     * size: How many bytes of text there are.
+     *
+     * Returns: How many bytes of text there are afterwards.
+     */
+    std::size_t ToLF(char* data, std::size_t size) throw();
+
+    /* Turns every \n into \r\n, the same way the C runtime's text mode does
+     * on Windows.
+     *
+     * input: The text to translate.
+     * size: How many bytes of text there are.
+     * output: Where the translated text goes. Needs room for twice size.
+     *
+     * Returns: How many bytes were put in output.
+     */
+    std::size_t ToCRLF(const char* input, std::size_t size, char* output) throw();
+  }
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,47 @@
+#include "File_Parallel.h"
+#include "File_ErrorCodes.h"
+
+namespace File
+{
+  std::vector<View> SplitChunks(const View& contents, std::size_t pieces, char delimiter)
+  {
+    std::vector<View> chunks;
+
+    if(contents.Empty())
+      return chunks;
+
+    if(pieces == 0)
+      pieces = 1;
+
+    const char*    data   = contents.Data();
+    const Position size   = contents.Size();
+    const Position target = (size + pieces - 1) / pieces;
+
+    try
+    {
+      chunks.reserve(static_cast<std::size_t>(pieces));
+
+      for(Position start = 0; start < size; )
+      {
+        // Aim for target bytes, then carry on to the end of the line, unless
+        // that's where it already ends.
+        Position end = (size - start > target ? start + target : size);
+
+        if(end < size)
+          end += Scan::Find(&data[end - 1], static_cast<std::size_t>(size - end + 1), delimiter);
+
+        if(end > size)
+          end = size;
+
+        chunks.push_back(View(&data[start], end - start));
+        start = end;
+      }
+    }
+    catch ( std::bad_alloc )
+    {
+      throw File_Exception(E_OUTOFMEMORY);
+    }
+
+    return chunks;
+  }
+}
\ No newline at end of file
@@ -0,0 +1,114 @@
+/* File_Parallel.h
+ * Purpose: Go through a File on every core at once, a chunk or a line at
+ * a time, and combine what each core came up with.
+ */
+
+#ifndef FILE_PARALLEL_H
+#define FILE_PARALLEL_H
+
+#include "File_Wrapper.h"
+#include "File_ErrorCodes.h"
+#include "File_ThreadPool.h"
+#include "File_Scan.h"
+
+#include <cstddef>
+#include <new>
+#include <vector>
+
+namespace File
+{
+  // How many chunks each thread gets, on average. More chunks than threads
+  // lets threads that finish early take on the chunks that are left.
+  const std::size_t ChunksPerThread = 8;
+
+  /* Splits contents into about pieces chunks of about the same size. Every
+   * chunk but the last ends right after a delimiter, so no line is split.
+   * A line longer than a chunk just makes its chunk longer.
+   *
+   * Throws: E_OUTOFMEMORY - The list of chunks couldn't be allocated.
+   */
+  std::vector<View> SplitChunks(const View& contents, std::size_t pieces, char delimiter) throw(File_Exception);
+
+  /* Calls function(partial, chunk) for every chunk of a file, on every
+   * thread of pool at once, then merges the partial results in file order:
+   *
+   *   size_t lines = ParallelForEachChunk(file, size_t(0),
+   *     [](size_t& count, const File::View& chunk) { count += std::count(chunk.begin(), chunk.end(), '\n'); },
+   *     [](size_t& total, const size_t& count) { total += count; });
+   *
+   * Chunks end right after a delimiter (see: SplitChunks). Doesn't move the
+   * file's internal pointer, and the file can't be changed while this runs.
+   *
+   * initial: What every partial result starts off as. The result of an
+   *          empty file.
+   * function: Called as function(Result& partial, const View& chunk). Each
+   *           partial is only ever used by one thread at a time.
+   * merge: Called as merge(Result& total, const Result& partial), from the
+   *        first chunk to the last, on the calling thread.
+   *
+   * Throws: E_BADFLAGS    - The file is streamed, so it isn't all in memory at once.
+   *         E_OUTOFMEMORY - The chunks couldn't be set up.
+   *         Otherwise, the first thing function threw.
+   */
+  template <typename Result, typename Function, typename Merge>
+  Result ParallelForEachChunk(File& file, const Result& initial, Function function, Merge merge,
+                              char delimiter = '\n', ThreadPool& pool = ThreadPool::Default())
+  {
+    // Each partial gets a cache line to itself, so threads updating
+    // neighbouring ones don't slow each other down.
+    struct Partial
+    {
+      explicit Partial(const Result& result) : value(result)
+      {
+      }
+
+      Result value;
+      char   padding[64];
+    };
+
+    const std::vector<View> chunks = SplitChunks(file.Contents(), pool.Threads() * ChunksPerThread, delimiter);
+    std::vector<Partial> partials;
+
+    try
+    {
+      partials.resize(chunks.size(), Partial(initial));
+    }
+    catch ( std::bad_alloc )
+    {
+      throw File_Exception(E_OUTOFMEMORY);
+    }
+
+    pool.ForEach(chunks.size(), [&](std::size_t index) { function(partials[index].value, chunks[index]); });
+
+    Result total = initial;
+    for(std::size_t i = 0; i < partials.size(); ++i)
+      merge(total, partials[i].value);
+
+    return total;
+  }
+
+  /* Calls function(partial, line) for every line of a file, on every thread
+   * of pool at once. Lines come back without their delimiter, and one at the
+   * very end of the file doesn't start another line, the same as
+   * File::Lines. Otherwise the same as ParallelForEachChunk.
+   */
+  template <typename Result, typename Function, typename Merge>
+  Result ParallelForEachLine(File& file, const Result& initial, Function function, Merge merge,
+                             char delimiter = '\n', ThreadPool& pool = ThreadPool::Default())
+  {
+    return ParallelForEachChunk(file, initial, [&function, delimiter](Result& partial, const View& chunk)
+    {
+      const char* line = chunk.begin();
+      const char* end  = chunk.end();
+
+      while(line < end)
+      {
+        const std::size_t length = Scan::Find(line, static_cast<std::size_t>(end - line), delimiter);
+        function(partial, View(line, length));
+        line += length + 1;
+      }
+    }, merge, delimiter, pool);
+  }
+}
+
+#endif
\ No newline at end of file
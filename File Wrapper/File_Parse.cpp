@@ -0,0 +1,365 @@
+#include "File_Parse.h"
+#include "File_Endian.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <new>
+#include <vector>
+
+namespace File
+{
+  namespace Parse
+  {
+    namespace
+    {
+      // Exact powers of ten. Every one up to 1e22 fits in a double exactly.
+      const double PowersOfTen[] = {
+        1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+      };
+
+      // The largest integer a double holds exactly, and the most significant
+      // digits that are worth keeping when there are more.
+      const unsigned long long MaxExactInteger = 1ULL << 53;
+      const int MaxSignificantDigits = 19;
+
+      // How long a float can be before strtod gets it through the heap.
+      const std::size_t FloatStackSize = 128;
+
+      bool IsDigit(char character)
+      {
+        return static_cast<unsigned>(character - '0') < 10;
+      }
+
+      bool IsSpace(char character)
+      {
+        return character == ' ' || static_cast<unsigned>(character - '\t') < 5;
+      }
+
+      // Loads 8 characters with the first one in the lowest byte, whichever
+      // way around the machine keeps them.
+      unsigned long long LoadEight(const char* data)
+      {
+        unsigned long long chunk;
+        std::memcpy(&chunk, data, 8);
+        Endian::Convert<LittleEndian>(chunk);
+        return chunk;
+      }
+
+      // Whether all 8 characters are digits: each byte's high half has to
+      // be 3, and still be 3 after adding 6 to it.
+      bool EightDigits(unsigned long long chunk)
+      {
+        const unsigned long long highHalves = 0xF0F0F0F0F0F0F0F0ULL;
+        return ((chunk & highHalves) | (((chunk + 0x0606060606060606ULL) & highHalves) >> 4)) == 0x3333333333333333ULL;
+      }
+
+      // Works out the value of 8 digits with three multiplies, pairing up
+      // digits, then pairs, then fours.
+      unsigned EightDigitValue(unsigned long long chunk)
+      {
+        chunk -= 0x3030303030303030ULL;
+        chunk  = (chunk * 10) + (chunk >> 8);
+        chunk  = (((chunk & 0x000000FF000000FFULL) * (100 + (1000000ULL << 32))) +
+                  (((chunk >> 16) & 0x000000FF000000FFULL) * (1 + (10000ULL << 32)))) >> 32;
+
+        return static_cast<unsigned>(chunk);
+      }
+
+      // Reads a run of digits. Leaves at where it is if there aren't any.
+      ParseResult Digits(const char*& at, const char* end, unsigned long long& value)
+      {
+        const char* digit = at;
+
+        // Leading zeros don't count towards overflowing.
+        while(digit < end && *digit == '0')
+          ++digit;
+
+        const char* significant = digit;
+        unsigned long long total = 0;
+
+        // 8 at a time, up to 16 digits, since that can't overflow.
+        while(end - digit >= 8 && digit - significant <= 8)
+        {
+          const unsigned long long chunk = LoadEight(digit);
+
+          if(!EightDigits(chunk))
+            break;
+
+          total  = total * 100000000 + EightDigitValue(chunk);
+          digit += 8;
+        }
+
+        // The rest one at a time, watching for overflow.
+        const unsigned long long max = std::numeric_limits<unsigned long long>::max();
+        bool overflow = false;
+
+        for(; digit < end && IsDigit(*digit); ++digit)
+        {
+          const unsigned next = static_cast<unsigned>(*digit - '0');
+
+          if(total > (max - next) / 10)
+            overflow = true;
+          else if(!overflow)
+            total = total * 10 + next;
+        }
+
+        if(digit == at)
+          return PARSE_INVALID;
+
+        at = digit;
+
+        if(overflow)
+          return PARSE_OUTOFRANGE;
+
+        value = total;
+        return PARSE_OK;
+      }
+
+      // Reads an optional - and then digits. The magnitude is checked
+      // against max, or max + 1 for negative numbers.
+      template <typename T>
+      ParseResult Signed(const char*& at, const char* end, T& value)
+      {
+        const bool negative = (at < end && *at == '-');
+        const char* digits  = (negative ? at + 1 : at);
+
+        unsigned long long magnitude = 0;
+        const ParseResult result = Digits(digits, end, magnitude);
+
+        if(result == PARSE_INVALID)
+          return PARSE_INVALID;
+
+        at = digits;
+
+        const unsigned long long max = static_cast<unsigned long long>(std::numeric_limits<T>::max());
+
+        if(result == PARSE_OUTOFRANGE || magnitude > max + (negative ? 1 : 0))
+          return PARSE_OUTOFRANGE;
+
+        // Negate as unsigned, so the most negative number works too.
+        value = (negative ? static_cast<T>(-static_cast<long long>(magnitude - 1) - 1) : static_cast<T>(magnitude));
+        return PARSE_OK;
+      }
+
+      template <typename T>
+      ParseResult Unsigned(const char*& at, const char* end, T& value)
+      {
+        unsigned long long magnitude = 0;
+        const ParseResult result = Digits(at, end, magnitude);
+
+        if(result == PARSE_OK && magnitude > std::numeric_limits<T>::max())
+          return PARSE_OUTOFRANGE;
+
+        if(result == PARSE_OK)
+          value = static_cast<T>(magnitude);
+
+        return result;
+      }
+
+      // Whether text starts with word, in any case.
+      bool StartsWith(const char* text, const char* end, const char* word)
+      {
+        for(; *word != 0; ++text, ++word)
+        {
+          if(text == end || (*text | 0x20) != *word)
+            return false;
+        }
+
+        return true;
+      }
+
+      // Reads inf, infinity, nan or nan(letters, digits and _).
+      ParseResult Special(const char*& at, const char* end, bool negative, double& value)
+      {
+        const char* text = (negative ? at + 1 : at);
+
+        if(StartsWith(text, end, "inf"))
+        {
+          at    = text + (StartsWith(text, end, "infinity") ? 8 : 3);
+          value = (negative ? -std::numeric_limits<double>::infinity() : std::numeric_limits<double>::infinity());
+          return PARSE_OK;
+        }
+
+        if(StartsWith(text, end, "nan"))
+        {
+          text += 3;
+
+          // The part in brackets only counts if it's closed.
+          if(text < end && *text == '(')
+          {
+            const char* close = text + 1;
+
+            while(close < end && (IsDigit(*close) || static_cast<unsigned>((*close | 0x20) - 'a') < 26 || *close == '_'))
+              ++close;
+
+            if(close < end && *close == ')')
+              text = close + 1;
+          }
+
+          at    = text;
+          value = (negative ? -std::numeric_limits<double>::quiet_NaN() : std::numeric_limits<double>::quiet_NaN());
+          return PARSE_OK;
+        }
+
+        return PARSE_INVALID;
+      }
+    }
+
+    ParseResult Number(const char*& at, const char* end, int& value)
+    {
+      return Signed(at, end, value);
+    }
+
+    ParseResult Number(const char*& at, const char* end, unsigned& value)
+    {
+      return Unsigned(at, end, value);
+    }
+
+    ParseResult Number(const char*& at, const char* end, long long& value)
+    {
+      return Signed(at, end, value);
+    }
+
+    ParseResult Number(const char*& at, const char* end, unsigned long long& value)
+    {
+      return Unsigned(at, end, value);
+    }
+
+    ParseResult Number(const char*& at, const char* end, double& value)
+    {
+      const bool negative = (at < end && *at == '-');
+      const char* text    = (negative ? at + 1 : at);
+
+      if(text < end && ((*text | 0x20) == 'i' || (*text | 0x20) == 'n'))
+        return Special(at, end, negative, value);
+
+      // Keep the first 19 significant digits, and where the decimal point
+      // ends up relative to them.
+      unsigned long long mantissa = 0;
+      int digits     = 0;
+      int exponent   = 0;
+      bool sawDigit  = false;
+      bool truncated = false;
+
+      for(; text < end && IsDigit(*text); ++text)
+      {
+        sawDigit = true;
+
+        if(digits < MaxSignificantDigits)
+        {
+          mantissa = mantissa * 10 + (*text - '0');
+          digits  += (mantissa != 0);
+        }
+        else
+        {
+          ++exponent;
+          truncated |= (*text != '0');
+        }
+      }
+
+      if(text < end && *text == '.')
+      {
+        for(++text; text < end && IsDigit(*text); ++text)
+        {
+          sawDigit = true;
+
+          if(digits < MaxSignificantDigits)
+          {
+            mantissa = mantissa * 10 + (*text - '0');
+            digits  += (mantissa != 0);
+            --exponent;
+          }
+          else
+            truncated |= (*text != '0');
+        }
+      }
+
+      if(!sawDigit)
+        return PARSE_INVALID;
+
+      // The exponent only counts if it has digits.
+      if(text < end && (*text | 0x20) == 'e')
+      {
+        const char* power = text + 1;
+        const bool negativePower = (power < end && *power == '-');
+
+        if(power < end && (*power == '-' || *power == '+'))
+          ++power;
+
+        if(power < end && IsDigit(*power))
+        {
+          int written = 0;
+
+          // Anything past 5 digits is out of range either way.
+          for(; power < end && IsDigit(*power); ++power)
+          {
+            if(written < 100000)
+              written = written * 10 + (*power - '0');
+          }
+
+          exponent += (negativePower ? -written : written);
+          text      = power;
+        }
+      }
+
+      const char* numberEnd = text;
+
+      // Few enough digits to be exact, and a power of ten that's exact too,
+      // so one multiply or divide rounds correctly.
+      if(!truncated && mantissa <= MaxExactInteger && exponent >= -22 && exponent <= 22)
+      {
+        double result = static_cast<double>(mantissa);
+        result = (exponent < 0 ? result / PowersOfTen[-exponent] : result * PowersOfTen[exponent]);
+
+        value = (negative ? -result : result);
+        at    = numberEnd;
+        return PARSE_OK;
+      }
+
+      // Hand the rest to strtod, with a null after it.
+      const std::size_t length = numberEnd - at;
+      char stackCopy[FloatStackSize];
+      std::vector<char> heapCopy;
+      char* copy = stackCopy;
+
+      if(length >= sizeof(stackCopy))
+      {
+        try
+        {
+          heapCopy.resize(length + 1);
+        }
+        catch(std::bad_alloc&)
+        {
+          return PARSE_OUTOFRANGE;
+        }
+
+        copy = &heapCopy[0];
+      }
+
+      std::memcpy(copy, at, length);
+      copy[length] = 0;
+
+      const double result = std::strtod(copy, NULL);
+      at = numberEnd;
+
+      // Too large, or so small it came out as zero.
+      if(result == std::numeric_limits<double>::infinity() || result == -std::numeric_limits<double>::infinity() || (result == 0 && mantissa != 0))
+        return PARSE_OUTOFRANGE;
+
+      value = result;
+      return PARSE_OK;
+    }
+
+    std::size_t TokenLength(const char* data, std::size_t size)
+    {
+      std::size_t length = 0;
+
+      while(length < size && !IsSpace(data[length]))
+        ++length;
+
+      return length;
+    }
+  }
+}
\ No newline at end of file
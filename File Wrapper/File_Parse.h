@@ -0,0 +1,55 @@
+/* File_Parse.h
+ * Purpose: Read numbers out of text right where it is, without copying it
+ * or null-terminating it first, the way std::from_chars does.
+ */
+
+#ifndef FILE_PARSE_H
+#define FILE_PARSE_H
+
+#include <cstddef>
+
+namespace File
+{
+  // How reading a number or token went. Returned instead of throwing, since
+  // running into something that isn't a number is normal when reading text.
+  enum ParseResult
+  {
+    PARSE_OK,         // Read it.
+    PARSE_INVALID,    // There's no number there. Nothing was read.
+    PARSE_OUTOFRANGE, // It's a number, but too large for the type, or a token too long for the space given.
+    PARSE_ENDOFFILE,  // There's nothing left to read.
+  };
+
+  namespace Parse
+  {
+    /* Reads a decimal number starting exactly at at, with the same rules as
+     * std::from_chars: no whitespace or + in front, and a - only for signed
+     * types. Floats can also be written with an exponent, or as inf,
+     * infinity or nan, in any case.
+     *
+     * Integers are read 8 digits at a time, and floats with 15 or fewer
+     * significant digits and small exponents are worked out directly; only
+     * the rest go through strtod.
+     *
+     * at: Where the number starts. Moved past it unless it's PARSE_INVALID.
+     * end: Where the text ends. Nothing at or past it is looked at.
+     * value: Receives the number. Left alone unless it's PARSE_OK.
+     *
+     * Returns: PARSE_OK, PARSE_INVALID or PARSE_OUTOFRANGE.
+     */
+    ParseResult Number(const char*& at, const char* end, int& value) throw();
+    ParseResult Number(const char*& at, const char* end, unsigned& value) throw();
+    ParseResult Number(const char*& at, const char* end, long long& value) throw();
+    ParseResult Number(const char*& at, const char* end, unsigned long long& value) throw();
+    ParseResult Number(const char*& at, const char* end, double& value) throw();
+
+    /* Finds the end of a token: the first whitespace character (' ', \t, \n,
+     * \v, \f or \r).
+     *
+     * Returns: How far into data the whitespace is. size if there isn't any.
+     */
+    std::size_t TokenLength(const char* data, std::size_t size) throw();
+  }
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,296 @@
+#include "File_PieceTable.h"
+#include "File_ErrorCodes.h"
+
+#include <cstring>
+#include <new>
+
+namespace File
+{
+  namespace
+  {
+    // How much of an original that isn't mapped is copied through memory at once when writing.
+    const std::size_t CopyChunkSize = 1024 * 1024;
+  }
+
+  PieceTable::PieceTable() : size_(0), original_(Platform::InvalidHandle), originalSize_(0), mapping_(NULL)
+  {
+  }
+
+  PieceTable::PieceTable(const PieceTable& rhs) : size_(rhs.size_), original_(Platform::InvalidHandle), originalSize_(0), mapping_(NULL)
+  {
+    try
+    {
+      pieces_ = rhs.pieces_;
+      added_  = rhs.added_;
+    }
+    catch ( std::bad_alloc )
+    {
+      throw File_Exception(E_OUTOFMEMORY);
+    }
+  }
+
+  PieceTable::~PieceTable()
+  {
+    Detach();
+  }
+
+  void PieceTable::Attach(const char* filename, Platform::Handle file, Position size)
+  {
+    Detach();
+
+    original_     = file;
+    originalSize_ = size;
+
+    // A file too large for the address space (or one that can't be mapped
+    // for any other reason) is read a piece at a time instead.
+    try
+    {
+      Position mappedSize = 0;
+      mapping_ = Platform::MapFile(filename, mappedSize);
+
+      // Someone else changed the file between opening and mapping it.
+      if(mapping_ != NULL && mappedSize != size)
+      {
+        Platform::UnmapFile(mapping_, mappedSize);
+        mapping_ = NULL;
+      }
+    }
+    catch ( File_Exception )
+    {
+      mapping_ = NULL;
+    }
+  }
+
+  void PieceTable::Detach()
+  {
+    if(mapping_ != NULL)
+      Platform::UnmapFile(mapping_, originalSize_);
+
+    mapping_      = NULL;
+    original_     = Platform::InvalidHandle;
+    originalSize_ = 0;
+  }
+
+  void PieceTable::Reset(Position size)
+  {
+    pieces_.clear();
+    added_.clear();
+    size_ = size;
+
+    if(size > 0)
+    {
+      const Piece whole = {0, size, false};
+      pieces_.push_back(whole);
+    }
+  }
+
+  Position PieceTable::Size() const
+  {
+    return size_;
+  }
+
+  bool PieceTable::Edited() const
+  {
+    if(pieces_.empty())
+      return originalSize_ != 0;
+
+    return pieces_.size() != 1 || pieces_[0].added || pieces_[0].length != originalSize_;
+  }
+
+  std::size_t PieceTable::Read(Position position, char* output, std::size_t size) const
+  {
+    if(position >= size_)
+      return 0;
+
+    if(size > size_ - position)
+      size = static_cast<std::size_t>(size_ - position);
+
+    std::size_t copied = 0;
+    Position pieceStart = 0;
+
+    for(std::vector<Piece>::const_iterator piece = pieces_.begin(); piece != pieces_.end() && copied < size; ++piece)
+    {
+      const Position pieceEnd = pieceStart + piece->length;
+
+      if(position + copied < pieceEnd)
+      {
+        const Position into   = position + copied - pieceStart;
+        const std::size_t count = static_cast<std::size_t>(piece->length - into < size - copied ? piece->length - into : size - copied);
+
+        if(piece->added)
+          std::memcpy(&output[copied], &added_[static_cast<std::size_t>(piece->start + into)], count);
+        else
+          ReadOriginal(piece->start + into, &output[copied], count);
+
+        copied += count;
+      }
+
+      pieceStart = pieceEnd;
+    }
+
+    return copied;
+  }
+
+  void PieceTable::Insert(Position position, const char* data, Position size)
+  {
+    if(size == 0)
+      return;
+
+    const std::size_t start = added_.size();
+
+    try
+    {
+      added_.insert(added_.end(), data, data + size);
+
+      const std::size_t index = Split(position);
+
+      // Typing carries on the piece just typed, rather than starting another.
+      if(index > 0 && pieces_[index - 1].added && pieces_[index - 1].start + pieces_[index - 1].length == start)
+      {
+        pieces_[index - 1].length += size;
+      }
+      else
+      {
+        const Piece inserted = {start, size, true};
+        pieces_.insert(pieces_.begin() + index, inserted);
+      }
+    }
+    catch ( std::bad_alloc )
+    {
+      // Splitting doesn't change the contents, so only the added bytes need undoing.
+      added_.resize(start);
+      throw File_Exception(E_OUTOFMEMORY);
+    }
+
+    size_ += size;
+  }
+
+  void PieceTable::Erase(Position position, Position size)
+  {
+    if(position >= size_)
+      return;
+
+    if(size > size_ - position)
+      size = size_ - position;
+
+    try
+    {
+      const std::size_t first = Split(position);
+      const std::size_t last  = Split(position + size);
+
+      pieces_.erase(pieces_.begin() + first, pieces_.begin() + last);
+    }
+    catch ( std::bad_alloc )
+    {
+      throw File_Exception(E_OUTOFMEMORY);
+    }
+
+    size_ -= size;
+  }
+
+  void PieceTable::Write(Position position, const char* data, Position size)
+  {
+    Erase(position, size);
+    Insert(position, data, size);
+  }
+
+  void PieceTable::WriteTo(Platform::Handle file) const
+  {
+    // Everything in memory goes out in one gathered write. An original
+    // that isn't mapped has to be copied through memory first, so the
+    // slices before it are written out and then it's copied a chunk at a time.
+    std::vector<Platform::Slice> slices;
+    std::vector<char> chunk;
+    Position written = 0;
+    Position gathered = 0;
+
+    try
+    {
+      slices.reserve(pieces_.size());
+
+      for(std::vector<Piece>::const_iterator piece = pieces_.begin(); piece != pieces_.end(); ++piece)
+      {
+        if(piece->added || mapping_ != NULL)
+        {
+          const char* data = (piece->added ? &added_[static_cast<std::size_t>(piece->start)] : &mapping_[piece->start]);
+          const Platform::Slice slice = {data, static_cast<std::size_t>(piece->length)};
+
+          slices.push_back(slice);
+          gathered += piece->length;
+          continue;
+        }
+
+        if(!slices.empty())
+        {
+          Platform::WriteGatherAt(file, &slices[0], slices.size(), written);
+          written += gathered;
+          gathered = 0;
+          slices.clear();
+        }
+
+        chunk.resize(CopyChunkSize);
+
+        for(Position copied = 0; copied < piece->length; )
+        {
+          const std::size_t count = static_cast<std::size_t>(piece->length - copied < CopyChunkSize ? piece->length - copied : CopyChunkSize);
+
+          ReadOriginal(piece->start + copied, &chunk[0], count);
+          Platform::WriteAt(file, &chunk[0], count, written);
+
+          copied  += count;
+          written += count;
+        }
+      }
+    }
+    catch ( std::bad_alloc )
+    {
+      throw File_Exception(E_OUTOFMEMORY);
+    }
+
+    if(!slices.empty())
+      Platform::WriteGatherAt(file, &slices[0], slices.size(), written);
+  }
+
+  std::size_t PieceTable::Split(Position position)
+  {
+    Position pieceStart = 0;
+
+    for(std::size_t i = 0; i < pieces_.size(); ++i)
+    {
+      if(position == pieceStart)
+        return i;
+
+      if(position < pieceStart + pieces_[i].length)
+      {
+        const Position into = position - pieceStart;
+
+        Piece tail   = pieces_[i];
+        tail.start  += into;
+        tail.length -= into;
+
+        pieces_.insert(pieces_.begin() + i + 1, tail);
+        pieces_[i].length = into;
+
+        return i + 1;
+      }
+
+      pieceStart += pieces_[i].length;
+    }
+
+    return pieces_.size();
+  }
+
+  void PieceTable::ReadOriginal(Position position, char* output, std::size_t size) const
+  {
+    if(mapping_ != NULL)
+    {
+      std::memcpy(output, &mapping_[position], size);
+      return;
+    }
+
+    const std::size_t bytesRead = Platform::ReadAt(original_, output, size, position);
+
+    // Someone else cut the file short. Treat the missing part as zeroes.
+    std::memset(&output[bytesRead], 0, size - bytesRead);
+  }
+}
\ No newline at end of file
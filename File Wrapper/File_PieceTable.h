@@ -0,0 +1,133 @@
+/* File_PieceTable.h
+ * Purpose: Keep a file's original contents untouched on disk and describe
+ * the edited file as a list of pieces of it and of the bytes added since,
+ * so editing costs memory in proportion to the edits, not the file.
+ */
+
+#ifndef FILE_PIECETABLE_H
+#define FILE_PIECETABLE_H
+
+#include "File_Types.h"
+#include "File_Exception.h"
+#include "File_Platform.h"
+
+#include <cstddef>
+#include <vector>
+
+namespace File
+{
+  // The contents of a file, as pieces of the original file (mapped into
+  // memory where it fits, read from the file where it doesn't) and of an
+  // append-only buffer holding every byte added since. Nothing is ever
+  // written to the original; editing only splits, adds and removes pieces.
+  class PieceTable
+  {
+  public:
+    PieceTable() throw();
+
+    /* Copies the edits of another table. The original has to be attached
+     * separately. See: Attach
+     *
+     * Throws: E_OUTOFMEMORY - The pieces or added bytes couldn't be copied.
+     */
+    explicit PieceTable(const PieceTable& rhs) throw(File_Exception);
+
+    ~PieceTable() throw();
+
+    /* Uses a file as the original contents, keeping the pieces as they
+     * are. The file is mapped into memory if it can be, and read from file
+     * whenever it's needed otherwise.
+     *
+     * filename: The file to map.
+     * file: The same file, opened. Has to stay open while it's attached.
+     * size: How large the file is.
+     *
+     * Throws: Nothing. If the file can't be mapped, it's read instead.
+     */
+    void Attach(const char* filename, Platform::Handle file, Position size) throw();
+
+    /* Lets go of the original contents, so the file can be replaced. The
+     * pieces are kept, for when the original is attached again.
+     */
+    void Detach() throw();
+
+    /* Starts over with the first size bytes of the original as the whole
+     * file, forgetting every edit.
+     */
+    void Reset(Position size) throw();
+
+    /* How large the file is, with the edits.
+     */
+    Position Size() const throw();
+
+    /* Whether the file is anything other than the original, as it was.
+     */
+    bool Edited() const throw();
+
+    /* Copies part of the file out, going through the pieces it's in.
+     *
+     * Returns: How many bytes were copied. Less than size only at the end of the file.
+     *
+     * Throws: E_IOERROR - Reading the original failed. (Only when it isn't mapped)
+     */
+    std::size_t Read(Position position, char* output, std::size_t size) const throw(File_Exception);
+
+    /* Puts bytes into the file, moving everything after position along.
+     *
+     * Throws: E_OUTOFMEMORY - The added bytes or pieces couldn't grow.
+     * Status after Throw: No change to the contents.
+     */
+    void Insert(Position position, const char* data, Position size) throw(File_Exception);
+
+    /* Takes bytes out of the file, moving everything after them back.
+     * Stops at the end of the file.
+     *
+     * Throws: E_OUTOFMEMORY - The pieces couldn't grow.
+     * Status after Throw: No change to the contents.
+     */
+    void Erase(Position position, Position size) throw(File_Exception);
+
+    /* Writes over bytes in the file, making the file longer if it goes
+     * past the end. position can be the end of the file, but no further.
+     *
+     * Throws: E_OUTOFMEMORY - The added bytes or pieces couldn't grow.
+     */
+    void Write(Position position, const char* data, Position size) throw(File_Exception);
+
+    /* Writes the whole file out, from the start of file. Pieces in memory
+     * go out together in as few system calls as possible. See:
+     * Platform::WriteGatherAt
+     *
+     * Throws: E_IOERROR     - Reading the original or writing file failed.
+     *         E_OUTOFMEMORY - There wasn't the memory to copy the original through.
+     */
+    void WriteTo(Platform::Handle file) const throw(File_Exception);
+
+  private:
+    struct Piece
+    {
+      Position start;  // Where the piece starts in the original, or in added_.
+      Position length; // How many bytes are in the piece.
+      bool     added;  // Whether the piece is in added_ rather than the original.
+    };
+
+    // Splits the piece position is in, so that a piece starts there.
+    // Returns that piece, or pieces_.size() if position is the end of the file.
+    std::size_t Split(Position position);
+
+    // Copies part of the original into output.
+    void ReadOriginal(Position position, char* output, std::size_t size) const throw(File_Exception);
+
+    PieceTable& operator=(const PieceTable&);
+
+    std::vector<Piece> pieces_; // The file, in order.
+    std::vector<char>  added_;  // Every byte inserted or written, in the order it came in.
+    Position           size_;   // The total length of the pieces.
+
+    Platform::Handle original_;     // The original file.
+    Position         originalSize_; // How large it is.
+    char*            mapping_;      // Where it's mapped. NULL if it isn't.
+  };
+}
+
+#endif
\ No newline at end of file
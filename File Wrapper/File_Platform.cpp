@@ -0,0 +1,633 @@
+// Make off_t and stat 64 bits wide on 32-bit systems.
+#define _FILE_OFFSET_BITS 64
+
+#include "File_Platform.h"
+#include "File_ErrorCodes.h"
+
+#include <limits>
+#include <cstdio>
+#include <cstring>
+#include <new>
+
+#ifdef _WIN32
+  // SetFileInformationByHandle needs Vista or later.
+  #ifndef _WIN32_WINNT
+    #define _WIN32_WINNT 0x0600
+  #endif
+
+  #define WIN32_LEAN_AND_MEAN
+  #include <windows.h>
+  #include <sys/types.h>
+  #include <sys/stat.h>
+#else
+  #include <sys/mman.h>
+  #include <sys/stat.h>
+  #include <sys/types.h>
+  #include <sys/uio.h>
+  #include <fcntl.h>
+  #include <unistd.h>
+  #include <cerrno>
+#endif
+
+namespace File
+{
+  namespace Platform
+  {
+    // How many names CreateTempFile tries before giving up.
+    const unsigned TempAttempts = 100;
+
+    // Builds the name of the attempt'th temporary file for filename.
+    char* TempName(const char* filename, unsigned long process, unsigned attempt)
+    {
+      char* name;
+
+      try
+      {
+        name = new char[std::strlen(filename) + 48];
+      }
+      catch ( std::bad_alloc )
+      {
+        throw File_Exception(E_OUTOFMEMORY);
+      }
+
+      std::sprintf(name, "%s.%lu.%u.tmp", filename, process, attempt);
+      return name;
+    }
+
+#ifdef _WIN32
+    // Largest amount ReadFile/WriteFile can move in one call.
+    const std::size_t MaxTransfer = 0x40000000;
+
+    Handle OpenFile(const char* filename, bool write, bool create)
+    {
+      // Let other processes keep reading and writing the file while we have it open.
+      HANDLE file = CreateFileA(filename, GENERIC_READ | (write ? GENERIC_WRITE : 0),
+                                FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, NULL,
+                                (create ? OPEN_ALWAYS : OPEN_EXISTING), FILE_ATTRIBUTE_NORMAL, NULL);
+
+      if(file == INVALID_HANDLE_VALUE)
+        throw File_Exception(E_FOPENERROR);
+
+      return reinterpret_cast<Handle>(file);
+    }
+
+    void CloseFile(Handle file)
+    {
+      if(file != InvalidHandle)
+        CloseHandle(reinterpret_cast<HANDLE>(file));
+    }
+
+    unsigned long long FileSize(Handle file)
+    {
+      LARGE_INTEGER size;
+
+      if(!GetFileSizeEx(reinterpret_cast<HANDLE>(file), &size))
+        throw File_Exception(E_FOPENERROR);
+
+      return static_cast<unsigned long long>(size.QuadPart);
+    }
+
+    unsigned long long FileSize(const char* filename)
+    {
+      struct __stat64 info;
+
+      if(_stat64(filename, &info) != 0)
+        throw File_Exception(E_FOPENERROR);
+
+      return static_cast<unsigned long long>(info.st_size);
+    }
+
+    unsigned long long DiskOrder(const char* filename)
+    {
+      // The file index only comes from an open handle. No access is needed to get it.
+      HANDLE file = CreateFileA(filename, 0, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, NULL,
+                                OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS, NULL);
+
+      if(file == INVALID_HANDLE_VALUE)
+        return 0;
+
+      BY_HANDLE_FILE_INFORMATION info;
+      const BOOL found = GetFileInformationByHandle(file, &info);
+      CloseHandle(file);
+
+      if(!found)
+        return 0;
+
+      return (static_cast<unsigned long long>(info.nFileIndexHigh) << 32) | info.nFileIndexLow;
+    }
+
+    std::size_t ReadAt(Handle file, void* buffer, std::size_t size, unsigned long long position)
+    {
+      std::size_t total = 0;
+
+      while(total < size)
+      {
+        OVERLAPPED where = {0};
+        where.Offset     = static_cast<DWORD>(position + total);
+        where.OffsetHigh = static_cast<DWORD>((position + total) >> 32);
+
+        const DWORD toRead = static_cast<DWORD>(size - total < MaxTransfer ? size - total : MaxTransfer);
+        DWORD bytesRead = 0;
+
+        if(!ReadFile(reinterpret_cast<HANDLE>(file), static_cast<char*>(buffer) + total, toRead, &bytesRead, &where))
+        {
+          if(GetLastError() == ERROR_HANDLE_EOF)
+            break;
+
+          throw File_Exception(E_IOERROR);
+        }
+
+        if(bytesRead == 0) // End of the file
+          break;
+
+        total += bytesRead;
+      }
+
+      return total;
+    }
+
+    void WriteAt(Handle file, const void* buffer, std::size_t size, unsigned long long position)
+    {
+      std::size_t total = 0;
+
+      while(total < size)
+      {
+        OVERLAPPED where = {0};
+        where.Offset     = static_cast<DWORD>(position + total);
+        where.OffsetHigh = static_cast<DWORD>((position + total) >> 32);
+
+        const DWORD toWrite = static_cast<DWORD>(size - total < MaxTransfer ? size - total : MaxTransfer);
+        DWORD bytesWritten = 0;
+
+        if(!WriteFile(reinterpret_cast<HANDLE>(file), static_cast<const char*>(buffer) + total, toWrite, &bytesWritten, &where))
+          throw File_Exception(E_IOERROR);
+
+        total += bytesWritten;
+      }
+    }
+
+    void WriteGatherAt(Handle file, const Slice* slices, std::size_t count, unsigned long long position)
+    {
+      // WriteFileGather only works on whole pages without buffering, so
+      // write them one at a time.
+      for(std::size_t i = 0; i < count; ++i)
+      {
+        WriteAt(file, slices[i].data, slices[i].size, position);
+        position += slices[i].size;
+      }
+    }
+
+    void Truncate(Handle file, unsigned long long size)
+    {
+      LARGE_INTEGER where;
+      where.QuadPart = static_cast<LONGLONG>(size);
+
+      if(!SetFilePointerEx(reinterpret_cast<HANDLE>(file), where, NULL, FILE_BEGIN) ||
+         !SetEndOfFile(reinterpret_cast<HANDLE>(file)))
+        throw File_Exception(E_IOERROR);
+    }
+
+    void Preallocate(Handle file, unsigned long long size)
+    {
+      FILE_ALLOCATION_INFO info;
+      info.AllocationSize.QuadPart = static_cast<LONGLONG>(size);
+
+      // Only running out of space matters. Anything else just means the
+      // file system doesn't do this.
+      if(!SetFileInformationByHandle(reinterpret_cast<HANDLE>(file), FileAllocationInfo, &info, sizeof(info)) &&
+         GetLastError() == ERROR_DISK_FULL)
+        throw File_Exception(E_IOERROR);
+    }
+
+    void Sync(Handle file, bool)
+    {
+      // Windows has no way of leaving the metadata out.
+      if(!FlushFileBuffers(reinterpret_cast<HANDLE>(file)))
+        throw File_Exception(E_IOERROR);
+    }
+
+    void SyncDirectory(const char*)
+    {
+      // RenameOver writes the rename through, and directories can't be
+      // flushed on their own.
+    }
+
+    Handle CreateTempFile(const char* filename, char*& tempName)
+    {
+      // Take on the attributes of the file being replaced, if there is one.
+      DWORD attributes = GetFileAttributesA(filename);
+      if(attributes == INVALID_FILE_ATTRIBUTES)
+        attributes = FILE_ATTRIBUTE_NORMAL;
+
+      attributes &= ~(FILE_ATTRIBUTE_READONLY | FILE_ATTRIBUTE_DIRECTORY);
+
+      for(unsigned attempt = 0; attempt < TempAttempts; ++attempt)
+      {
+        char* name = TempName(filename, GetCurrentProcessId(), attempt);
+
+        HANDLE file = CreateFileA(name, GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, NULL,
+                                  CREATE_NEW, (attributes != 0 ? attributes : FILE_ATTRIBUTE_NORMAL), NULL);
+
+        if(file != INVALID_HANDLE_VALUE)
+        {
+          tempName = name;
+          return reinterpret_cast<Handle>(file);
+        }
+
+        delete [] name;
+
+        // Only a name that's already taken is worth trying again.
+        if(GetLastError() != ERROR_FILE_EXISTS)
+          break;
+      }
+
+      throw File_Exception(E_FOPENERROR);
+    }
+
+    void RenameOver(const char* from, const char* to)
+    {
+      if(!MoveFileExA(from, to, MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH))
+        throw File_Exception(E_IOERROR);
+    }
+
+    char* MapFile(const char* filename, unsigned long long& size)
+    {
+      HANDLE file = reinterpret_cast<HANDLE>(OpenFile(filename, false, false));
+
+      LARGE_INTEGER fileSize;
+      if(!GetFileSizeEx(file, &fileSize))
+      {
+        CloseHandle(file);
+        throw File_Exception(E_FOPENERROR);
+      }
+
+      size = static_cast<unsigned long long>(fileSize.QuadPart);
+
+      // Empty files can't be mapped.
+      if(size == 0)
+      {
+        CloseHandle(file);
+        return NULL;
+      }
+
+      if(size > std::numeric_limits<SIZE_T>::max())
+      {
+        CloseHandle(file);
+        throw File_Exception(E_FILETOOLARGE);
+      }
+
+      HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+      if(mapping == NULL)
+      {
+        CloseHandle(file);
+        throw File_Exception(E_MMAPERROR);
+      }
+
+      void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+
+      // The view keeps the mapping alive, so the handles aren't needed anymore.
+      CloseHandle(mapping);
+      CloseHandle(file);
+
+      if(view == NULL)
+        throw File_Exception(E_MMAPERROR);
+
+      return static_cast<char*>(view);
+    }
+
+    void UnmapFile(char* data, unsigned long long)
+    {
+      if(data != NULL)
+        UnmapViewOfFile(data);
+    }
+#else
+    Handle OpenFile(const char* filename, bool write, bool create)
+    {
+      int flags = (write ? O_RDWR : O_RDONLY) | (create ? O_CREAT : 0);
+      int file = open(filename, flags, 0666);
+
+      if(file == -1)
+        throw File_Exception(E_FOPENERROR);
+
+      return file;
+    }
+
+    void CloseFile(Handle file)
+    {
+      if(file != InvalidHandle)
+        close(static_cast<int>(file));
+    }
+
+    unsigned long long FileSize(Handle file)
+    {
+      struct stat info;
+
+      if(fstat(static_cast<int>(file), &info) != 0)
+        throw File_Exception(E_FOPENERROR);
+
+      return static_cast<unsigned long long>(info.st_size);
+    }
+
+    unsigned long long FileSize(const char* filename)
+    {
+      struct stat info;
+
+      if(stat(filename, &info) != 0)
+        throw File_Exception(E_FOPENERROR);
+
+      return static_cast<unsigned long long>(info.st_size);
+    }
+
+    unsigned long long DiskOrder(const char* filename)
+    {
+      struct stat info;
+
+      if(stat(filename, &info) != 0)
+        return 0;
+
+      return static_cast<unsigned long long>(info.st_ino);
+    }
+
+    std::size_t ReadAt(Handle file, void* buffer, std::size_t size, unsigned long long position)
+    {
+      std::size_t total = 0;
+
+      while(total < size)
+      {
+        ssize_t bytesRead = pread(static_cast<int>(file), static_cast<char*>(buffer) + total, size - total,
+                                  static_cast<off_t>(position + total));
+
+        if(bytesRead < 0)
+        {
+          if(errno == EINTR) // Interrupted before anything was read. Try again.
+            continue;
+
+          throw File_Exception(E_IOERROR);
+        }
+
+        if(bytesRead == 0) // End of the file
+          break;
+
+        total += static_cast<std::size_t>(bytesRead);
+      }
+
+      return total;
+    }
+
+    void WriteAt(Handle file, const void* buffer, std::size_t size, unsigned long long position)
+    {
+      std::size_t total = 0;
+
+      while(total < size)
+      {
+        ssize_t bytesWritten = pwrite(static_cast<int>(file), static_cast<const char*>(buffer) + total, size - total,
+                                      static_cast<off_t>(position + total));
+
+        if(bytesWritten < 0)
+        {
+          if(errno == EINTR) // Interrupted before anything was written. Try again.
+            continue;
+
+          throw File_Exception(E_IOERROR);
+        }
+
+        total += static_cast<std::size_t>(bytesWritten);
+      }
+    }
+
+    void WriteGatherAt(Handle file, const Slice* slices, std::size_t count, unsigned long long position)
+    {
+#if defined(__linux__) || defined(__FreeBSD__)
+      // pwritev takes a limited number of pieces at once, and may write
+      // less than it's given, so keep track of how far into them it got.
+      const std::size_t MaxPieces = 64;
+      iovec pieces[MaxPieces];
+      std::size_t next   = 0; // The first slice not completely written.
+      std::size_t offset = 0; // How much of it has been.
+
+      while(next < count)
+      {
+        std::size_t used = 0;
+        std::size_t requested = 0;
+
+        for(std::size_t i = next; i < count && used < MaxPieces; ++i, ++used)
+        {
+          const std::size_t skip = (i == next ? offset : 0);
+
+          pieces[used].iov_base = const_cast<char*>(static_cast<const char*>(slices[i].data) + skip);
+          pieces[used].iov_len  = slices[i].size - skip;
+          requested += pieces[used].iov_len;
+        }
+
+        ssize_t bytesWritten = 0;
+
+        if(requested > 0)
+        {
+          bytesWritten = pwritev(static_cast<int>(file), pieces, static_cast<int>(used), static_cast<off_t>(position));
+
+          if(bytesWritten < 0)
+          {
+            if(errno == EINTR) // Interrupted before anything was written. Try again.
+              continue;
+
+            throw File_Exception(E_IOERROR);
+          }
+
+          if(bytesWritten == 0)
+            throw File_Exception(E_IOERROR);
+        }
+
+        position += static_cast<std::size_t>(bytesWritten);
+
+        // Step over the slices that were finished.
+        std::size_t remaining = static_cast<std::size_t>(bytesWritten);
+
+        while(next < count && remaining >= slices[next].size - offset)
+        {
+          remaining -= slices[next].size - offset;
+          offset = 0;
+          ++next;
+        }
+
+        offset += remaining;
+      }
+#else
+      for(std::size_t i = 0; i < count; ++i)
+      {
+        WriteAt(file, slices[i].data, slices[i].size, position);
+        position += slices[i].size;
+      }
+#endif
+    }
+
+    void Truncate(Handle file, unsigned long long size)
+    {
+      if(ftruncate(static_cast<int>(file), static_cast<off_t>(size)) != 0)
+        throw File_Exception(E_IOERROR);
+    }
+
+    void Preallocate(Handle file, unsigned long long size)
+    {
+#ifdef __linux__
+      if(size == 0)
+        return;
+
+      // Keep the size as it is, so a file that's cut short by a crash
+      // doesn't end in a run of zeroes.
+      int result;
+
+      do
+      {
+        result = fallocate(static_cast<int>(file), FALLOC_FL_KEEP_SIZE, 0, static_cast<off_t>(size));
+      } while(result != 0 && errno == EINTR);
+
+      // Only running out of space matters. Anything else just means the
+      // file system doesn't do this.
+      if(result != 0 && errno == ENOSPC)
+        throw File_Exception(E_IOERROR);
+#else
+      (void)file;
+      (void)size;
+#endif
+    }
+
+    void Sync(Handle file, bool metadata)
+    {
+      int result;
+
+#if defined(__APPLE__)
+      // fsync on its own only reaches the drive's cache here.
+      (void)metadata;
+      result = fcntl(static_cast<int>(file), F_FULLFSYNC);
+#else
+      result = (metadata ? fsync(static_cast<int>(file)) : fdatasync(static_cast<int>(file)));
+#endif
+
+      if(result != 0)
+        throw File_Exception(E_IOERROR);
+    }
+
+    void SyncDirectory(const char* filename)
+    {
+      // Find the directory part of the name. No slash means the current directory.
+      const char* slash = std::strrchr(filename, '/');
+      char* directory;
+
+      try
+      {
+        if(slash == NULL)
+        {
+          directory = new char[2];
+          std::strcpy(directory, ".");
+        }
+        else
+        {
+          // Keep the slash if it's the root directory.
+          const std::size_t length = (slash == filename ? 1 : static_cast<std::size_t>(slash - filename));
+
+          directory = new char[length + 1];
+          std::memcpy(directory, filename, length);
+          directory[length] = '\0';
+        }
+      }
+      catch ( std::bad_alloc )
+      {
+        throw File_Exception(E_OUTOFMEMORY);
+      }
+
+      int file = open(directory, O_RDONLY);
+      delete [] directory;
+
+      if(file == -1)
+        throw File_Exception(E_IOERROR);
+
+      const int result = fsync(file);
+      close(file);
+
+      if(result != 0)
+        throw File_Exception(E_IOERROR);
+    }
+
+    Handle CreateTempFile(const char* filename, char*& tempName)
+    {
+      // Take on the permissions of the file being replaced, if there is one.
+      // Otherwise the umask decides, same as for any new file.
+      struct stat info;
+      const bool replacing = (stat(filename, &info) == 0);
+
+      for(unsigned attempt = 0; attempt < TempAttempts; ++attempt)
+      {
+        char* name = TempName(filename, static_cast<unsigned long>(getpid()), attempt);
+
+        int file = open(name, O_RDWR | O_CREAT | O_EXCL, 0666);
+
+        if(file != -1)
+        {
+          if(replacing)
+            fchmod(file, info.st_mode & 07777);
+
+          tempName = name;
+          return file;
+        }
+
+        delete [] name;
+
+        // Only a name that's already taken is worth trying again.
+        if(errno != EEXIST)
+          break;
+      }
+
+      throw File_Exception(E_FOPENERROR);
+    }
+
+    void RenameOver(const char* from, const char* to)
+    {
+      if(std::rename(from, to) != 0)
+        throw File_Exception(E_IOERROR);
+    }
+
+    char* MapFile(const char* filename, unsigned long long& size)
+    {
+      int file = static_cast<int>(OpenFile(filename, false, false));
+
+      struct stat info;
+      if(fstat(file, &info) != 0)
+      {
+        close(file);
+        throw File_Exception(E_FOPENERROR);
+      }
+
+      size = static_cast<unsigned long long>(info.st_size);
+
+      // Empty files can't be mapped.
+      if(size == 0)
+      {
+        close(file);
+        return NULL;
+      }
+
+      if(size > std::numeric_limits<std::size_t>::max())
+      {
+        close(file);
+        throw File_Exception(E_FILETOOLARGE);
+      }
+
+      void* view = mmap(NULL, static_cast<std::size_t>(size), PROT_READ, MAP_SHARED, file, 0);
+
+      // The mapping stays valid after the descriptor is closed.
+      close(file);
+
+      if(view == MAP_FAILED)
+        throw File_Exception(E_MMAPERROR);
+
+      return static_cast<char*>(view);
+    }
+
+    void UnmapFile(char* data, unsigned long long size)
+    {
+      if(data != NULL)
+        munmap(data, static_cast<std::size_t>(size));
+    }
+#endif
+  }
+}
\ No newline at end of file
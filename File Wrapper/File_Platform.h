@@ -0,0 +1,158 @@
+/* File_Platform.h
+ * Purpose: Keep the operating system specific parts of the File class
+ * (memory mapping, positioned reads and writes and the like) out of
+ * File_Wrapper.cpp.
+ */
+
+#ifndef FILE_PLATFORM_H
+#define FILE_PLATFORM_H
+
+#include "File_Exception.h"
+
+#include <cstddef>
+
+namespace File
+{
+  namespace Platform
+  {
+    // An open file. Holds a file descriptor, or a HANDLE on Windows.
+    typedef long long Handle;
+
+    // What OpenFile returns when it fails, and what a closed Handle should be set to.
+    const Handle InvalidHandle = -1;
+
+    /* Opens a file for positioned reading and writing. Never translates newlines.
+     *
+     * filename: The file to open.
+     * write: Whether the file will be written to.
+     * create: Whether to create the file if it doesn't exist.
+     *
+     * Throws: E_FOPENERROR - The file couldn't be opened.
+     */
+    Handle OpenFile(const char* filename, bool write, bool create) throw(File_Exception);
+
+    /* Closes a file opened by OpenFile. Does nothing with InvalidHandle.
+     */
+    void CloseFile(Handle file) throw();
+
+    /* Gets the size of a file. Works for files larger than 4 GB, unlike ftell.
+     *
+     * Throws: E_FOPENERROR - The size of the file couldn't be determined.
+     */
+    unsigned long long FileSize(Handle file) throw(File_Exception);
+    unsigned long long FileSize(const char* filename) throw(File_Exception);
+
+    /* Gets a number that roughly follows where a file is on the disk: its
+     * inode number, or its file index on Windows. Opening files in this
+     * order keeps the disk from seeking back and forth as much.
+     *
+     * Returns: 0 if it couldn't be found out. Never throws, since it's only a hint.
+     */
+    unsigned long long DiskOrder(const char* filename) throw();
+
+    /* Reads from a given position in the file, without a separate seek.
+     *
+     * Returns: How many bytes were read. Less than size only at the end of the file.
+     *
+     * Throws: E_IOERROR - The read failed.
+     */
+    std::size_t ReadAt(Handle file, void* buffer, std::size_t size, unsigned long long position) throw(File_Exception);
+
+    /* Writes to a given position in the file, without a separate seek.
+     * Either writes all of the data or throws.
+     *
+     * Throws: E_IOERROR - The write failed.
+     */
+    void WriteAt(Handle file, const void* buffer, std::size_t size, unsigned long long position) throw(File_Exception);
+
+    // A piece of memory to write. See: WriteGatherAt
+    struct Slice
+    {
+      const void* data;
+      std::size_t size;
+    };
+
+    /* Writes several pieces of memory one after another, from a given
+     * position in the file, in as few system calls as it can (pwritev where
+     * there is one). Either writes all of them or throws.
+     *
+     * Throws: E_IOERROR - The write failed.
+     */
+    void WriteGatherAt(Handle file, const Slice* slices, std::size_t count, unsigned long long position) throw(File_Exception);
+
+    /* Cuts off or extends a file to the given size.
+     *
+     * Throws: E_IOERROR - The size couldn't be changed.
+     */
+    void Truncate(Handle file, unsigned long long size) throw(File_Exception);
+
+    /* Reserves disk space for a file up front, without changing its size,
+     * so it doesn't get fragmented as it's written and running out of space
+     * shows up before anything is written. Does nothing where the file
+     * system can't do this.
+     *
+     * Throws: E_IOERROR - There isn't enough space on the disk.
+     */
+    void Preallocate(Handle file, unsigned long long size) throw(File_Exception);
+
+    /* Makes sure everything written to a file has reached the disk.
+     *
+     * metadata: Whether the file's metadata (like its modification time)
+     *           has to reach the disk too, or just what's needed to read
+     *           the data back.
+     *
+     * Throws: E_IOERROR - The disk reported an error.
+     */
+    void Sync(Handle file, bool metadata) throw(File_Exception);
+
+    /* Makes sure the directory holding a file has reached the disk, so that
+     * creating or renaming the file survives a crash. Does nothing where the
+     * rename itself is already written through.
+     *
+     * Throws: E_IOERROR - The disk reported an error.
+     */
+    void SyncDirectory(const char* filename) throw(File_Exception);
+
+    /* Creates a new, empty file next to another one (in the same directory,
+     * so it can be renamed over it). Takes on the other file's permissions
+     * if it exists.
+     *
+     * filename: The file to put the new file next to.
+     * tempName: Receives the name of the new file. Allocated with new[].
+     *
+     * Throws: E_FOPENERROR  - The file couldn't be created.
+     *         E_OUTOFMEMORY - new failed allocating tempName.
+     */
+    Handle CreateTempFile(const char* filename, char*& tempName) throw(File_Exception);
+
+    /* Renames a file, replacing whatever is at the new name. Other processes
+     * see either the old file or the new one, never anything in between.
+     *
+     * Throws: E_IOERROR - The file couldn't be renamed.
+     */
+    void RenameOver(const char* from, const char* to) throw(File_Exception);
+
+    /* Maps an entire file into memory as read-only.
+     *
+     * filename: The file to map.
+     * size: Receives the size of the file in bytes.
+     *
+     * Returns: The start of the mapping. NULL if the file is empty, since
+     *          empty files can't be mapped.
+     *
+     * Throws: E_FOPENERROR   - The file couldn't be opened.
+     *         E_FILETOOLARGE - The file doesn't fit in the address space.
+     *         E_MMAPERROR    - The operating system refused to map the file.
+     */
+    char* MapFile(const char* filename, unsigned long long& size) throw(File_Exception);
+
+    /* Releases a mapping made by MapFile.
+     *
+     * data: The start of the mapping.
+     * size: The size that MapFile returned.
+     */
+    void UnmapFile(char* data, unsigned long long size) throw();
+  }
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,124 @@
+#include "File_Range.h"
+#include "File_Wrapper.h"
+#include "File_ErrorCodes.h"
+
+#include <limits>
+#include <new>
+
+namespace File
+{
+  Range::Range(File& file, Position start, Position recordSize, char terminator) : file_(&file), start_(start),
+                                                                                   recordSize_(recordSize), terminator_(terminator)
+  {
+  }
+
+  Range::iterator Range::begin() const
+  {
+    return iterator(file_, start_, recordSize_, terminator_);
+  }
+
+  Range::iterator Range::end() const
+  {
+    return iterator();
+  }
+
+  Range::iterator::iterator() : file_(NULL), position_(0), next_(0), recordSize_(0), terminator_(0)
+  {
+  }
+
+  Range::iterator::iterator(File* file, Position position, Position recordSize, char terminator) : file_(file), position_(position), next_(position),
+                                                                                                   recordSize_(recordSize), terminator_(terminator)
+  {
+    ++*this;
+  }
+
+  Range::iterator::iterator(const iterator& rhs) : file_(rhs.file_), position_(rhs.position_), next_(rhs.next_),
+                                                   recordSize_(rhs.recordSize_), terminator_(rhs.terminator_),
+                                                   current_(rhs.current_)
+  {
+    try
+    {
+      spill_ = rhs.spill_;
+    }
+    catch ( std::bad_alloc )
+    {
+      throw File_Exception(E_OUTOFMEMORY);
+    }
+
+    Repoint(rhs);
+  }
+
+  Range::iterator& Range::iterator::operator=(const iterator& rhs)
+  {
+    try
+    {
+      spill_ = rhs.spill_;
+    }
+    catch ( std::bad_alloc )
+    {
+      throw File_Exception(E_OUTOFMEMORY);
+    }
+
+    file_       = rhs.file_;
+    position_   = rhs.position_;
+    next_       = rhs.next_;
+    recordSize_ = rhs.recordSize_;
+    terminator_ = rhs.terminator_;
+    current_    = rhs.current_;
+    Repoint(rhs);
+
+    return *this;
+  }
+
+  void Range::iterator::Repoint(const iterator& rhs)
+  {
+    // Copying spill_ moved it, so the view has to follow.
+    if(!rhs.spill_.empty() && rhs.current_.Size() > 0 && rhs.current_.begin() == &rhs.spill_[0])
+      current_ = View(&spill_[0], spill_.size());
+  }
+
+  Range::iterator::reference Range::iterator::operator*() const
+  {
+    return current_;
+  }
+
+  Range::iterator::pointer Range::iterator::operator->() const
+  {
+    return &current_;
+  }
+
+  Range::iterator& Range::iterator::operator++()
+  {
+    if(file_ == NULL)
+      return *this;
+
+    // Ran off the end of the file. A \n right at the end doesn't start another line.
+    if(next_ >= file_->fileSize_)
+    {
+      *this = iterator();
+      return *this;
+    }
+
+    position_ = next_;
+    current_  = file_->Piece(next_, (recordSize_ != 0 ? recordSize_ : std::numeric_limits<Position>::max()), recordSize_ == 0, terminator_, spill_);
+
+    return *this;
+  }
+
+  Range::iterator Range::iterator::operator++(int)
+  {
+    iterator old(*this);
+    ++*this;
+    return old;
+  }
+
+  bool Range::iterator::operator==(const iterator& rhs) const
+  {
+    return file_ == rhs.file_ && (file_ == NULL || position_ == rhs.position_);
+  }
+
+  bool Range::iterator::operator!=(const iterator& rhs) const
+  {
+    return !(*this == rhs);
+  }
+}
\ No newline at end of file
@@ -0,0 +1,101 @@
+/* File_Range.h
+ * Purpose: Go through a File a line or a record at a time with a
+ * range-based for, without copying each one out.
+ */
+
+#ifndef FILE_RANGE_H
+#define FILE_RANGE_H
+
+#include "File_Types.h"
+#include "File_Exception.h"
+#include "File_View.h"
+
+#include <cstddef>
+#include <iterator>
+#include <vector>
+
+namespace File
+{
+  class File;
+
+  // The lines or records of a File, from where the File's internal pointer
+  // was when the range was made. See: File::Lines, File::Records
+  //
+  // Each one is a View straight into the File's buffer, so nothing is copied
+  // and there's no limit on how long a line can be. The one exception is a
+  // streamed file, where a line or record that runs across windows is copied
+  // together into memory held by the iterator.
+  //
+  // Going through a range doesn't move the File's internal pointer. Each
+  // View is good until the iterator moves on (or, without MODE_STREAM, as
+  // long as File_View.h says), and writing to the File while going through
+  // it isn't allowed.
+  class Range
+  {
+  public:
+    // A single pass through the range. Works with the standard algorithms
+    // that only need input iterators.
+    class iterator
+    {
+    public:
+      typedef std::input_iterator_tag iterator_category;
+      typedef View                    value_type;
+      typedef std::ptrdiff_t          difference_type;
+      typedef const View*             pointer;
+      typedef const View&             reference;
+
+      // The end of a range.
+      iterator() throw();
+
+      iterator(const iterator& rhs) throw(File_Exception);
+      iterator& operator=(const iterator& rhs) throw(File_Exception);
+
+      reference operator*() const throw();
+      pointer operator->() const throw();
+
+      /* Moves on to the next line or record.
+       *
+       * Throws: E_IOERROR     - Paging in a window failed. (MODE_STREAM only)
+       *         E_OUTOFMEMORY - A line or record crossing windows didn't fit in memory. (MODE_STREAM only)
+       */
+      iterator& operator++() throw(File_Exception);
+      iterator operator++(int) throw(File_Exception);
+
+      // Iterators are equal if they're both at the end, or at the same place in the same File.
+      bool operator==(const iterator& rhs) const throw();
+      bool operator!=(const iterator& rhs) const throw();
+
+    private:
+      friend class Range;
+
+      iterator(File* file, Position position, Position recordSize, char terminator) throw(File_Exception);
+
+      // Points current_ at spill_, if that's where it was looking.
+      void Repoint(const iterator& rhs) throw();
+
+      File*    file_;       // NULL at the end.
+      Position position_;   // Where the current line or record starts.
+      Position next_;       // Where the one after it starts.
+      Position recordSize_; // 0 for lines.
+      char     terminator_;
+
+      View              current_;
+      std::vector<char> spill_; // Where a line or record crossing windows is put together.
+    };
+
+    iterator begin() const throw(File_Exception);
+    iterator end() const throw();
+
+  private:
+    friend class File;
+
+    Range(File& file, Position start, Position recordSize, char terminator) throw();
+
+    File*    file_;
+    Position start_;
+    Position recordSize_;
+    char     terminator_;
+  };
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,201 @@
+#include "File_RangeSet.h"
+#include "File_ErrorCodes.h"
+
+#include <new>
+#include <utility>
+
+namespace File
+{
+  RangeSet::RangeSet() : last_(ranges_.end()), covered_(0)
+  {
+  }
+
+  RangeSet::RangeSet(const RangeSet& rhs) : last_(ranges_.end()), covered_(0)
+  {
+    *this = rhs;
+  }
+
+  RangeSet& RangeSet::operator=(const RangeSet& rhs)
+  {
+    try
+    {
+      ranges_ = rhs.ranges_;
+    }
+    catch ( std::bad_alloc )
+    {
+      throw File_Exception(E_OUTOFMEMORY);
+    }
+
+    // Iterators can't be copied between maps.
+    last_    = ranges_.end();
+    covered_ = rhs.covered_;
+
+    return *this;
+  }
+
+  void RangeSet::Add(Position start, Position end)
+  {
+    // Empty range
+    if(start >= end)
+      return;
+
+    // Fast path: the range starts inside of (or right after) the last range added.
+    if(last_ != ranges_.end() && start >= last_->first && start <= last_->second)
+    {
+      // Already covered.
+      if(end <= last_->second)
+        return;
+
+      // Just make the last range longer if that doesn't run into the next one.
+      Ranges::iterator next = last_;
+      ++next;
+
+      if(next == ranges_.end() || end < next->first)
+      {
+        covered_ += end - last_->second;
+        last_->second = end;
+        return;
+      }
+    }
+
+    // Find the first range that could touch this one: the last range
+    // starting at or before start, if it reaches start.
+    Ranges::iterator it = ranges_.upper_bound(start);
+
+    if(it != ranges_.begin())
+    {
+      Ranges::iterator previous = it;
+      --previous;
+
+      if(previous->second >= start)
+        it = previous;
+    }
+
+    // Work out the merged range before changing anything, so the set is
+    // left alone if memory runs out.
+    Position newStart = start;
+    Position newEnd   = end;
+    Ranges::iterator stop = it;
+
+    while(stop != ranges_.end() && stop->first <= end)
+    {
+      if(stop->first < newStart)
+        newStart = stop->first;
+
+      if(stop->second > newEnd)
+        newEnd = stop->second;
+
+      ++stop;
+    }
+
+    // Reuse the first range if it already starts in the right place.
+    // Otherwise the merged range needs a new entry.
+    Ranges::iterator merged;
+
+    if(it != stop && it->first == newStart)
+    {
+      merged = it++;
+      covered_ -= merged->second - merged->first;
+    }
+    else
+    {
+      try
+      {
+        merged = ranges_.insert(it, Ranges::value_type(newStart, newEnd));
+      }
+      catch ( std::bad_alloc )
+      {
+        throw File_Exception(E_OUTOFMEMORY);
+      }
+    }
+
+    // Remove everything the merged range swallowed.
+    while(it != stop)
+    {
+      covered_ -= it->second - it->first;
+      ranges_.erase(it++);
+    }
+
+    merged->second = newEnd;
+    covered_ += newEnd - newStart;
+    last_ = merged;
+  }
+
+  void RangeSet::Truncate(Position end)
+  {
+    // Every range starting at or past end goes.
+    Ranges::iterator it = ranges_.lower_bound(end);
+
+    while(it != ranges_.end())
+    {
+      covered_ -= it->second - it->first;
+      ranges_.erase(it++);
+    }
+
+    // The last one left may still run past it.
+    if(!ranges_.empty())
+    {
+      Ranges::iterator last = ranges_.end();
+      --last;
+
+      if(last->second > end)
+      {
+        covered_ -= last->second - end;
+        last->second = end;
+      }
+    }
+
+    // The last range added may be gone.
+    last_ = ranges_.end();
+  }
+
+  void RangeSet::Clear()
+  {
+    ranges_.clear();
+    last_    = ranges_.end();
+    covered_ = 0;
+  }
+
+  void RangeSet::Swap(RangeSet& rhs)
+  {
+    // Swapping maps doesn't carry end() over, so remember which set had no
+    // last range and point it at its new end.
+    const bool noLast    = (last_ == ranges_.end());
+    const bool rhsNoLast = (rhs.last_ == rhs.ranges_.end());
+
+    ranges_.swap(rhs.ranges_);
+    std::swap(last_, rhs.last_);
+    std::swap(covered_, rhs.covered_);
+
+    if(rhsNoLast)
+      last_ = ranges_.end();
+
+    if(noLast)
+      rhs.last_ = rhs.ranges_.end();
+  }
+
+  bool RangeSet::Empty() const
+  {
+    return ranges_.empty();
+  }
+
+  Position RangeSet::Size() const
+  {
+    return covered_;
+  }
+
+  Position RangeSet::Count() const
+  {
+    return ranges_.size();
+  }
+
+  RangeSet::const_iterator RangeSet::begin() const
+  {
+    return ranges_.begin();
+  }
+
+  RangeSet::const_iterator RangeSet::end() const
+  {
+    return ranges_.end();
+  }
+}
\ No newline at end of file
@@ -0,0 +1,73 @@
+/* File_RangeSet.h
+ * Purpose: Keep track of which byte ranges of a file have been changed,
+ * so only those have to be written back out.
+ */
+
+#ifndef FILE_RANGESET_H
+#define FILE_RANGESET_H
+
+#include "File_Types.h"
+#include "File_Exception.h"
+
+#include <map>
+
+namespace File
+{
+  // A set of [start, end) byte ranges. Ranges that overlap or touch are
+  // merged together, so the set always holds as few ranges as possible.
+  class RangeSet
+  {
+  public:
+    // Goes through the ranges in order. first is the start, second is the end.
+    typedef std::map<Position, Position>::const_iterator const_iterator;
+
+    RangeSet() throw();
+    RangeSet(const RangeSet& rhs) throw(File_Exception);
+    RangeSet& operator=(const RangeSet& rhs) throw(File_Exception);
+
+    /* Adds the range [start, end) to the set. Adding right after the last
+     * range added (the usual case when writing sequentially) is O(1).
+     *
+     * Throws: E_OUTOFMEMORY - The set couldn't grow.
+     * Status after Throw: No change.
+     */
+    void Add(Position start, Position end) throw(File_Exception);
+
+    /* Removes everything at or past end from the set, for when the file
+     * gets shorter. A range running past end is cut off there.
+     */
+    void Truncate(Position end) throw();
+
+    /* Removes every range from the set.
+     */
+    void Clear() throw();
+
+    /* Swaps the ranges of two sets, without copying any of them.
+     */
+    void Swap(RangeSet& rhs) throw();
+
+    /* Whether or not the set has no ranges in it.
+     */
+    bool Empty() const throw();
+
+    /* Gets the total number of bytes covered by the set.
+     */
+    Position Size() const throw();
+
+    /* Gets the number of separate ranges in the set.
+     */
+    Position Count() const throw();
+
+    const_iterator begin() const throw();
+    const_iterator end() const throw();
+
+  private:
+    typedef std::map<Position, Position> Ranges;
+
+    Ranges           ranges_;  // Maps the start of every range to its end.
+    Ranges::iterator last_;    // The range that was added to last. ranges_.end() if none.
+    Position         covered_; // Total number of bytes in all ranges.
+  };
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,297 @@
+#include "File_Scan.h"
+
+#include <mutex>
+
+// SSE2 is always there on x64, and on x86 when the compiler is told so.
+// AVX2 is only used if the CPU running the program turns out to have it.
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+  #define FILE_SCAN_SSE2
+  #include <emmintrin.h>
+
+  #if defined(_MSC_VER)
+    #define FILE_SCAN_AVX2
+    #define FILE_TARGET_AVX2
+    #include <immintrin.h>
+    #include <intrin.h>
+  #elif defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+    #define FILE_SCAN_AVX2
+    #define FILE_TARGET_AVX2 __attribute__((target("avx2")))
+    #include <immintrin.h>
+  #endif
+#endif
+
+namespace File
+{
+  namespace Scan
+  {
+    namespace
+    {
+      typedef std::size_t (*FindFunction)(const char*, std::size_t, char);
+      typedef std::size_t (*FindPairFunction)(const char*, std::size_t, char, char, std::size_t);
+      typedef std::size_t (*SkipSpaceFunction)(const char*, std::size_t);
+
+      bool IsSpace(char character)
+      {
+        return character == ' ' || (character >= '\t' && character <= '\r');
+      }
+
+      std::size_t FindScalar(const char* data, std::size_t size, char character)
+      {
+        std::size_t i = 0;
+
+        while(i < size && data[i] != character)
+          ++i;
+
+        return i;
+      }
+
+      std::size_t FindPairScalar(const char* data, std::size_t size, char first, char last, std::size_t distance)
+      {
+        for(std::size_t i = 0; i + distance < size; ++i)
+        {
+          if(data[i] == first && data[i + distance] == last)
+            return i;
+        }
+
+        return size;
+      }
+
+      std::size_t SkipSpaceScalar(const char* data, std::size_t size)
+      {
+        std::size_t i = 0;
+
+        while(i < size && IsSpace(data[i]))
+          ++i;
+
+        return i;
+      }
+
+#ifdef FILE_SCAN_SSE2
+      // Where the lowest set bit of a non-zero mask is.
+      unsigned FirstBit(unsigned mask)
+      {
+#ifdef _MSC_VER
+        unsigned long index;
+        _BitScanForward(&index, mask);
+        return index;
+#else
+        return static_cast<unsigned>(__builtin_ctz(mask));
+#endif
+      }
+
+      std::size_t FindSSE2(const char* data, std::size_t size, char character)
+      {
+        const __m128i needle = _mm_set1_epi8(character);
+        std::size_t i = 0;
+
+        for(; i + 16 <= size; i += 16)
+        {
+          const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&data[i]));
+          const unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(block, needle)));
+
+          if(mask != 0)
+            return i + FirstBit(mask);
+        }
+
+        return i + FindScalar(&data[i], size - i, character);
+      }
+
+      std::size_t FindPairSSE2(const char* data, std::size_t size, char first, char last, std::size_t distance)
+      {
+        const __m128i firsts = _mm_set1_epi8(first);
+        const __m128i lasts  = _mm_set1_epi8(last);
+        std::size_t i = 0;
+
+        for(; distance < size && i + 16 <= size - distance; i += 16)
+        {
+          const __m128i starts = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&data[i]));
+          const __m128i ends   = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&data[i + distance]));
+          const __m128i both   = _mm_and_si128(_mm_cmpeq_epi8(starts, firsts), _mm_cmpeq_epi8(ends, lasts));
+          const unsigned mask  = static_cast<unsigned>(_mm_movemask_epi8(both));
+
+          if(mask != 0)
+            return i + FirstBit(mask);
+        }
+
+        return i + FindPairScalar(&data[i], size - i, first, last, distance);
+      }
+
+      std::size_t SkipSpaceSSE2(const char* data, std::size_t size)
+      {
+        // Whitespace is ' ', or \t through \r. Bytes past 0x7F compare as
+        // negative, so they never land in the range.
+        const __m128i space = _mm_set1_epi8(' ');
+        const __m128i low   = _mm_set1_epi8('\t' - 1);
+        const __m128i high  = _mm_set1_epi8('\r' + 1);
+        std::size_t i = 0;
+
+        for(; i + 16 <= size; i += 16)
+        {
+          const __m128i block   = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&data[i]));
+          const __m128i inRange = _mm_and_si128(_mm_cmpgt_epi8(block, low), _mm_cmplt_epi8(block, high));
+          const __m128i isSpace = _mm_or_si128(_mm_cmpeq_epi8(block, space), inRange);
+          const unsigned mask   = ~static_cast<unsigned>(_mm_movemask_epi8(isSpace)) & 0xFFFF;
+
+          if(mask != 0)
+            return i + FirstBit(mask);
+        }
+
+        return i + SkipSpaceScalar(&data[i], size - i);
+      }
+#endif
+
+#ifdef FILE_SCAN_AVX2
+      FILE_TARGET_AVX2 std::size_t FindAVX2(const char* data, std::size_t size, char character)
+      {
+        const __m256i needle = _mm256_set1_epi8(character);
+        std::size_t i = 0;
+
+        for(; i + 32 <= size; i += 32)
+        {
+          const __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&data[i]));
+          const unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(block, needle)));
+
+          if(mask != 0)
+            return i + FirstBit(mask);
+        }
+
+        return i + FindSSE2(&data[i], size - i, character);
+      }
+
+      FILE_TARGET_AVX2 std::size_t FindPairAVX2(const char* data, std::size_t size, char first, char last, std::size_t distance)
+      {
+        const __m256i firsts = _mm256_set1_epi8(first);
+        const __m256i lasts  = _mm256_set1_epi8(last);
+        std::size_t i = 0;
+
+        for(; distance < size && i + 32 <= size - distance; i += 32)
+        {
+          const __m256i starts = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&data[i]));
+          const __m256i ends   = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&data[i + distance]));
+          const __m256i both   = _mm256_and_si256(_mm256_cmpeq_epi8(starts, firsts), _mm256_cmpeq_epi8(ends, lasts));
+          const unsigned mask  = static_cast<unsigned>(_mm256_movemask_epi8(both));
+
+          if(mask != 0)
+            return i + FirstBit(mask);
+        }
+
+        return i + FindPairSSE2(&data[i], size - i, first, last, distance);
+      }
+
+      FILE_TARGET_AVX2 std::size_t SkipSpaceAVX2(const char* data, std::size_t size)
+      {
+        const __m256i space = _mm256_set1_epi8(' ');
+        const __m256i low   = _mm256_set1_epi8('\t' - 1);
+        const __m256i high  = _mm256_set1_epi8('\r' + 1);
+        std::size_t i = 0;
+
+        for(; i + 32 <= size; i += 32)
+        {
+          const __m256i block   = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&data[i]));
+          const __m256i inRange = _mm256_and_si256(_mm256_cmpgt_epi8(block, low), _mm256_cmpgt_epi8(high, block));
+          const __m256i isSpace = _mm256_or_si256(_mm256_cmpeq_epi8(block, space), inRange);
+          const unsigned mask   = ~static_cast<unsigned>(_mm256_movemask_epi8(isSpace));
+
+          if(mask != 0)
+            return i + FirstBit(mask);
+        }
+
+        return i + SkipSpaceSSE2(&data[i], size - i);
+      }
+
+      // Whether the CPU has AVX2, and the operating system saves the AVX
+      // registers on a context switch.
+      bool HasAVX2()
+      {
+#ifdef _MSC_VER
+        int info[4];
+
+        __cpuid(info, 0);
+        if(info[0] < 7)
+          return false;
+
+        __cpuid(info, 1);
+        const bool osSavesAVX = (info[2] & (1 << 27)) != 0 && (_xgetbv(0) & 6) == 6;
+
+        __cpuidex(info, 7, 0);
+        return osSavesAVX && (info[1] & (1 << 5)) != 0;
+#else
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx2") != 0;
+#endif
+      }
+#endif
+
+      // Picks the best versions for the CPU the program is running on.
+      struct Dispatch
+      {
+        FindFunction      find;
+        FindPairFunction  findPair;
+        SkipSpaceFunction skipSpace;
+        const char*       name;
+
+        Dispatch()
+        {
+#if defined(FILE_SCAN_AVX2)
+          if(HasAVX2())
+          {
+            find      = FindAVX2;
+            findPair  = FindPairAVX2;
+            skipSpace = SkipSpaceAVX2;
+            name      = "AVX2";
+            return;
+          }
+#endif
+#if defined(FILE_SCAN_SSE2)
+          find      = FindSSE2;
+          findPair  = FindPairSSE2;
+          skipSpace = SkipSpaceSSE2;
+          name      = "SSE2";
+#else
+          find      = FindScalar;
+          findPair  = FindPairScalar;
+          skipSpace = SkipSpaceScalar;
+          name      = "scalar";
+#endif
+        }
+      };
+
+      // Picked the first time any of them is used, which can be on any of
+      // the pool's threads, so it's made under call_once, the same as
+      // ThreadPool::Default.
+      std::once_flag  ChosenOnce;
+      const Dispatch* ChosenDispatch = NULL;
+
+      const Dispatch& Chosen()
+      {
+        std::call_once(ChosenOnce, []()
+        {
+          static const Dispatch chosen;
+          ChosenDispatch = &chosen;
+        });
+
+        return *ChosenDispatch;
+      }
+    }
+
+    std::size_t Find(const char* data, std::size_t size, char character)
+    {
+      return Chosen().find(data, size, character);
+    }
+
+    std::size_t FindPair(const char* data, std::size_t size, char first, char last, std::size_t distance)
+    {
+      return Chosen().findPair(data, size, first, last, distance);
+    }
+
+    std::size_t SkipSpace(const char* data, std::size_t size)
+    {
+      return Chosen().skipSpace(data, size);
+    }
+
+    const char* Implementation()
+    {
+      return Chosen().name;
+    }
+  }
+}
\ No newline at end of file
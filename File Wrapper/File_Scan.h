@@ -0,0 +1,47 @@
+/* File_Scan.h
+ * Purpose: Search through the buffer many bytes at a time, using the widest
+ * vector instructions the CPU running the program has.
+ */
+
+#ifndef FILE_SCAN_H
+#define FILE_SCAN_H
+
+#include <cstddef>
+
+namespace File
+{
+  namespace Scan
+  {
+    /* Finds the first occurrence of a character.
+     *
+     * data: Where to look.
+     * size: How many bytes to look through.
+     * character: What to look for.
+     *
+     * Returns: How far into data the character is. size if it isn't there.
+     */
+    std::size_t Find(const char* data, std::size_t size, char character) throw();
+
+    /* Finds the first place where first is followed, distance bytes later,
+     * by last. Checking both ends of a pattern at once rules out nearly
+     * every place it could start without comparing the rest of it.
+     *
+     * Returns: How far into data first is. size if there's no such place.
+     */
+    std::size_t FindPair(const char* data, std::size_t size, char first, char last, std::size_t distance) throw();
+
+    /* Finds the first character that isn't whitespace (' ', \t, \n, \v, \f
+     * or \r, the same as isspace in the "C" locale).
+     *
+     * Returns: How far into data the character is. size if it's all whitespace.
+     */
+    std::size_t SkipSpace(const char* data, std::size_t size) throw();
+
+    /* The name of the instruction set Find, FindPair and SkipSpace ended up using:
+     * "AVX2", "SSE2" or "scalar".
+     */
+    const char* Implementation() throw();
+  }
+}
+
+#endif
\ No newline at end of file
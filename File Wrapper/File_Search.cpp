@@ -0,0 +1,80 @@
+#include "File_Search.h"
+#include "File_Scan.h"
+
+#include <cstring>
+
+namespace File
+{
+  namespace
+  {
+    // How many places the first and last bytes can match without the rest
+    // before Horspool is considered, and how many bytes each one has to
+    // have been worth after that to keep going with FindPair.
+    const std::size_t FalseStartAllowance = 16;
+    const std::size_t BytesPerFalseStart  = 64;
+  }
+
+  Pattern::Pattern(const char* pattern, std::size_t length) : pattern_(pattern), length_(length)
+  {
+    for(unsigned i = 0; i < 256; ++i)
+      skip_[i] = length_;
+
+    // The last byte of the pattern is left out, so a match on it still moves on.
+    for(std::size_t i = 0; i + 1 < length_; ++i)
+      skip_[static_cast<unsigned char>(pattern_[i])] = length_ - 1 - i;
+  }
+
+  std::size_t Pattern::Find(const char* data, std::size_t size) const
+  {
+    if(length_ == 0)
+      return 0;
+
+    if(size < length_)
+      return size;
+
+    if(length_ == 1)
+      return Scan::Find(data, size, pattern_[0]);
+
+    const char first = pattern_[0];
+    const char last  = pattern_[length_ - 1];
+    std::size_t falseStarts = 0;
+
+    for(std::size_t start = 0; ; ++start)
+    {
+      start += Scan::FindPair(&data[start], size - start, first, last, length_ - 1);
+
+      if(start >= size)
+        return size;
+
+      // The ends match. Check the middle.
+      if(std::memcmp(&data[start + 1], &pattern_[1], length_ - 2) == 0)
+        return start;
+
+      // The ends keep matching on their own, so skip ahead instead.
+      if(++falseStarts > FalseStartAllowance && falseStarts * BytesPerFalseStart > start)
+        return Horspool(data, size, start + 1);
+    }
+  }
+
+  std::size_t Pattern::Length() const
+  {
+    return length_;
+  }
+
+  std::size_t Pattern::Horspool(const char* data, std::size_t size, std::size_t start) const
+  {
+    const unsigned char last = static_cast<unsigned char>(pattern_[length_ - 1]);
+
+    while(start + length_ <= size)
+    {
+      const unsigned char end = static_cast<unsigned char>(data[start + length_ - 1]);
+
+      if(end == last && std::memcmp(&data[start], pattern_, length_ - 1) == 0)
+        return start;
+
+      start += skip_[end];
+    }
+
+    return size;
+  }
+}
\ No newline at end of file
@@ -0,0 +1,51 @@
+/* File_Search.h
+ * Purpose: Find a run of bytes in a block of memory quickly, whatever the
+ * bytes are and however often they show up.
+ */
+
+#ifndef FILE_SEARCH_H
+#define FILE_SEARCH_H
+
+#include <cstddef>
+
+namespace File
+{
+  // A pattern to search for, set up once and then searched for as many
+  // times as needed, from as many threads as needed.
+  //
+  // Places the pattern could start are found with Scan::FindPair, checking
+  // its first and last bytes 16 or 32 places at a time. If those keep
+  // turning up without the rest of the pattern (say, searching text full
+  // of spaces for one space-padded word), it switches to Horspool, which
+  // skips ahead by up to the length of the pattern after each mismatch.
+  class Pattern
+  {
+  public:
+    /* pattern: The bytes to search for. Not copied, so they have to stay
+     *          around as long as the Pattern does.
+     * length: How many bytes are in the pattern.
+     */
+    Pattern(const char* pattern, std::size_t length) throw();
+
+    /* Finds the first place the pattern starts.
+     *
+     * Returns: How far into data the pattern is. size if it isn't there.
+     *          An empty pattern is found right at the start.
+     */
+    std::size_t Find(const char* data, std::size_t size) const throw();
+
+    /* How many bytes are in the pattern.
+     */
+    std::size_t Length() const throw();
+
+  private:
+    // Finds the pattern from start on, a skip at a time.
+    std::size_t Horspool(const char* data, std::size_t size, std::size_t start) const throw();
+
+    const char* pattern_;
+    std::size_t length_;
+    std::size_t skip_[256]; // How far Horspool moves on when the last byte compared is each value.
+  };
+}
+
+#endif
\ No newline at end of file
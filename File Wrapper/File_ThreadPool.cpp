@@ -0,0 +1,264 @@
+#include "File_ThreadPool.h"
+#include "File_ErrorCodes.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+namespace File
+{
+  namespace
+  {
+    // One ForEach, shared by every thread working on it. Held by the tasks
+    // as well as ForEach, since a task can start after the work's all done.
+    struct Indices
+    {
+      std::atomic<std::size_t> next; // The next index nobody has started.
+      std::size_t              count;
+
+      const std::function<void(std::size_t)>* function; // Only called while ForEach is waiting.
+
+      std::mutex              lock;
+      std::condition_variable finished;
+      std::size_t             remaining; // Indices not finished yet.
+      std::exception_ptr      error;     // The first thing function threw.
+
+      // Runs indices until there are none left to start.
+      void Work() throw()
+      {
+        for(std::size_t index; (index = next++) < count; )
+        {
+          std::exception_ptr thrown;
+
+          try
+          {
+            (*function)(index);
+          }
+          catch ( ... )
+          {
+            thrown = std::current_exception();
+          }
+
+          std::lock_guard<std::mutex> guard(lock);
+
+          if(thrown && !error)
+            error = thrown;
+
+          if(--remaining == 0)
+            finished.notify_all();
+        }
+      }
+    };
+
+    // Default is first reached from whichever threads get there first.
+    // VS2012 doesn't make function statics safely: it marks one as made
+    // before its constructor has finished, so another thread can use it
+    // half made. The pool is made under call_once instead, and so is
+    // everything else shared that's made on first use.
+    std::once_flag DefaultOnce;
+    ThreadPool*    DefaultPool = NULL;
+  }
+
+  struct ThreadPool::Workers
+  {
+    std::mutex              lock;
+    std::condition_variable wake; // A task was queued, or the pool is stopping.
+    std::condition_variable idle; // The last outstanding task finished.
+
+    std::deque<Task>         tasks;
+    std::vector<std::thread> threads;
+    unsigned                 outstanding; // Tasks queued or running.
+    bool                     stopping;
+
+    // What each thread runs until the pool stops.
+    void Work() throw();
+
+    // Lets the threads finish the queue, then waits for them to end.
+    void Stop() throw();
+  };
+
+  void ThreadPool::Workers::Work()
+  {
+    std::unique_lock<std::mutex> guard(lock);
+
+    for(;;)
+    {
+      while(tasks.empty() && !stopping)
+        wake.wait(guard);
+
+      // Only stop once the queue is empty, so nothing queued is dropped.
+      if(tasks.empty())
+        return;
+
+      Task task;
+      task.swap(tasks.front());
+      tasks.pop_front();
+
+      guard.unlock();
+
+      try
+      {
+        task();
+      }
+      catch ( ... )
+      {
+        // Tasks report their own errors. Keep the thread going.
+      }
+
+      // Let go of whatever the task held onto before anyone waiting wakes up.
+      task = Task();
+
+      guard.lock();
+
+      if(--outstanding == 0)
+        idle.notify_all();
+    }
+  }
+
+  void ThreadPool::Workers::Stop()
+  {
+    {
+      std::lock_guard<std::mutex> guard(lock);
+      stopping = true;
+    }
+
+    wake.notify_all();
+
+    for(std::size_t i = 0; i < threads.size(); ++i)
+      threads[i].join();
+  }
+
+  ThreadPool::ThreadPool(unsigned threads) : workers_(NULL)
+  {
+    if(threads == 0)
+      threads = std::thread::hardware_concurrency();
+
+    // hardware_concurrency can't always tell.
+    if(threads == 0)
+      threads = 1;
+
+    try
+    {
+      workers_ = new Workers;
+      workers_->outstanding = 0;
+      workers_->stopping    = false;
+      workers_->threads.reserve(threads);
+
+      for(unsigned i = 0; i < threads; ++i)
+        workers_->threads.push_back(std::thread(&Workers::Work, workers_));
+    }
+    catch ( std::bad_alloc )
+    {
+      if(workers_ != NULL)
+        workers_->Stop();
+
+      delete workers_;
+      throw File_Exception(E_OUTOFMEMORY);
+    }
+    catch ( std::system_error )
+    {
+      workers_->Stop();
+      delete workers_;
+      throw File_Exception(E_THREADERROR);
+    }
+  }
+
+  ThreadPool::~ThreadPool()
+  {
+    workers_->Stop();
+    delete workers_;
+  }
+
+  void ThreadPool::Run(const Task& task)
+  {
+    try
+    {
+      std::lock_guard<std::mutex> guard(workers_->lock);
+      workers_->tasks.push_back(task);
+      ++workers_->outstanding;
+    }
+    catch ( std::bad_alloc )
+    {
+      throw File_Exception(E_OUTOFMEMORY);
+    }
+
+    workers_->wake.notify_one();
+  }
+
+  void ThreadPool::Wait()
+  {
+    std::unique_lock<std::mutex> guard(workers_->lock);
+
+    while(workers_->outstanding != 0)
+      workers_->idle.wait(guard);
+  }
+
+  void ThreadPool::ForEach(std::size_t count, const std::function<void(std::size_t)>& function)
+  {
+    if(count == 0)
+      return;
+
+    std::shared_ptr<Indices> indices;
+
+    try
+    {
+      indices = std::make_shared<Indices>();
+    }
+    catch ( std::bad_alloc )
+    {
+      throw File_Exception(E_OUTOFMEMORY);
+    }
+
+    indices->next      = 0;
+    indices->count     = count;
+    indices->function  = &function;
+    indices->remaining = count;
+
+    // No more helpers than there are indices for them to take. If queueing
+    // one fails, the ones that made it and this thread do the work.
+    const std::size_t helpers = (count - 1 < Threads() ? count - 1 : Threads());
+
+    try
+    {
+      for(std::size_t i = 0; i < helpers; ++i)
+        Run([indices]() { indices->Work(); });
+    }
+    catch ( File_Exception )
+    {
+    }
+
+    indices->Work();
+
+    std::unique_lock<std::mutex> guard(indices->lock);
+
+    while(indices->remaining != 0)
+      indices->finished.wait(guard);
+
+    if(indices->error)
+      std::rethrow_exception(indices->error);
+  }
+
+  unsigned ThreadPool::Threads() const
+  {
+    return static_cast<unsigned>(workers_->threads.size());
+  }
+
+  ThreadPool& ThreadPool::Default()
+  {
+    // If starting the pool throws, the next call tries again.
+    std::call_once(DefaultOnce, []()
+    {
+      static ThreadPool pool;
+      DefaultPool = &pool;
+    });
+
+    return *DefaultPool;
+  }
+}
\ No newline at end of file
@@ -0,0 +1,85 @@
+/* File_ThreadPool.h
+ * Purpose: Run work on a fixed number of threads, so batches of files can
+ * be loaded and saved side by side without starting a thread for each one.
+ */
+
+#ifndef FILE_THREADPOOL_H
+#define FILE_THREADPOOL_H
+
+#include "File_Exception.h"
+
+#include <cstddef>
+#include <functional>
+
+namespace File
+{
+  // A fixed set of threads taking tasks off a queue, first in first out.
+  class ThreadPool
+  {
+  public:
+    // A piece of work. Anything it throws is caught and thrown away, so
+    // tasks have to report their own errors.
+    typedef std::function<void()> Task;
+
+    /* Starts the threads.
+     *
+     * threads: How many threads to run tasks on. 0 means one per core.
+     *          Waiting on the disk doesn't keep a core busy, so loading
+     *          files can go faster with more threads than cores.
+     *
+     * Throws: E_THREADERROR - A thread couldn't be started.
+     *         E_OUTOFMEMORY - new failed allocating the queue.
+     */
+    explicit ThreadPool(unsigned threads = 0) throw(File_Exception);
+
+    /* Finishes every task that's been queued, then stops the threads.
+     */
+    ~ThreadPool() throw();
+
+    /* Queues up a task to be run on one of the threads.
+     *
+     * Throws: E_OUTOFMEMORY - new failed adding the task to the queue.
+     */
+    void Run(const Task& task) throw(File_Exception);
+
+    /* Waits until every task queued so far has finished, including any
+     * they queued themselves. Don't call from one of the pool's tasks.
+     */
+    void Wait() throw();
+
+    /* Runs function(0) through function(count - 1), spread over the pool's
+     * threads and the calling thread, and waits for them all. Each thread
+     * takes the next index nobody has started yet as soon as it's free, so
+     * a thread that gets quick ones takes on more of them, and a busy pool
+     * just leaves more of the work to the calling thread. That also makes
+     * it fine to call from one of the pool's own tasks.
+     *
+     * Throws: E_OUTOFMEMORY - new failed queueing up the work.
+     *         Otherwise, the first thing function threw, once every index
+     *         that was started has finished.
+     */
+    void ForEach(std::size_t count, const std::function<void(std::size_t)>& function);
+
+    /* How many threads tasks are run on.
+     */
+    unsigned Threads() const throw();
+
+    /* A pool with one thread per core, for spreading work over every core.
+     * Started the first time it's needed.
+     *
+     * Throws: E_THREADERROR - A thread couldn't be started.
+     */
+    static ThreadPool& Default() throw(File_Exception);
+
+  private:
+    ThreadPool(const ThreadPool&);
+    ThreadPool& operator=(const ThreadPool&);
+
+    // The threads, the queue and the lock guarding them. Kept in the .cpp,
+    // along with <thread> and <mutex>.
+    struct Workers;
+    Workers* workers_;
+  };
+}
+
+#endif
\ No newline at end of file
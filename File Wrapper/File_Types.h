@@ -0,0 +1,20 @@
+/* File_Types.h
+ * Purpose: Types shared between the File headers.
+ */
+
+#ifndef FILE_TYPES_H
+#define FILE_TYPES_H
+
+namespace File
+{
+  // Positions and sizes inside of a file. 64 bits wide, so files larger than 4 GB work.
+  typedef unsigned long long Position;
+
+  // A distance forwards or backwards from a position in a file.
+  typedef long long Offset;
+
+  // What searches give back when there's nothing to find.
+  const Position NotFound = ~static_cast<Position>(0);
+}
+
+#endif
\ No newline at end of file
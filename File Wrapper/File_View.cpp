@@ -0,0 +1,118 @@
+#include "File_View.h"
+
+#include <cassert>
+#include <cstddef>
+
+namespace File
+{
+#ifdef FILE_CHECK_VIEWS
+  View::View() : data_(NULL), size_(0), check_(NULL), generation_(0)
+  {
+  }
+
+  View::View(const char* data, Position size, ViewCheck* check) : data_(data), size_(size), check_(check),
+                                                                  generation_(check != NULL ? check->generation : 0)
+  {
+    if(check_ != NULL)
+      ++check_->refs;
+  }
+
+  View::View(const char* data, Position size) : data_(data), size_(size), check_(NULL), generation_(0)
+  {
+  }
+
+  View::View(const View& rhs) : data_(rhs.data_), size_(rhs.size_), check_(rhs.check_), generation_(rhs.generation_)
+  {
+    if(check_ != NULL)
+      ++check_->refs;
+  }
+
+  View& View::operator=(const View& rhs)
+  {
+    // Take hold of theirs before letting go of ours, in case they're the same.
+    if(rhs.check_ != NULL)
+      ++rhs.check_->refs;
+
+    if(check_ != NULL && --check_->refs == 0)
+      delete check_;
+
+    data_       = rhs.data_;
+    size_       = rhs.size_;
+    check_      = rhs.check_;
+    generation_ = rhs.generation_;
+
+    return *this;
+  }
+
+  View::~View()
+  {
+    if(check_ != NULL && --check_->refs == 0)
+      delete check_;
+  }
+
+  bool View::Stale() const
+  {
+    return check_ != NULL && check_->generation != generation_;
+  }
+
+  void View::Check() const
+  {
+    assert(!Stale() && "View used after its File's buffer went away");
+  }
+#else
+  View::View() : data_(NULL), size_(0)
+  {
+  }
+
+  View::View(const char* data, Position size) : data_(data), size_(size)
+  {
+  }
+
+  View::View(const char* data, Position size, ViewCheck*) : data_(data), size_(size)
+  {
+  }
+
+  bool View::Stale() const
+  {
+    return false;
+  }
+
+  void View::Check() const
+  {
+  }
+#endif
+
+  const char* View::Data() const
+  {
+    Check();
+    return data_;
+  }
+
+  Position View::Size() const
+  {
+    return size_;
+  }
+
+  bool View::Empty() const
+  {
+    return size_ == 0;
+  }
+
+  char View::operator[](Position index) const
+  {
+    Check();
+    return data_[index];
+  }
+
+  const char* View::begin() const
+  {
+    Check();
+    return data_;
+  }
+
+  const char* View::end() const
+  {
+    Check();
+    return data_ + size_;
+  }
+}
\ No newline at end of file
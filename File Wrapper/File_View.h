@@ -0,0 +1,97 @@
+/* File_View.h
+ * Purpose: Look at part of a File's buffer in place, without copying it out.
+ */
+
+#ifndef FILE_VIEW_H
+#define FILE_VIEW_H
+
+#include "File_Types.h"
+
+// Debug builds check that views aren't used after the memory they point
+// into has gone away.
+#ifndef NDEBUG
+  #define FILE_CHECK_VIEWS
+#endif
+
+namespace File
+{
+  class File;
+
+  // Debug builds only. Shared between a File and the views into its buffer.
+  // The File bumps generation whenever the memory the views point into
+  // goes away, and whoever lets go of it last deletes it.
+  struct ViewCheck
+  {
+    unsigned long refs;
+    unsigned long generation;
+  };
+
+  // Part of a File's buffer, looked at in place. See: File::ReadView
+  //
+  // A view points straight into the File's memory, so it's only good until
+  // that memory goes away: until the File is closed, opened, destroyed or
+  // written to (writing can grow or copy the buffer), or, with MODE_STREAM,
+  // pages in another window. Writing also changes what the view shows if
+  // the buffer stays put. So does any call that closes the gap an Insert or
+  // Erase leaves in the buffer, even one that only reads: Contents, a
+  // ReadView or GetLineView that runs into the gap, FindEverywhere, saving,
+  // and so on. Debug builds assert if a view is used after any of that.
+  class View
+  {
+  public:
+    // An empty view.
+    View() throw();
+
+    // A view of any memory. Never checked, even in debug builds.
+    View(const char* data, Position size) throw();
+
+#ifdef FILE_CHECK_VIEWS
+    View(const View& rhs) throw();
+    View& operator=(const View& rhs) throw();
+    ~View() throw();
+#endif
+
+    /* Gets the first byte of the view. Not null-terminated.
+     */
+    const char* Data() const throw();
+
+    /* Gets how many bytes are in the view.
+     */
+    Position Size() const throw();
+
+    /* Whether there's nothing in the view.
+     */
+    bool Empty() const throw();
+
+    /* Gets one of the bytes in the view. index isn't checked.
+     */
+    char operator[](Position index) const throw();
+
+    // So views work with range-based for and the standard algorithms.
+    const char* begin() const throw();
+    const char* end() const throw();
+
+    /* Whether the memory the view points at has gone away, so using it
+     * would assert. Always false in release builds, which don't keep track.
+     */
+    bool Stale() const throw();
+
+  private:
+    friend class File;
+
+    View(const char* data, Position size, ViewCheck* check) throw();
+
+    // Asserts that the memory is still there. Does nothing in release builds.
+    void Check() const throw();
+
+    const char* data_;
+    Position    size_;
+
+#ifdef FILE_CHECK_VIEWS
+    ViewCheck*    check_;      // NULL if there's nothing to check.
+    unsigned long generation_; // check_->generation when the view was made.
+#endif
+  };
+}
+
+#endif
\ No newline at end of file
@@ -1,11 +1,18 @@
 #include "File_Wrapper.h"
 #include "File_ErrorCodes.h"
+#include "File_Platform.h"
+#include "File_Newlines.h"
+#include "File_Scan.h"
+#include "File_ThreadPool.h"
+#include "File_Parse.h"
 
 #include <cstring>
 #include <cstdio>
 #include <cctype>
 #include <exception>
 #include <limits>
+#include <new>
+#include <utility>
 
 // Undefine the seek defines for this file so we can use them.
 #undef SEEK_SET
@@ -23,13 +30,57 @@ namespace File
     // How much to grow the buffer by when going over the buffer size.
     const float GrowthSize = 1.5f;
 
-    char* CopyString(const char* str)
+    // The largest buffer that can be allocated in this process.
+    const Position MaxBufferSize = std::numeric_limits<size_t>::max();
+
+    // How much of the file to fread at once when opening it.
+    const Position ReadChunkSize = 64 * 1024 * 1024;
+
+    // How much of a streamed file is kept in memory, unless told otherwise.
+    const Position DefaultWindowSize = 4 * 1024 * 1024;
+
+    // How much of a streamed file WriteFile copies at once.
+    const Position CopyChunkSize = 1024 * 1024;
+
+    // How much of the file to index lines in at once. Small enough that
+    // going to an early line doesn't index much more than it needs to.
+    const Position IndexChunkSize = 64 * 1024;
+
+    // Files this large are searched on every core at once.
+    const Position ParallelSearchSize = 8 * 1024 * 1024;
+
+    // How many pieces each thread gets when searching, on average.
+    const std::size_t SearchPiecesPerThread = 4;
+
+    // Past this many separate changed ranges, rewriting the whole file is
+    // cheaper than writing each one in place.
+    const Position MaxDirtyRanges = 4096;
+
+    char* CopyString(const char* str, Allocator& allocator)
     {
-      unsigned len = strlen(str);
-      char* ret = new char[len + 1];
+      size_t len = strlen(str);
+      char* ret = allocator.Allocate(len + 1);
       strcpy(ret, str);
       return ret;
     }
+
+    void FreeString(char* str, Allocator& allocator)
+    {
+      allocator.Free(str, strlen(str) + 1);
+    }
+
+    // Whitespace the way isspace sees it in the "C" locale.
+    bool IsSpace(char character)
+    {
+      return character == ' ' || static_cast<unsigned>(character - '\t') < 5;
+    }
+
+    // Parse::Number for a T, in a form File::Parser can point to.
+    template <typename T>
+    ParseResult ParseAs(const char*& at, const char* end, void* value)
+    {
+      return Parse::Number(at, end, *static_cast<T*>(value));
+    }
   }
 
   File::File()
@@ -38,7 +89,9 @@ namespace File
     throw File_Exception();
   }
 
-  File::File(const char* filename, Mode mode) : open_(false)
+  File::File(const char* filename, Mode mode, Allocator& allocator) : open_(false), allocator_(&allocator), buffer_(NULL),
+                                                                      stream_(Platform::InvalidHandle), windowSize_(Utils::DefaultWindowSize),
+                                                                      durability_(DURABLE_NONE), pieces_(NULL), packed_(NULL), gapStart_(0), gapSize_(0), views_(NULL)
   {
     // Can't call the constructor with the same mode as 'before'.
     if(mode == MODE_SAME)
@@ -47,12 +100,41 @@ namespace File
     Open(filename, mode);
   }
 
-  File::File(const File& rhs) : open_(false)
+  File::File(const char* filename, Mode mode, Allocator& allocator, Buffer* loaded, Position loadedSize)
+    : open_(false), allocator_(&allocator), buffer_(NULL), stream_(Platform::InvalidHandle), windowSize_(Utils::DefaultWindowSize),
+      durability_(DURABLE_NONE), pieces_(NULL), packed_(NULL), gapStart_(0), gapSize_(0), views_(NULL)
+  {
+    try
+    {
+      Open(filename, mode, loaded, loadedSize);
+    }
+    catch ( File_Exception )
+    {
+      // Never got as far as taking it over.
+      if(buffer_ != loaded)
+        loaded->Release();
+
+      throw;
+    }
+  }
+
+  File::File(const File& rhs) : open_(false), allocator_(rhs.allocator_), buffer_(NULL),
+                                stream_(Platform::InvalidHandle), windowSize_(Utils::DefaultWindowSize),
+                                durability_(DURABLE_NONE), pieces_(NULL), packed_(NULL), gapStart_(0), gapSize_(0), views_(NULL)
   {
     // Copy over the information.
     CopyStatus(rhs);
   }
 
+  File::File(File&& rhs) : open_(false), allocator_(rhs.allocator_), filename_(NULL), buffer_(NULL), file_(NULL),
+                           fileSize_(0), bufferSize_(0), currentPos_(0), protectEnd_(0), mode_(MODE_SAME),
+                           stream_(Platform::InvalidHandle), windowStart_(0), windowSize_(Utils::DefaultWindowSize),
+                           durability_(DURABLE_NONE), diskSize_(0), pieces_(NULL), packed_(NULL), rewrite_(false), gapStart_(0), gapSize_(0), views_(NULL)
+  {
+    // Start off closed and trade places with rhs.
+    Swap(rhs);
+  }
+
   File& File::operator=(const File& rhs)
   {
     // Close our current file
@@ -64,13 +146,63 @@ namespace File
     return *this;
   }
 
+  File& File::operator=(File&& rhs)
+  {
+    // Our current file ends up in temp, which closes it on the way out.
+    File temp(std::move(rhs));
+    Swap(temp);
+
+    return *this;
+  }
+
+  void File::Swap(File& rhs)
+  {
+    std::swap(open_,       rhs.open_);
+    std::swap(allocator_,  rhs.allocator_);
+    std::swap(filename_,   rhs.filename_);
+    std::swap(buffer_,     rhs.buffer_);
+    std::swap(file_,       rhs.file_);
+    std::swap(fileSize_,   rhs.fileSize_);
+    std::swap(bufferSize_, rhs.bufferSize_);
+    std::swap(currentPos_, rhs.currentPos_);
+    std::swap(protectEnd_, rhs.protectEnd_);
+    std::swap(mode_,       rhs.mode_);
+
+    std::swap(stream_,      rhs.stream_);
+    std::swap(windowStart_, rhs.windowStart_);
+    std::swap(windowSize_,  rhs.windowSize_);
+    std::swap(durability_,  rhs.durability_);
+    std::swap(diskSize_,    rhs.diskSize_);
+    std::swap(pieces_,      rhs.pieces_);
+    std::swap(packed_,      rhs.packed_);
+
+    dirty_.Swap(rhs.dirty_);
+    std::swap(rewrite_, rhs.rewrite_);
+    std::swap(gapStart_, rhs.gapStart_);
+    std::swap(gapSize_,  rhs.gapSize_);
+    lines_.Swap(rhs.lines_);
+    journal_.Swap(rhs.journal_);
+
+    // The views go with the buffer they point into.
+    std::swap(views_, rhs.views_);
+  }
+
   File::~File()
   {
     // Close the file
     Close();
+
+    // The views may outlive us, in which case the last of them deletes it.
+    if(views_ != NULL && --views_->refs == 0)
+      delete views_;
   }
 
   void File::Open(const char* filename, Mode mode)
+  {
+    Open(filename, mode, NULL, 0);
+  }
+
+  void File::Open(const char* filename, Mode mode, Buffer* loaded, Position loadedSize)
   {
     // If we have a file open, close it
     Close();
@@ -85,75 +217,263 @@ namespace File
       mode = mode_;
     }
 
-    // Reset the status
-    try
+    // A streamed file is written in place, so it can't be replaced atomically.
+    // Pieces are always saved by replacing the file, so that's fine.
+    if((mode & MODE_ATOMIC) && (mode & MODE_STREAM) && !(mode & MODE_PIECES))
+      throw File_Exception(E_BADFLAGS);
+
+    // A compressed file is unpacked into memory, so it can't be mapped or streamed.
+    if((mode & MODE_COMPRESSED) && (mode & (MODE_MMAP | MODE_STREAM)))
+      throw File_Exception(E_BADFLAGS);
+
+    // Reset the status. Only CopyString can throw.
+    open_       = false;
+    filename_   = Utils::CopyString(filename, *allocator_);
+    buffer_     = NULL;
+    file_       = NULL;
+    fileSize_   = 0;
+    bufferSize_ = 0;
+    currentPos_ = 0;
+    protectEnd_ = 0;
+    mode_       = mode;
+
+    stream_      = Platform::InvalidHandle;
+    windowStart_ = 0;
+    diskSize_    = 0;
+    pieces_      = NULL;
+    packed_      = NULL;
+    rewrite_     = false;
+    gapStart_    = 0;
+    gapSize_     = 0;
+    dirty_.Clear();
+    lines_.Clear();
+    journal_.Clear();
+
+    // Map the file rather than reading it in, if we were asked to. A cleared
+    // file is empty, so there's nothing worth mapping.
+    if((mode & MODE_MMAP) && !(mode & MODE_CLEAR))
     {
-      open_       = false;
-      filename_   = Utils::CopyString(filename);
-      file_       = NULL;
-      fileSize_   = 0;
-      bufferSize_ = 0;
-      currentPos_ = 0;
-      protectEnd_ = 0;
-      mode_       = mode;
+      // fopen is still what creates the file if it doesn't exist.
+      if(mode & MODE_CREATE)
+      {
+        std::FILE* file = std::fopen(filename, "ab");
+
+        if(file != NULL)
+          std::fclose(file);
+      }
+
+      Position size = 0;
+
+      try
+      {
+        // Empty files don't get a mapping.
+        char* mapping = Platform::MapFile(filename, size);
+
+        if(mapping != NULL)
+        {
+          buffer_ = Buffer::Adopt(mapping, size, *allocator_);
+          file_   = buffer_->Data();
+        }
+      }
+      catch ( File_Exception )
+      {
+        Utils::FreeString(filename_, *allocator_);
+        throw;
+      }
+
+      fileSize_   = size;
+      bufferSize_ = size;
     }
-    catch ( std::bad_alloc ) // CopyString can throw.
+    else if(mode & MODE_STREAM)
     {
-      throw File_Exception(E_OUTOFMEMORY);
-    }
+      // Keep the file open, so windows can be paged in and out of it. With
+      // pieces, it's only ever read from.
+      const bool write = (mode & MODE_WRITE) && !(mode & MODE_PIECES);
 
-    // Determine the mode for fopen.
-    char fopenMode[4] = {(mode & MODE_CREATE ? 'a' : 'r'), (mode & MODE_TEXT ? 't' : 'b') , '+', '\0'};
+      try
+      {
+        stream_   = Platform::OpenFile(filename, write, (mode & MODE_CREATE) != 0);
+        diskSize_ = Platform::FileSize(stream_);
+
+        if(mode & MODE_PIECES)
+        {
+          try
+          {
+            pieces_ = new PieceTable;
+          }
+          catch ( std::bad_alloc )
+          {
+            throw File_Exception(E_OUTOFMEMORY);
+          }
+
+          pieces_->Attach(filename, stream_, diskSize_);
+        }
+      }
+      catch ( File_Exception )
+      {
+        Platform::CloseFile(stream_);
+        stream_ = Platform::InvalidHandle;
+        Utils::FreeString(filename_, *allocator_);
+        throw;
+      }
 
-    // Open the file for reading into our buffer.
-    std::FILE* file = std::fopen(filename, fopenMode);
+      // A cleared file starts off empty. What's left on disk gets cut off
+      // when the file is saved. The window is allocated when it's first used.
+      fileSize_ = (mode & MODE_CLEAR ? 0 : diskSize_);
 
-    if(file == NULL)
-    {
-      delete [] filename_;
-      throw File_Exception(E_FOPENERROR);
+      if(pieces_ != NULL)
+        pieces_->Reset(fileSize_);
     }
+    else if(mode & MODE_COMPRESSED)
+    {
+      // Only the index is read for now. The blocks are unpacked into the
+      // buffer as they're used.
+      Position size = 0;
 
-    // If we're clearing the file, pretend the size is 0.
-    long size = 0;
+      try
+      {
+        Platform::Handle file = Platform::OpenFile(filename, false, (mode & MODE_CREATE) != 0);
+
+        if(mode & MODE_CLEAR)
+        {
+          Platform::CloseFile(file);
+        }
+        else
+        {
+          try
+          {
+            packed_ = new Packed(file);
+          }
+          catch ( std::bad_alloc )
+          {
+            Platform::CloseFile(file);
+            throw File_Exception(E_OUTOFMEMORY);
+          }
+          catch ( File_Exception )
+          {
+            Platform::CloseFile(file);
+            throw;
+          }
+
+          size = packed_->Size();
+
+          if(size > Utils::MaxBufferSize)
+            throw File_Exception(E_FILETOOLARGE);
+        }
+
+        buffer_ = Buffer::Allocate(size, *allocator_);
+        file_   = buffer_->Data();
+      }
+      catch ( File_Exception )
+      {
+        delete packed_;
+        packed_ = NULL;
+        Utils::FreeString(filename_, *allocator_);
+        throw;
+      }
 
-    if((mode & MODE_CLEAR) == 0)
-    {
-      // Otherwise, get how large the file is (Maximum size of INT_MAX)
-      std::fseek(file, 0, SEEK_END);
-      size = std::ftell(file);
-      if(static_cast<unsigned long>(size) > std::numeric_limits<unsigned>::max())
+      // An empty file has nothing to unpack.
+      if(packed_ != NULL && packed_->Unpacked())
       {
-        delete [] filename_;
-        std::fclose(file);
-        throw File_Exception(E_FILETOOLARGE);
+        delete packed_;
+        packed_ = NULL;
       }
-    }
 
-    // Allocate memory for the buffer. Always allocate extra in case newline
-    // endings get translated to be longer than original.
-    bufferSize_ = static_cast<unsigned>((size + 1) * 2);
-    
-    try
-    {
-      file_ = new char[bufferSize_];
+      // The file is always packed again as a whole, so only whether it
+      // changed matters, not where.
+      fileSize_   = size;
+      bufferSize_ = size;
+      diskSize_   = size;
+      rewrite_    = (mode & MODE_CLEAR) != 0;
     }
-    catch ( std::bad_alloc )
+    else if(loaded != NULL)
     {
-      delete [] filename_;
-      std::fclose(file);
-      throw File_Exception(E_OUTOFMEMORY);
+      // Read in already (see: OpenAsync), into a buffer as large as the file was.
+      buffer_     = loaded;
+      file_       = loaded->Data();
+      bufferSize_ = loaded->Size();
+      fileSize_   = loadedSize;
+
+      FinishLoad(bufferSize_);
     }
+    else
+    {
+      // Determine the mode for fopen. Always binary, since we translate
+      // newlines ourselves.
+      char fopenMode[4] = {(mode & MODE_CREATE ? 'a' : 'r'), 'b', '+', '\0'};
 
-    // Move the pointer back to start and read the file into the buffer.
-    // Set fileSize_ here, since if there's newlines that get translated,
-    // ftell doesn't change to reflect that. fread will give an accurate file
-    // size.
-    std::rewind(file);
-    fileSize_ = std::fread(file_, sizeof(char), bufferSize_, file);
+      // Open the file for reading into our buffer.
+      std::FILE* file = std::fopen(filename, fopenMode);
 
-    // Close the file
-    std::fclose(file);
+      if(file == NULL)
+      {
+        Utils::FreeString(filename_, *allocator_);
+        throw File_Exception(E_FOPENERROR);
+      }
+
+      // If we're clearing the file, pretend the size is 0.
+      Position size = 0;
+
+      if((mode & MODE_CLEAR) == 0)
+      {
+        // Otherwise, get how large the file is. ftell can't go past 2 GB
+        // everywhere, so ask the operating system.
+        try
+        {
+          size = Platform::FileSize(filename);
+        }
+        catch ( File_Exception )
+        {
+          Utils::FreeString(filename_, *allocator_);
+          std::fclose(file);
+          throw;
+        }
+
+        if(size > Utils::MaxBufferSize)
+        {
+          Utils::FreeString(filename_, *allocator_);
+          std::fclose(file);
+          throw File_Exception(E_FILETOOLARGE);
+        }
+      }
+
+      // Allocate memory for the buffer. Translating newlines only ever makes
+      // the file shorter, so it's exactly the size of the file.
+      bufferSize_ = size;
+
+      try
+      {
+        buffer_ = Buffer::Allocate(bufferSize_, *allocator_);
+        file_   = buffer_->Data();
+      }
+      catch ( File_Exception )
+      {
+        Utils::FreeString(filename_, *allocator_);
+        std::fclose(file);
+        throw;
+      }
+
+      // Move the pointer back to start and read the file into the buffer.
+      // Read in chunks, since not every fread copes with reading gigabytes
+      // at once.
+      std::rewind(file);
+
+      for(;;)
+      {
+        const size_t toRead = static_cast<size_t>(mindef(Utils::ReadChunkSize, bufferSize_ - fileSize_));
+        const size_t bytesRead = std::fread(&file_[fileSize_], sizeof(char), toRead, file);
+
+        fileSize_ += bytesRead;
+
+        if(bytesRead < toRead || fileSize_ == bufferSize_)
+          break;
+      }
+
+      // Close the file
+      std::fclose(file);
+
+      FinishLoad(size);
+    }
 
     // File is now opened.
     open_ = true;
@@ -167,6 +487,21 @@ namespace File
       protectEnd_ = currentPos_;
   }
 
+  void File::FinishLoad(Position size)
+  {
+    // Text mode reads \r\n in as \n.
+    const Position loadedSize = fileSize_;
+
+    if(mode_ & MODE_TEXT)
+      fileSize_ = Newlines::ToLF(file_, static_cast<size_t>(fileSize_));
+
+    // A cleared file gets completely rewritten, and so does one whose
+    // positions don't match the disk because newlines were translated.
+    // Writing in place can't be atomic, so atomic saves always rewrite.
+    diskSize_ = size;
+    rewrite_  = (mode_ & MODE_CLEAR) || fileSize_ != loadedSize || AlwaysRewrites();
+  }
+
   void File::Close(bool save)
   {
     // If we're not open, don't do anything.
@@ -174,17 +509,202 @@ namespace File
       return;
 
     // If we're in write mode, write out the file.
-    if(save && (mode_ & MODE_WRITE))
-      WriteFile(filename_);
+    if(save)
+      Flush();
+
+    // The pieces let go of the file before it's closed.
+    delete pieces_;
+    pieces_ = NULL;
+    delete packed_;
+    packed_ = NULL;
+
+    if(stream_ != Platform::InvalidHandle)
+    {
+      Platform::CloseFile(stream_);
+      stream_ = Platform::InvalidHandle;
+    }
 
     // Free the memory
-    delete [] filename_;
-    delete [] file_;
+    Utils::FreeString(filename_, *allocator_);
+    FreeBuffer();
+    journal_.Clear();
     open_ = false;
   }
 
+  void File::Flush()
+  {
+    // Nothing to write out.
+    if(open_ == false || !(mode_ & MODE_WRITE))
+      return;
+
+    // A compressed file is packed again whole, and only if it changed, so
+    // blocks that were never used don't have to be unpacked.
+    if(mode_ & MODE_COMPRESSED)
+    {
+      if(rewrite_ || !dirty_.Empty() || fileSize_ != diskSize_)
+        WriteFile(filename_);
+
+      dirty_.Clear();
+      diskSize_ = fileSize_;
+      rewrite_  = false;
+      return;
+    }
+
+    CloseGap();
+
+    if(pieces_ != NULL)
+    {
+      // Everything but the current window is already in the pieces.
+      FlushWindow();
+      SavePieces();
+    }
+    else if(stream_ != Platform::InvalidHandle)
+    {
+      // Everything but the current window is already on disk.
+      FlushWindow();
+
+      // A cleared file can still be longer on disk than it's supposed to be.
+      if(diskSize_ > fileSize_)
+      {
+        Platform::Truncate(stream_, fileSize_);
+        diskSize_ = fileSize_;
+      }
+
+      SyncFile(stream_);
+    }
+    else
+    {
+      // Write just the changes if we can, otherwise the whole file.
+      if(rewrite_ || !WriteChanges())
+        WriteFile(filename_);
+
+      // The file on disk matches the buffer now.
+      dirty_.Clear();
+      diskSize_ = fileSize_;
+      rewrite_  = AlwaysRewrites();
+    }
+  }
+
+  bool File::WriteChanges()
+  {
+    // When most of the file changed, one big write beats lots of small ones.
+    if(dirty_.Size() > fileSize_ / 2 || dirty_.Count() > Utils::MaxDirtyRanges)
+      return false;
+
+    Platform::Handle file = Platform::InvalidHandle;
+
+    try
+    {
+      file = Platform::OpenFile(filename_, true, false);
+
+      // If someone else changed the size of the file, what's on disk isn't
+      // what we think it is.
+      if(Platform::FileSize(file) != diskSize_)
+      {
+        Platform::CloseFile(file);
+        return false;
+      }
+    }
+    catch ( File_Exception )
+    {
+      // The file was deleted since it was opened. WriteFile will re-create it.
+      Platform::CloseFile(file);
+      return false;
+    }
+
+    try
+    {
+      // Nothing past the end of the file is written, in case a range was
+      // left running past it. Anything past the end of the buffer isn't part
+      // of the file anymore, so the file is cut off there if the range or the
+      // file on disk went any further.
+      bool pastEnd = fileSize_ < diskSize_;
+
+      for(RangeSet::const_iterator range = dirty_.begin(); range != dirty_.end(); ++range)
+      {
+        pastEnd |= (range->second > fileSize_);
+
+        if(range->first < fileSize_)
+          Platform::WriteAt(file, &file_[range->first], static_cast<size_t>(mindef(range->second, fileSize_) - range->first), range->first);
+      }
+
+      if(pastEnd)
+        Platform::Truncate(file, fileSize_);
+
+      SyncFile(file);
+    }
+    catch ( File_Exception )
+    {
+      Platform::CloseFile(file);
+      throw;
+    }
+
+    Platform::CloseFile(file);
+    return true;
+  }
+
+  void File::FreeBuffer()
+  {
+    if(buffer_ != NULL)
+      buffer_->Release();
+
+    buffer_  = NULL;
+    file_    = NULL;
+    gapSize_ = 0;
+    InvalidateViews();
+  }
+
+  View File::MakeView(const char* data, Position size)
+  {
+#ifdef FILE_CHECK_VIEWS
+    // Made the first time it's needed. If it can't be, views just go unchecked.
+    if(views_ == NULL)
+    {
+      views_ = new (std::nothrow) ViewCheck;
+
+      if(views_ != NULL)
+      {
+        views_->refs       = 1;
+        views_->generation = 0;
+      }
+    }
+#endif
+
+    return View(data, size, views_);
+  }
+
+  void File::InvalidateViews() const
+  {
+    if(views_ != NULL)
+      ++views_->generation;
+  }
+
+  void File::Unshare()
+  {
+    if(buffer_ == NULL || !buffer_->Shared())
+      return;
+
+    Buffer* copy = Buffer::Allocate(bufferSize_, *allocator_);
+
+    // Only the part holding the file (and the gap in it) means anything.
+    const Position used = (fileSize_ > windowStart_ ? mindef(bufferSize_, fileSize_ + gapSize_ - windowStart_) : 0);
+
+    if(used > 0)
+      std::memcpy(copy->Data(), file_, static_cast<size_t>(used));
+
+    FreeBuffer();
+    buffer_ = copy;
+    file_   = copy->Data();
+  }
+
   void File::CopyStatus(const File& rhs)
   {
+    // The buffer is shared, so it has to be in one piece for both of us.
+    rhs.CloseGap();
+
+    // Use the same memory as rhs. We're closed, so nothing is allocated from ours.
+    allocator_ = rhs.allocator_;
+
     // rhs has no file opened. Don't do anything.
     if(rhs.open_ == false)
     {
@@ -192,30 +712,63 @@ namespace File
       return;
     }
 
-    // Copy over the filename and buffer.
-    try
-    {
-      unsigned len = strlen(rhs.filename_);
-      filename_ = new char[len + 1];
-      strcpy(filename_, rhs.filename_);
-    }
-    catch ( std::bad_alloc ) // New failed
+    // Copy over the filename.
+    filename_ = Utils::CopyString(rhs.filename_, *allocator_);
+
+    // A streamed file gets its own handle to the file.
+    stream_ = Platform::InvalidHandle;
+
+    if(rhs.stream_ != Platform::InvalidHandle)
     {
-      throw File_Exception(E_OUTOFMEMORY);
+      try
+      {
+        stream_ = Platform::OpenFile(filename_, (rhs.mode_ & MODE_WRITE) && rhs.pieces_ == NULL, false);
+      }
+      catch ( File_Exception )
+      {
+        Utils::FreeString(filename_, *allocator_);
+        throw;
+      }
     }
 
+    // And its own copy of the edits, on top of the same original. A
+    // compressed file was unpacked by CloseGap, so there's nothing left to share.
+    pieces_ = NULL;
+    packed_ = NULL;
+
     try
     {
-      // Copy the file over as-is.
-      file_ = new char[rhs.bufferSize_];
-      memcpy(file_, rhs.file_, rhs.bufferSize_);
+      if(rhs.pieces_ != NULL)
+      {
+        try
+        {
+          pieces_ = new PieceTable(*rhs.pieces_);
+        }
+        catch ( std::bad_alloc )
+        {
+          throw File_Exception(E_OUTOFMEMORY);
+        }
+
+        pieces_->Attach(filename_, stream_, rhs.diskSize_);
+      }
+
+      dirty_ = rhs.dirty_;
     }
-    catch ( std::bad_alloc ) // New failed
+    catch ( File_Exception )
     {
-      delete [] filename_;
-      throw File_Exception(E_OUTOFMEMORY);
+      delete pieces_;
+      pieces_ = NULL;
+      Platform::CloseFile(stream_);
+      stream_ = Platform::InvalidHandle;
+      Utils::FreeString(filename_, *allocator_);
+      throw;
     }
 
+    // Share the file (or window). Whichever of us writes to it first makes a
+    // copy of its own then. A mapping is shared too, since it's read-only.
+    buffer_ = (rhs.buffer_ != NULL ? rhs.buffer_->Share() : NULL);
+    file_   = rhs.file_;
+
     // Copy over the status
     fileSize_   = rhs.fileSize_;
     bufferSize_ = rhs.bufferSize_;
@@ -223,10 +776,27 @@ namespace File
     protectEnd_ = rhs.protectEnd_;
     mode_       = rhs.mode_;
     open_       = true;
+
+    windowStart_ = rhs.windowStart_;
+    windowSize_  = rhs.windowSize_;
+    durability_  = rhs.durability_;
+    diskSize_    = rhs.diskSize_;
+    rewrite_     = rhs.rewrite_;
+
+    // The line index gets rebuilt if it's needed.
+    lines_.Clear();
   }
 
   void File::ApplyDefaults(Mode& mode)
   {
+    // Mappings are read-only.
+    if(mode & MODE_MMAP)
+      mode = static_cast<Mode>((mode & (~MODE_WRITE)) | MODE_READ);
+
+    // Pieces are paged in a window at a time, the same as streaming.
+    if(mode & MODE_PIECES)
+      mode = static_cast<Mode>(mode | MODE_STREAM);
+
     // Apply read/write defaults
     if( (!(mode & MODE_READ) && !(mode & MODE_WRITE)) || // Neither specified
         ( (mode & MODE_READ) &&  (mode & MODE_WRITE)) )  // Both specified (invalid)
@@ -263,180 +833,1640 @@ namespace File
 
   void File::WriteFile(const char* filename) const
   {
-    // Determine the translation mode
-    char mode[3] = {'w', (mode_ & MODE_TEXT ? 't' : 'b'), '\0'};
+    // Writing a streamed file over itself would cut it off before it's read.
+    if(stream_ != Platform::InvalidHandle && std::strcmp(filename, filename_) == 0)
+      throw File_Exception(E_BADFLAGS);
 
-    // Open the file for writing
-    std::FILE* file = std::fopen(filename, mode);
+    CloseGap();
 
-    if(file == NULL)
-      throw File_Exception(E_FOPENERROR);
+    // An atomic save goes to a temporary file that replaces the real one
+    // once it's complete. Otherwise the file is written over directly.
+    const bool atomic = (mode_ & MODE_ATOMIC) != 0;
+    char* tempName = NULL;
 
-    // Write out the buffer
-    std::fwrite(file_, sizeof(char), fileSize_, file);
+    Platform::Handle file = (atomic ? Platform::CreateTempFile(filename, tempName)
+                                    : Platform::OpenFile(filename, true, true));
 
-    // Close the file.
-    std::fclose(file);
-  }
+    try
+    {
+      // Reserve the space first, so the file is laid out in one piece and
+      // a full disk is noticed before anything is overwritten. How large a
+      // compressed file ends up isn't known until it's packed.
+      if(!(mode_ & MODE_COMPRESSED))
+        Platform::Preallocate(file, fileSize_);
 
-  bool File::EndOfFile() const
-  {
-    return currentPos_ == fileSize_;
-  }
+      // Cut off whatever was in the file past the new end.
+      Platform::Truncate(file, WriteContents(file));
 
-  char File::GetChar(bool ignoreWhitespace)
-  {
-    // If we're at EOF, do nothing.
-    if(EndOfFile())
-      return 0;
+      SyncFile(file);
+    }
+    catch ( File_Exception )
+    {
+      Platform::CloseFile(file);
 
-    char nextChar = 0;
+      if(atomic)
+      {
+        std::remove(tempName);
+        delete [] tempName;
+      }
 
-    do
+      throw;
+    }
+
+    Platform::CloseFile(file);
+
+    if(atomic)
     {
-      nextChar = file_[currentPos_++];
-    } while ( ignoreWhitespace && std::isspace(static_cast<int>(nextChar)) && !EndOfFile() );
+      try
+      {
+        Platform::RenameOver(tempName, filename);
+      }
+      catch ( File_Exception )
+      {
+        std::remove(tempName);
+        delete [] tempName;
+        throw;
+      }
 
-    return nextChar;
-  }
+      delete [] tempName;
+    }
 
-  unsigned File::GetPos(void) const
-  {
-    return currentPos_;
+    // The file's name has to reach the disk too, if it was just created or renamed.
+    if(durability_ == DURABLE_FULL)
+      Platform::SyncDirectory(filename);
   }
 
-  unsigned File::GetString(char* outputString, unsigned maxLength, char terminator)
+  Position File::WriteContents(Platform::Handle file) const
   {
-    // Skip the white space before the string. Text mode only, since 
-    // ' ' could be meaningful in binary mode.
-    if(mode_ & MODE_TEXT)
-    {
-      // Skip the current whitespace
-      char checkChar = file_[currentPos_];
+    if(mode_ & MODE_COMPRESSED)
+      return Compress::Pack(file, file_, fileSize_);
 
-      while(std::isspace(static_cast<int>(checkChar)))
-        checkChar = file_[++currentPos_];
-    }
+    const bool translate = (mode_ & MODE_TEXT) && (mode_ & MODE_CRLF);
 
-    // Take off 1 on the max length to account for null terminator
-    --maxLength;
+    // A buffer that's written as-is goes out in one go.
+    if(stream_ == Platform::InvalidHandle && !translate)
+    {
+      Platform::WriteAt(file, file_, static_cast<size_t>(fileSize_), 0);
+      return fileSize_;
+    }
 
-    // We're at the start of the string. Continue until we find terminator.
-    unsigned stringStart = currentPos_;
+    // The pieces go out together, followed by whatever in the current window
+    // hasn't been put into them yet.
+    if(pieces_ != NULL)
+    {
+      pieces_->WriteTo(file);
 
-    // Note the ; at the end of the statement
-    while(file_[++currentPos_] != terminator && !EndOfFile() && currentPos_ - stringStart < maxLength);
+      for(RangeSet::const_iterator range = dirty_.begin(); range != dirty_.end(); ++range)
+        Platform::WriteAt(file, &file_[range->first - windowStart_], static_cast<size_t>(range->second - range->first), range->first);
 
-    // Copy the string over to their memory
-    memcpy(outputString, &file_[stringStart], currentPos_ - stringStart);
+      return fileSize_;
+    }
 
-    // Set the null terminator
-    outputString[currentPos_ - stringStart] = 0;
+    // Otherwise copy it over a chunk at a time. When translating, the chunk
+    // has room after it for the translated copy, which is at most twice as long.
+    char* chunk;
 
-    // Return how many bytes we read in. (+1 for Null terminator)
-    return currentPos_ - stringStart + 1;
+    try
+    {
+      chunk = new char[static_cast<size_t>(Utils::CopyChunkSize * (translate ? 3 : 1))];
+    }
+    catch( std::bad_alloc )
+    {
+      throw File_Exception(E_OUTOFMEMORY);
+    }
+
+    const Position windowEnd = (file_ != NULL ? mindef(windowStart_ + bufferSize_, fileSize_) : windowStart_);
+    Position written = 0;
+
+    try
+    {
+      for(Position position = 0; position < fileSize_; )
+      {
+        const size_t count = static_cast<size_t>(mindef(Utils::CopyChunkSize, fileSize_ - position));
+        const char* source = chunk;
+
+        if(stream_ == Platform::InvalidHandle)
+        {
+          source = &file_[position];
+        }
+        else
+        {
+          // Take anything in the current window from the window, since it
+          // may not be saved yet. Anything past the end on disk has to be
+          // in the window.
+          const size_t bytesRead = Platform::ReadAt(stream_, chunk, count, position);
+          std::memset(&chunk[bytesRead], 0, count - bytesRead);
+
+          const Position overlapStart = maxdef(position, windowStart_);
+          const Position overlapEnd   = mindef(position + count, windowEnd);
+
+          if(overlapStart < overlapEnd)
+            std::memcpy(&chunk[overlapStart - position], &file_[overlapStart - windowStart_], static_cast<size_t>(overlapEnd - overlapStart));
+        }
+
+        if(translate)
+        {
+          char* translated = &chunk[static_cast<size_t>(Utils::CopyChunkSize)];
+          const size_t length = Newlines::ToCRLF(source, count, translated);
+
+          Platform::WriteAt(file, translated, length, written);
+          written += length;
+        }
+        else
+        {
+          Platform::WriteAt(file, source, count, written);
+          written += count;
+        }
+
+        position += count;
+      }
+    }
+    catch ( File_Exception )
+    {
+      delete [] chunk;
+      throw;
+    }
+
+    delete [] chunk;
+    return written;
+  }
+
+  bool File::AlwaysRewrites() const
+  {
+    return (mode_ & MODE_ATOMIC) || ((mode_ & MODE_TEXT) && (mode_ & MODE_CRLF));
+  }
+
+  void File::SyncFile(Platform::Handle file) const
+  {
+    if(durability_ != DURABLE_NONE)
+      Platform::Sync(file, durability_ == DURABLE_FULL);
+  }
+
+  void File::SetDurability(Durability durability)
+  {
+    durability_ = durability;
+  }
+
+  void File::SetWindowSize(Position size)
+  {
+    if(size == 0)
+      throw File_Exception(E_INVALIDSIZE);
+
+    // Write out the current window and let the next access page in one of the new size.
+    if(stream_ != Platform::InvalidHandle)
+      DropWindow();
+
+    windowSize_ = size;
+  }
+
+  Position File::Readable(Position position)
+  {
+    // Only the block position is in gets unpacked.
+    if(packed_ != NULL)
+      return (position < fileSize_ ? Unpack(position, position + 1) - position : 0);
+
+    // The whole file is in the buffer, in two pieces if there's a gap in it.
+    if(stream_ == Platform::InvalidHandle)
+      return (gapSize_ != 0 && position < gapStart_ ? gapStart_ : fileSize_) - position;
+
+    if(position >= fileSize_)
+      return 0;
+
+    if(file_ == NULL || position < windowStart_ || position - windowStart_ >= bufferSize_)
+      LoadWindow(position);
+
+    const Position windowEnd = windowStart_ + bufferSize_;
+    return mindef(windowEnd, fileSize_) - position;
+  }
+
+  Position File::Writable(Position position, Position numBytes)
+  {
+    // Writing over a compressed file only unpacks the blocks written to.
+    // Growing it unpacks the rest, when the buffer is resized.
+    if(packed_ != NULL && position + numBytes <= fileSize_)
+    {
+      Unpack(position, position + numBytes);
+      Unshare();
+      return numBytes;
+    }
+
+    if(stream_ == Platform::InvalidHandle)
+    {
+      const Position writeEnd = position + numBytes;
+
+      // Writing over the file goes in either side of the gap, stopping at
+      // it if it's in the way. Only making the file longer closes it.
+      if(gapSize_ != 0 && writeEnd <= fileSize_)
+      {
+        Unshare();
+        return (position < gapStart_ ? mindef(numBytes, gapStart_ - position) : numBytes);
+      }
+
+      CloseGap();
+
+      // Grow the buffer once for the whole write.
+      if(writeEnd > bufferSize_)
+      {
+        const double grownSize = writeEnd * static_cast<double>(Utils::GrowthSize);
+        Resize(grownSize < Utils::MaxBufferSize ? static_cast<Position>(grownSize) : Utils::MaxBufferSize);
+      }
+
+      // Growing always gives us a buffer of our own, but otherwise a copy
+      // may still be using it.
+      Unshare();
+      return numBytes;
+    }
+
+    if(file_ == NULL || position < windowStart_ || position - windowStart_ >= bufferSize_)
+      LoadWindow(position);
+
+    Unshare();
+
+    const Position room = windowStart_ + bufferSize_ - position;
+    return mindef(room, numBytes);
+  }
+
+  void File::LoadWindow(Position position)
+  {
+    // Windows always start on a multiple of the window size.
+    const Position start = position - position % windowSize_;
+
+    // Write out what's changed before the window gets reused.
+    FlushWindow();
+
+    // Whatever happens, the old window's contents are gone.
+    InvalidateViews();
+
+    // A copy may still be looking at the old window, so leave it to them
+    // and read the new one into a buffer of our own.
+    if(buffer_ != NULL && buffer_->Shared())
+      FreeBuffer();
+
+    if(file_ == NULL)
+    {
+      buffer_     = Buffer::Allocate(windowSize_, *allocator_);
+      file_       = buffer_->Data();
+      bufferSize_ = windowSize_;
+    }
+
+    // Everything in the file outside of the window is on disk, so read in
+    // whatever part of the new window is inside the file.
+    const Position length = (fileSize_ > start ? mindef(windowSize_, fileSize_ - start) : 0);
+
+    try
+    {
+      const size_t bytesRead = (pieces_ != NULL ? pieces_->Read(start, file_, static_cast<size_t>(length))
+                                                : Platform::ReadAt(stream_, file_, static_cast<size_t>(length), start));
+
+      // Someone else cut the file short. Treat the missing part as zeroes.
+      std::memset(&file_[bytesRead], 0, static_cast<size_t>(length) - bytesRead);
+    }
+    catch ( File_Exception )
+    {
+      // The window is only partly read, so throw it away.
+      FreeBuffer();
+      bufferSize_ = 0;
+      throw;
+    }
+
+    windowStart_ = start;
+  }
+
+  void File::FlushWindow()
+  {
+    // Only the current window can have changes, since the others were
+    // written out when they were paged out.
+    // With pieces, the changes go into the piece table instead.
+    for(RangeSet::const_iterator range = dirty_.begin(); range != dirty_.end(); ++range)
+    {
+      if(pieces_ != NULL)
+      {
+        pieces_->Write(range->first, &file_[range->first - windowStart_], range->second - range->first);
+        continue;
+      }
+
+      Platform::WriteAt(stream_, &file_[range->first - windowStart_], static_cast<size_t>(range->second - range->first), range->first);
+      diskSize_ = maxdef(diskSize_, range->second);
+    }
+
+    dirty_.Clear();
+  }
+
+  void File::DropWindow()
+  {
+    FlushWindow();
+    FreeBuffer();
+    bufferSize_  = 0;
+    windowStart_ = 0;
+  }
+
+  void File::SavePieces()
+  {
+    // Nothing to replace the file with.
+    if(!pieces_->Edited())
+      return;
+
+    // Write the new file out next to the original, which is still being read from.
+    char* tempName = NULL;
+    Platform::Handle file = Platform::CreateTempFile(filename_, tempName);
+
+    try
+    {
+      Platform::Preallocate(file, pieces_->Size());
+      pieces_->WriteTo(file);
+      SyncFile(file);
+    }
+    catch ( File_Exception )
+    {
+      Platform::CloseFile(file);
+      std::remove(tempName);
+      delete [] tempName;
+      throw;
+    }
+
+    Platform::CloseFile(file);
+
+    // The original has to be let go of before it can be replaced everywhere.
+    pieces_->Detach();
+    Platform::CloseFile(stream_);
+    stream_ = Platform::InvalidHandle;
+
+    bool renamed = true;
+
+    try
+    {
+      Platform::RenameOver(tempName, filename_);
+    }
+    catch ( File_Exception )
+    {
+      std::remove(tempName);
+      renamed = false;
+    }
+
+    delete [] tempName;
+
+    // The file is what the pieces were now, so they start over as just the file.
+    if(renamed)
+      pieces_->Reset(pieces_->Size());
+
+    // Pick up whichever file is there now: the new one, or the original if
+    // it couldn't be replaced.
+    stream_   = Platform::OpenFile(filename_, false, false);
+    diskSize_ = Platform::FileSize(stream_);
+    pieces_->Attach(filename_, stream_, diskSize_);
+
+    if(!renamed)
+      throw File_Exception(E_IOERROR);
+
+    if(durability_ == DURABLE_FULL)
+      Platform::SyncDirectory(filename_);
+  }
+
+  bool File::EndOfFile() const
+  {
+    return currentPos_ == fileSize_;
+  }
+
+  char File::GetChar(bool ignoreWhitespace)
+  {
+    // If we're at EOF, do nothing.
+    if(EndOfFile())
+      return 0;
+
+    char nextChar = 0;
+
+    do
+    {
+      // Make sure the character is in the buffer
+      Readable(currentPos_);
+      nextChar = *At(currentPos_);
+      ++currentPos_;
+    } while ( ignoreWhitespace && std::isspace(static_cast<int>(nextChar)) && !EndOfFile() );
+
+    return nextChar;
+  }
+
+  Position File::GetPos(void) const
+  {
+    return currentPos_;
+  }
+
+  unsigned File::GetString(char* outputString, unsigned maxLength, char terminator)
+  {
+    // Skip the white space before the string. Text mode only, since 
+    // ' ' could be meaningful in binary mode.
+    if(mode_ & MODE_TEXT)
+      SkipWhitespace();
+
+    // Take off 1 on the max length to account for null terminator
+    --maxLength;
+
+    // We're at the start of the string. Continue until we find terminator.
+    // Never look past the end of the file, since a mapped file has nothing
+    // after its last byte.
+    const Position stringStart = currentPos_;
+    const Position stringEnd   = (fileSize_ - stringStart > maxLength ? stringStart + maxLength : fileSize_);
+    unsigned length = 0;
+
+    // The first character is always part of the string, even if it's the terminator.
+    if(currentPos_ < stringEnd)
+    {
+      Readable(currentPos_);
+      outputString[length++] = *At(currentPos_);
+      ++currentPos_;
+    }
+
+    // Go through the buffer a window at a time, since the string can cross
+    // windows when streaming.
+    while(currentPos_ < stringEnd)
+    {
+      Position available = Readable(currentPos_);
+      available = mindef(available, stringEnd - currentPos_);
+
+      const char* window = At(currentPos_);
+      const Position count = Scan::Find(window, static_cast<size_t>(available), terminator);
+
+      // Copy this part of the string over to their memory
+      memcpy(&outputString[length], window, static_cast<size_t>(count));
+      length      += static_cast<unsigned>(count);
+      currentPos_ += count;
+
+      // Stopped on the terminator.
+      if(count < available)
+        break;
+    }
+
+    // Set the null terminator
+    outputString[length] = 0;
+
+    // Return how many bytes we read in. (+1 for Null terminator)
+    return length + 1;
+  }
+
+  void File::SkipWhitespace()
+  {
+    // Skip the current whitespace, a window at a time.
+    for(Position available; currentPos_ < fileSize_ && (available = Readable(currentPos_)) > 0; )
+    {
+      const Position skipped = Scan::SkipSpace(At(currentPos_), static_cast<size_t>(available));
+      currentPos_ += skipped;
+
+      if(skipped < available)
+        break;
+    }
+  }
+
+  ParseResult File::ReadInt(int& value)
+  {
+    return ParseNext(Utils::ParseAs<int>, &value);
+  }
+
+  ParseResult File::ReadInt(long long& value)
+  {
+    return ParseNext(Utils::ParseAs<long long>, &value);
+  }
+
+  ParseResult File::ReadUInt(unsigned& value)
+  {
+    return ParseNext(Utils::ParseAs<unsigned>, &value);
+  }
+
+  ParseResult File::ReadUInt(unsigned long long& value)
+  {
+    return ParseNext(Utils::ParseAs<unsigned long long>, &value);
+  }
+
+  ParseResult File::ReadDouble(double& value)
+  {
+    return ParseNext(Utils::ParseAs<double>, &value);
+  }
+
+  Position File::ReadInts(int* values, Position count)
+  {
+    return ParseMany(Utils::ParseAs<int>, values, sizeof(*values), count);
+  }
+
+  Position File::ReadInts(long long* values, Position count)
+  {
+    return ParseMany(Utils::ParseAs<long long>, values, sizeof(*values), count);
+  }
+
+  Position File::ReadDoubles(double* values, Position count)
+  {
+    return ParseMany(Utils::ParseAs<double>, values, sizeof(*values), count);
+  }
+
+  ParseResult File::ParseNext(Parser parser, void* value)
+  {
+    if(mode_ & MODE_TEXT)
+      SkipWhitespace();
+
+    if(currentPos_ >= fileSize_)
+      return PARSE_ENDOFFILE;
+
+    const Position available = Readable(currentPos_);
+    const char* start = At(currentPos_);
+    const char* end   = start + available;
+
+    // A number running on into the next window has to be put together
+    // first. Numbers are short, so this hardly ever happens.
+    std::vector<char> spill;
+
+    if(currentPos_ + available < fileSize_ && Parse::TokenLength(start, static_cast<size_t>(available)) == available)
+    {
+      try
+      {
+        spill.assign(start, end);
+
+        for(Position position = currentPos_ + available; position < fileSize_; )
+        {
+          const Position more  = Readable(position);
+          const char* window   = At(position);
+          const Position taken = Parse::TokenLength(window, static_cast<size_t>(more));
+
+          spill.insert(spill.end(), window, window + taken);
+          position += taken;
+
+          if(taken < more)
+            break;
+        }
+      }
+      catch(std::bad_alloc&)
+      {
+        throw File_Exception(E_OUTOFMEMORY);
+      }
+
+      start = &spill[0];
+      end   = start + spill.size();
+    }
+
+    const char* at = start;
+    const ParseResult result = parser(at, end, value);
+
+    currentPos_ += at - start;
+    return result;
+  }
+
+  Position File::ParseMany(Parser parser, void* values, std::size_t size, Position count)
+  {
+    char* value = static_cast<char*>(values);
+    Position read = 0;
+
+    // A file in memory is all in one piece, so the numbers can be read one
+    // after another without coming back out to check on windows.
+    if(stream_ == Platform::InvalidHandle)
+    {
+      CloseGap();
+
+      const char* at  = file_ + currentPos_;
+      const char* end = file_ + fileSize_;
+      const bool text = (mode_ & MODE_TEXT) != 0;
+
+      for(; read < count; ++read, value += size)
+      {
+        if(text && at < end && Utils::IsSpace(*at))
+          at += Scan::SkipSpace(at, end - at);
+
+        if(parser(at, end, value) != PARSE_OK)
+          break;
+      }
+
+      currentPos_ = at - file_;
+      return read;
+    }
+
+    for(; read < count && ParseNext(parser, value) == PARSE_OK; ++read)
+      value += size;
+
+    return read;
+  }
+
+  ParseResult File::ReadToken(char* output, unsigned maxLength)
+  {
+    if(mode_ & MODE_TEXT)
+      SkipWhitespace();
+
+    if(currentPos_ >= fileSize_)
+      return PARSE_ENDOFFILE;
+
+    // Take off 1 on the max length to account for null terminator
+    --maxLength;
+    unsigned length = 0;
+    bool ended = false;
+
+    // Copy it over a window at a time, up to the whitespace.
+    while(length < maxLength && currentPos_ < fileSize_)
+    {
+      Position available = Readable(currentPos_);
+      available = mindef(available, maxLength - length);
+
+      const char* window = At(currentPos_);
+      const Position count = Parse::TokenLength(window, static_cast<size_t>(available));
+
+      memcpy(&output[length], window, static_cast<size_t>(count));
+      length      += static_cast<unsigned>(count);
+      currentPos_ += count;
+
+      if(count < available)
+      {
+        ended = true;
+        break;
+      }
+    }
+
+    output[length] = 0;
+
+    if(length == 0 && ended)
+      return PARSE_INVALID;
+
+    // Ran out of room before the whitespace or the end of the file.
+    if(!ended && currentPos_ < fileSize_)
+    {
+      Readable(currentPos_);
+
+      if(!Utils::IsSpace(*At(currentPos_)))
+        return PARSE_OUTOFRANGE;
+    }
+
+    return PARSE_OK;
+  }
+
+  unsigned File::GetLine(Position line, char* outputString, unsigned maxLength)
+  {
+    SeekToLine(line);
+
+    // Take off 1 on the max length to account for null terminator
+    --maxLength;
+    unsigned length = 0;
+
+    // Copy the line over a window at a time, up to the \n.
+    while(length < maxLength && currentPos_ < fileSize_)
+    {
+      Position available = Readable(currentPos_);
+      available = mindef(available, maxLength - length);
+
+      const char* window = At(currentPos_);
+      const Position count = Scan::Find(window, static_cast<size_t>(available), '\n');
+
+      memcpy(&outputString[length], window, static_cast<size_t>(count));
+      length      += static_cast<unsigned>(count);
+      currentPos_ += count;
+
+      // Found the \n. Step over it to the next line.
+      if(count < available)
+      {
+        ++currentPos_;
+        break;
+      }
+    }
+
+    // The line may have fit exactly, with the \n still to come.
+    if(length == maxLength && currentPos_ < fileSize_ && Readable(currentPos_) > 0 && *At(currentPos_) == '\n')
+      ++currentPos_;
+
+    outputString[length] = 0;
+    return length + 1;
+  }
+
+  void File::SeekToLine(Position line)
+  {
+    currentPos_ = LineStart(line);
+  }
+
+  Position File::LineCount()
+  {
+    IndexLines(std::numeric_limits<Position>::max(), std::numeric_limits<Position>::max());
+
+    if(fileSize_ == 0)
+      return 0;
+
+    // A line found right at the end is after a \n that ends the file.
+    const Position found = lines_.Found();
+    return (found > 0 && lines_.Start(found) == fileSize_ ? found : found + 1);
+  }
+
+  Position File::LineStart(Position line)
+  {
+    if(line == 0)
+      return 0;
+
+    IndexLines(std::numeric_limits<Position>::max(), line);
+
+    if(line > lines_.Found() || lines_.Start(line) == fileSize_)
+      throw File_Exception(E_INVALIDPOSITION);
+
+    return lines_.Start(line);
+  }
+
+  Position File::LineOf(Position position)
+  {
+    if(position > fileSize_)
+      throw File_Exception(E_INVALIDPOSITION);
+
+    IndexLines(position, std::numeric_limits<Position>::max());
+    return lines_.LineOf(position);
+  }
+
+  void File::IndexLines(Position offset, Position line)
+  {
+    while(lines_.Indexed() < fileSize_ && lines_.Indexed() < offset && lines_.Found() < line)
+    {
+      const Position position  = lines_.Indexed();
+      const Position readable  = Readable(position);
+      const Position available = mindef(readable, Utils::IndexChunkSize);
+
+      lines_.Extend(At(position), static_cast<size_t>(available));
+    }
+  }
+
+  void File::PutChar(char character, bool ignoreErrors)
+  {
+    // A character is just a one byte write.
+    Write(&character, 1, ignoreErrors);
+  }
+
+  void File::Resize(Position desiredSize)
+  {
+    // Make sure it's a valid size. The window of a streamed file never changes size here.
+    if(desiredSize <= bufferSize_ || stream_ != Platform::InvalidHandle)
+      return;
+
+    CloseGap();
+
+    if(desiredSize > Utils::MaxBufferSize)
+      throw File_Exception(E_FILETOOLARGE);
+
+    // Attempt to allocate new memory
+    Buffer* newBuffer = Buffer::Allocate(desiredSize, *allocator_);
+
+    // Copy the buffer over
+    if(fileSize_ > 0)
+      memcpy(newBuffer->Data(), file_, static_cast<size_t>(fileSize_));
+
+    // Let go of the old buffer. It's only freed if no copies are using it.
+    // A mapped file turns into a regular buffer here.
+    FreeBuffer();
+
+    // Set data
+    buffer_     = newBuffer;
+    file_       = newBuffer->Data();
+    bufferSize_ = desiredSize;
+  }
+
+  void File::PutString(const char* string, bool ignoreErrors)
+  {
+    // Write the whole string in one go.
+    Write(string, std::strlen(string), ignoreErrors);
+  }
+
+  void File::Printf(const char* format, ...)
+  {
+    va_list args;
+    va_start(args, format);
+
+    try
+    {
+      VPrintf(format, args);
+    }
+    catch(...)
+    {
+      va_end(args);
+      throw;
+    }
+
+    va_end(args);
+  }
+
+  void File::VPrintf(const char* format, va_list args)
+  {
+    // Adding to the end of a file in memory, format straight into the
+    // buffer. Past the end of the file there's nothing for the null
+    // vsnprintf adds to overwrite.
+    if(stream_ == Platform::InvalidHandle && currentPos_ == fileSize_)
+    {
+      if(!CanWrite(1, false))
+        return;
+
+      CloseGap();
+      Unshare();
+
+      const Position room = bufferSize_ - currentPos_;
+
+      va_list copy;
+      va_copy(copy, args);
+      const int length = Text::Print(room > 0 ? &file_[currentPos_] : NULL, static_cast<size_t>(room), format, copy);
+      va_end(copy);
+
+      if(length < 0)
+        throw File_Exception(E_FORMATERROR);
+
+      if(length == 0)
+        return;
+
+      // Didn't fit. Now that the length is known, grow the buffer once
+      // and format it again.
+      if(static_cast<Position>(length) >= room)
+      {
+        CanWrite(length + 1, false);
+        Writable(currentPos_, length + 1);
+        Text::Print(&file_[currentPos_], length + 1, format, args);
+      }
+
+      journal_.Record(currentPos_, length, 0);
+      lines_.Truncate(currentPos_);
+      Wrote(length);
+      return;
+    }
+
+    // Anywhere else, the null could land on part of the file, so format on
+    // the side and copy it in. Most output fits on the stack.
+    char stackOutput[512];
+
+    va_list copy;
+    va_copy(copy, args);
+    const int length = Text::Print(stackOutput, sizeof(stackOutput), format, copy);
+    va_end(copy);
+
+    if(length < 0)
+      throw File_Exception(E_FORMATERROR);
+
+    if(static_cast<size_t>(length) < sizeof(stackOutput))
+    {
+      Write(stackOutput, length);
+      return;
+    }
+
+    std::vector<char> output;
+
+    try
+    {
+      output.resize(length + 1);
+    }
+    catch(std::bad_alloc&)
+    {
+      throw File_Exception(E_OUTOFMEMORY);
+    }
+
+    Text::Print(&output[0], output.size(), format, args);
+    Write(&output[0], length);
+  }
+
+  Position File::Read(void* output, Position maxLength)
+  {
+    // Make sure we don't go over the end of the file
+    if(maxLength > fileSize_ - currentPos_)
+      maxLength = fileSize_ - currentPos_;
+
+    // Copy the bytes over a window at a time and move the internal pointer
+    char* bytes = static_cast<char*>(output);
+
+    for(Position remaining = maxLength; remaining > 0; )
+    {
+      Position count = Readable(currentPos_);
+      count = mindef(count, remaining);
+
+      std::memcpy(bytes, At(currentPos_), static_cast<size_t>(count));
+      bytes       += count;
+      currentPos_ += count;
+      remaining   -= count;
+    }
+
+    // Return the number of bytes read.
+    return maxLength;
+  }
+
+  View File::ReadView(Position maxLength)
+  {
+    // Make sure we don't go over the end of the file
+    if(currentPos_ >= fileSize_)
+      return View();
+
+    if(maxLength > fileSize_ - currentPos_)
+      maxLength = fileSize_ - currentPos_;
+
+    // Only as much as is in memory in one piece. A view can't have the gap
+    // in the middle of it, so the gap is closed if it's in the way. A
+    // compressed file is in one piece once the blocks it runs into are
+    // unpacked too.
+    Position available = Readable(currentPos_);
+
+    if(available < maxLength && gapSize_ != 0 && currentPos_ < gapStart_)
+    {
+      CloseGap();
+      available = Readable(currentPos_);
+    }
+
+    while(available < maxLength && stream_ == Platform::InvalidHandle)
+      available += Readable(currentPos_ + available);
+
+    const Position count = mindef(available, maxLength);
+
+    const View view = MakeView(At(currentPos_), count);
+    currentPos_ += count;
+
+    return view;
+  }
+
+  View File::GetLineView(char terminator)
+  {
+    if(currentPos_ >= fileSize_)
+      return View();
+
+    Position available = Readable(currentPos_);
+    Position length    = Scan::Find(At(currentPos_), static_cast<size_t>(available), terminator);
+
+    // A line that runs into the gap has to be put back in one piece first.
+    if(length == available && gapSize_ != 0 && currentPos_ < gapStart_)
+    {
+      CloseGap();
+
+      const Position before = available;
+      available = Readable(currentPos_);
+      length    = before + Scan::Find(At(currentPos_ + before), static_cast<size_t>(available - before), terminator);
+    }
+
+    const char* line = At(currentPos_);
+
+    // A line that runs into a block of a compressed file that isn't
+    // unpacked yet carries on into it, since it's all one buffer.
+    while(length == available && currentPos_ + available < fileSize_ && stream_ == Platform::InvalidHandle)
+    {
+      const Position more = Readable(currentPos_ + available);
+
+      length    += Scan::Find(&line[available], static_cast<size_t>(more), terminator);
+      available += more;
+    }
+
+    // Step over the terminator, if it's in this window.
+    currentPos_ += (length < available ? length + 1 : length);
+
+    return MakeView(line, length);
+  }
+
+  View File::Contents()
+  {
+    if(stream_ != Platform::InvalidHandle)
+      throw File_Exception(E_BADFLAGS);
+
+    CloseGap();
+    return MakeView(file_, fileSize_);
+  }
+
+  Position File::Find(const void* pattern, Position length, Position from)
+  {
+    return FindFrom(Pattern(static_cast<const char*>(pattern), static_cast<size_t>(length)), from);
+  }
+
+  Position File::Find(const char* pattern)
+  {
+    return Find(pattern, std::strlen(pattern));
+  }
+
+  Position File::FindNext(const void* pattern, Position length)
+  {
+    const Position found = FindFrom(Pattern(static_cast<const char*>(pattern), static_cast<size_t>(length)), currentPos_);
+
+    if(found != NotFound)
+      currentPos_ = found + length;
+
+    return found;
+  }
+
+  Position File::FindNext(const char* pattern)
+  {
+    return FindNext(pattern, std::strlen(pattern));
+  }
+
+  std::vector<Position> File::FindAll(const void* pattern, Position length)
+  {
+    const Pattern searcher(static_cast<const char*>(pattern), static_cast<size_t>(length));
+    std::vector<Position> found;
+
+    if(length == 0)
+      return found;
+
+    try
+    {
+      if(stream_ == Platform::InvalidHandle && fileSize_ >= Utils::ParallelSearchSize)
+      {
+        FindEverywhere(searcher, &found, NULL);
+      }
+      else
+      {
+        for(Position at = FindFrom(searcher, 0); at != NotFound; at = FindFrom(searcher, at + 1))
+          found.push_back(at);
+      }
+    }
+    catch ( std::bad_alloc )
+    {
+      throw File_Exception(E_OUTOFMEMORY);
+    }
+
+    return found;
+  }
+
+  std::vector<Position> File::FindAll(const char* pattern)
+  {
+    return FindAll(pattern, std::strlen(pattern));
+  }
+
+  Position File::Count(const void* pattern, Position length)
+  {
+    const Pattern searcher(static_cast<const char*>(pattern), static_cast<size_t>(length));
+    Position count = 0;
+
+    if(length == 0)
+      return count;
+
+    if(stream_ == Platform::InvalidHandle && fileSize_ >= Utils::ParallelSearchSize)
+    {
+      FindEverywhere(searcher, NULL, &count);
+    }
+    else
+    {
+      for(Position at = FindFrom(searcher, 0); at != NotFound; at = FindFrom(searcher, at + 1))
+        ++count;
+    }
+
+    return count;
+  }
+
+  Position File::Count(const char* pattern)
+  {
+    return Count(pattern, std::strlen(pattern));
+  }
+
+  void File::Insert(Position position, const void* data, Position numBytes)
+  {
+    CheckEdit(position);
+
+    // The bytes only get added to the pieces. The window goes into them
+    // first, and is paged in again afterwards since everything in it moved.
+    if(pieces_ != NULL)
+    {
+      FlushWindow();
+      journal_.Record(position, numBytes, 0);
+
+      try
+      {
+        pieces_->Insert(position, static_cast<const char*>(data), numBytes);
+      }
+      catch ( File_Exception )
+      {
+        journal_.Cancel(numBytes, 0);
+        throw;
+      }
+
+      fileSize_ += numBytes;
+
+      DropWindow();
+      Edited(position);
+      currentPos_ = position + numBytes;
+      return;
+    }
+
+    if(numBytes > Utils::MaxBufferSize - fileSize_)
+      throw File_Exception(E_FILETOOLARGE);
+
+    // Everything after position is about to move, so it all has to be unpacked.
+    if(packed_ != NULL)
+      CloseGap();
+
+    // Moving the gap around could move the data out from under us, if
+    // it's part of this file.
+    const char* bytes = static_cast<const char*>(data);
+    std::vector<char> copy;
+
+    if(file_ != NULL && bytes >= file_ && bytes < file_ + bufferSize_)
+    {
+      try
+      {
+        copy.assign(bytes, bytes + numBytes);
+      }
+      catch(std::bad_alloc&)
+      {
+        throw File_Exception(E_OUTOFMEMORY);
+      }
+
+      bytes = (numBytes > 0 ? &copy[0] : NULL);
+    }
+
+    // Make the gap bigger if it has to be. Growing the buffer the same way
+    // Write does leaves room for plenty more inserts.
+    if(gapSize_ < numBytes)
+    {
+      CloseGap();
+
+      const Position needed = fileSize_ + numBytes;
+
+      if(needed > bufferSize_)
+      {
+        const double grownSize = needed * static_cast<double>(Utils::GrowthSize);
+        Resize(grownSize < Utils::MaxBufferSize ? static_cast<Position>(grownSize) : Utils::MaxBufferSize);
+      }
+
+      Unshare();
+      OpenGap(position);
+    }
+    else
+      MoveGap(position);
+
+    journal_.Record(position, numBytes, 0);
+
+    if(numBytes > 0)
+      std::memcpy(&file_[gapStart_], bytes, static_cast<size_t>(numBytes));
+
+    gapStart_ += numBytes;
+    gapSize_  -= numBytes;
+    fileSize_ += numBytes;
+
+    Edited(position);
+    currentPos_ = position + numBytes;
   }
 
-  void File::PutChar(char character, bool ignoreErrors)
+  void File::Insert(const void* data, Position numBytes)
   {
-    // If we're in read-only mode, do nothing.
-    if(mode_ & MODE_READ)
+    Insert(currentPos_, data, numBytes);
+  }
+
+  void File::Erase(Position position, Position numBytes)
+  {
+    CheckEdit(position);
+
+    // Stop at the end of the file.
+    numBytes = mindef(numBytes, fileSize_ - position);
+
+    if(numBytes > 0 && pieces_ != NULL)
     {
-      if(ignoreErrors) // Don't throw
-        return;
+      DropWindow();
 
-      throw File_Exception(E_PROTECTED);
-    };
+      // Keep what's erased, if there's a transaction.
+      char* saved = journal_.Record(position, 0, numBytes);
 
-    // Make sure we're not writing into protected memory.
-    if(currentPos_ < protectEnd_)
+      try
+      {
+        if(saved != NULL)
+          pieces_->Read(position, saved, static_cast<size_t>(numBytes));
+
+        pieces_->Erase(position, numBytes);
+      }
+      catch ( File_Exception )
+      {
+        journal_.Cancel(0, numBytes);
+        throw;
+      }
+
+      fileSize_ -= numBytes;
+
+      Edited(position);
+    }
+    else if(numBytes > 0)
     {
-      if(ignoreErrors) // Don't throw
-        return;
+      // The bytes just become part of the gap. Everything after them moves,
+      // so it all has to be unpacked first.
+      if(packed_ != NULL)
+        CloseGap();
+
+      Unshare();
+
+      if(gapSize_ != 0)
+        MoveGap(position);
+      else
+        gapStart_ = position;
+
+      // The bytes being erased are right after the gap now. Keep them, if
+      // there's a transaction.
+      char* saved = journal_.Record(position, 0, numBytes);
+
+      if(saved != NULL)
+        std::memcpy(saved, &file_[gapStart_ + gapSize_], static_cast<size_t>(numBytes));
+
+      gapSize_  += numBytes;
+      fileSize_ -= numBytes;
+
+      Edited(position);
+    }
+
+    currentPos_ = position;
+  }
+
+  void File::Erase(Position numBytes)
+  {
+    Erase(currentPos_, numBytes);
+  }
+
+  void File::CheckEdit(Position position) const
+  {
+    if(mode_ & MODE_READ)
+      throw File_Exception(E_PROTECTED);
 
+    // Moving everything after position along would mean rewriting the rest
+    // of the file on disk, unless it's in pieces.
+    if(stream_ != Platform::InvalidHandle && pieces_ == NULL)
+      throw File_Exception(E_BADFLAGS);
+
+    if(position > fileSize_)
+      throw File_Exception(E_INVALIDPOSITION);
+
+    // Everything protected comes before protectEnd_, and moving it counts as writing to it.
+    if(position < protectEnd_)
       throw File_Exception(E_PROTECTED);
+  }
+
+  void File::OpenGap(Position position)
+  {
+    gapStart_ = position;
+    gapSize_  = bufferSize_ - fileSize_;
+
+    // Move everything after position to the end of the buffer.
+    if(gapSize_ != 0 && position < fileSize_)
+      std::memmove(&file_[position + gapSize_], &file_[position], static_cast<size_t>(fileSize_ - position));
+  }
+
+  void File::MoveGap(Position position)
+  {
+    // Whatever is between the gap and position goes to the other side of it.
+    if(position < gapStart_)
+      std::memmove(&file_[position + gapSize_], &file_[position], static_cast<size_t>(gapStart_ - position));
+    else if(position > gapStart_)
+      std::memmove(&file_[gapStart_], &file_[gapStart_ + gapSize_], static_cast<size_t>(position - gapStart_));
+
+    gapStart_ = position;
+  }
+
+  void File::CloseGapNow() const
+  {
+    // Move what's after the gap back down over it. Views past the gap now
+    // point at other bytes, even though nothing was written.
+    if(gapStart_ < fileSize_)
+    {
+      std::memmove(&file_[gapStart_], &file_[gapStart_ + gapSize_], static_cast<size_t>(fileSize_ - gapStart_));
+      InvalidateViews();
     }
 
-    // Are we writing to the end of the file?
-    if(currentPos_ == fileSize_)
+    gapSize_ = 0;
+  }
+
+  Position File::Unpack(Position start, Position end) const
+  {
+    const Position unpacked = packed_->Unpack(file_, start, end);
+
+    // Nothing more is needed from the compressed file.
+    if(packed_->Unpacked())
     {
-      // Make sure there's enough space in the buffer
-      if(++fileSize_ > bufferSize_) // Increase file size (write at end)
-        Resize(static_cast<unsigned>((fileSize_) * Utils::GrowthSize));
+      delete packed_;
+      packed_ = NULL;
     }
 
-    // Write to the buffer
-    file_[currentPos_++] = character;
+    return unpacked;
   }
 
-  void File::Resize(unsigned desiredSize)
+  void File::Edited(Position position)
   {
-    // Make sure it's a valid size
-    if(desiredSize <= bufferSize_)
-      return;
+    // Everything after position moved, so the lines and views after it are
+    // gone, and it all has to be written back. (Pieces keep track of that themselves.)
+    lines_.Truncate(position);
+    InvalidateViews();
 
-    // Attempt to allocate new memory
-    char* newBuffer;
+    // Whatever was changed past the new end isn't part of the file anymore.
+    dirty_.Truncate(fileSize_);
+
+    if(!rewrite_ && pieces_ == NULL && position < fileSize_)
+      dirty_.Add(position, fileSize_);
+  }
+
+  void File::BeginTransaction()
+  {
+    journal_.Begin(currentPos_);
+  }
+
+  void File::Commit()
+  {
+    if(journal_.Depth() == 0)
+      throw File_Exception(E_NOTRANSACTION);
+
+    journal_.End();
+  }
+
+  void File::Rollback()
+  {
+    if(journal_.Depth() == 0)
+      throw File_Exception(E_NOTRANSACTION);
+
+    // Put the journal aside while undoing, so undoing isn't journaled too.
+    Journal journal;
+    journal.Swap(journal_);
 
     try
     {
-      newBuffer = new char[desiredSize];
+      for(const Journal::Edit* edit = journal.Last(); edit != NULL; edit = journal.Last())
+      {
+        Restore(*edit, journal.Saved(*edit));
+        journal.Undo();
+      }
     }
-    catch( std::bad_alloc )
+    catch ( File_Exception )
     {
-      throw File_Exception(E_OUTOFMEMORY);
+      journal_.Swap(journal);
+      throw;
     }
 
-    // Copy the buffer over
-    // Can't use fileSize_ since PutChar makes it larger than bufferSize_,
-    // an out-of-bounds memory read.
-    memcpy(newBuffer, file_, bufferSize_);
+    journal_.Swap(journal);
 
-    // Free memory
-    delete [] file_;
+    const Position filePointer = journal_.End();
+    currentPos_ = mindef(filePointer, fileSize_);
+  }
 
-    // Set data
-    file_ = newBuffer;
-    bufferSize_ = desiredSize;
+  unsigned File::TransactionDepth() const
+  {
+    return journal_.Depth();
   }
 
-  void File::PutString(const char* string, bool ignoreErrors)
+  void File::Restore(const Journal::Edit& edit, const char* saved)
   {
-    // Just pass through each caracter to PutChar.
-    const unsigned len = std::strlen(string);
-    
-    for(unsigned i = 0; i < len; ++i)
+    // Write back what was written over.
+    const Position common = mindef(edit.inserted, edit.savedLength);
+
+    currentPos_ = edit.position;
+    Write(saved, common);
+
+    if(edit.inserted > edit.savedLength)
     {
-      PutChar(string[i], ignoreErrors);
+      // A streamed file can't Erase, but it only ever grows at the end,
+      // so it can just be cut short.
+      if(stream_ != Platform::InvalidHandle && pieces_ == NULL)
+      {
+        fileSize_ = edit.position + edit.savedLength;
+        lines_.Truncate(fileSize_);
+      }
+      else
+        Erase(edit.position + common, edit.inserted - common);
     }
+    else if(edit.savedLength > edit.inserted)
+      Insert(edit.position + common, saved + common, edit.savedLength - common);
   }
 
-  unsigned File::Read(void* output, unsigned maxLength)
+  void File::WriteSwapped(const void* data, Position size, Position count)
   {
-    // Make sure we don't go over the end of the file
-    if(currentPos_ + maxLength > fileSize_)
-      maxLength = fileSize_ - currentPos_;
+    // Copy it in, then swap it where it landed. The buffer's ours after writing.
+    if(stream_ == Platform::InvalidHandle)
+    {
+      const Position start = currentPos_;
 
-    // Copy the bytes over and move the internal pointer
-    std::memcpy(output, &file_[currentPos_], maxLength);
-    currentPos_ += maxLength;
+      // The values have to land in one piece to be swapped.
+      if(gapSize_ != 0 && start < gapStart_ && gapStart_ - start < size * count)
+        CloseGap();
 
-    // Return the number of bytes read.
-    return maxLength;
+      Write(data, size, count);
+      Endian::SwapArray(At(start), static_cast<size_t>(size), static_cast<size_t>(count));
+      return;
+    }
+
+    // A streamed file might have paged the start out again, so swap a
+    // piece at a time on the way in instead.
+    char piece[4096];
+    const Position perPiece = sizeof(piece) / size;
+    const char* bytes = static_cast<const char*>(data);
+
+    while(count > 0)
+    {
+      const Position values = mindef(count, perPiece);
+
+      std::memcpy(piece, bytes, static_cast<size_t>(values * size));
+      Endian::SwapArray(piece, static_cast<size_t>(size), static_cast<size_t>(values));
+      Write(piece, values * size);
+
+      bytes += values * size;
+      count -= values;
+    }
+  }
+
+  Position File::FindFrom(const Pattern& pattern, Position from)
+  {
+    const Position length = pattern.Length();
+
+    if(from > fileSize_ || fileSize_ - from < length)
+      return NotFound;
+
+    // The whole file is in the buffer, in one piece. (CloseGap only unpacks
+    // a compressed file here.)
+    if(stream_ == Platform::InvalidHandle && gapSize_ == 0)
+    {
+      CloseGap();
+
+      const size_t size  = static_cast<size_t>(fileSize_ - from);
+      const size_t found = pattern.Find(&file_[from], size);
+
+      return (found < size || length == 0 ? from + found : NotFound);
+    }
+
+    // Otherwise look a window at a time, or either side of the gap, and at
+    // the seams between them.
+    std::vector<char> seam;
+
+    for(Position position = from; fileSize_ - position >= length; )
+    {
+      const Position available = Readable(position);
+      const size_t   found     = pattern.Find(At(position), static_cast<size_t>(available));
+
+      if(found < available || length == 0)
+        return position + found;
+
+      const Position next = position + available;
+
+      if(next == fileSize_)
+        break;
+
+      // A single byte can't run across a seam.
+      if(length < 2)
+      {
+        position = next;
+        continue;
+      }
+
+      // Anything starting close enough to the end of this window to run
+      // into the next one. Copying it together pages in the next window.
+      const Position seamStart = (available > length - 1 ? next - (length - 1) : position);
+      const Position seamEnd   = (fileSize_ - next > length - 1 ? next + (length - 1) : fileSize_);
+
+      try
+      {
+        seam.resize(static_cast<size_t>(seamEnd - seamStart));
+      }
+      catch ( std::bad_alloc )
+      {
+        throw File_Exception(E_OUTOFMEMORY);
+      }
+
+      for(Position copied = 0; copied < seam.size(); )
+      {
+        const Position count = mindef(Readable(seamStart + copied), seam.size() - copied);
+        std::memcpy(&seam[static_cast<size_t>(copied)], At(seamStart + copied), static_cast<size_t>(count));
+        copied += count;
+      }
+
+      const size_t inSeam = pattern.Find(&seam[0], seam.size());
+
+      if(inSeam < seam.size())
+        return seamStart + inSeam;
+
+      position = next;
+    }
+
+    return NotFound;
+  }
+
+  void File::FindEverywhere(const Pattern& pattern, std::vector<Position>* found, Position* count)
+  {
+    CloseGap();
+
+    ThreadPool& pool = ThreadPool::Default();
+
+    const size_t   pieces    = pool.Threads() * Utils::SearchPiecesPerThread;
+    const Position pieceSize = (fileSize_ + pieces - 1) / pieces;
+    const Position length    = pattern.Length();
+
+    // What each piece found. The counts get a cache line each, so threads
+    // adding to neighbouring ones don't slow each other down.
+    struct Tally
+    {
+      Position count;
+      char     padding[64];
+    };
+
+    std::vector<std::vector<Position> > lists;
+    std::vector<Tally> tallies;
+
+    try
+    {
+      lists.resize(found != NULL ? pieces : 0);
+      tallies.resize(pieces);
+
+      pool.ForEach(pieces, [&](size_t piece)
+      {
+        tallies[piece].count = 0;
+
+        // Matches have to start in this piece, but can run on past it.
+        const Position start = piece * pieceSize;
+
+        if(start >= fileSize_)
+          return;
+
+        const Position end   = mindef(start + pieceSize, fileSize_);
+        const Position limit = (fileSize_ - end > length - 1 ? end + (length - 1) : fileSize_);
+
+        const char*  data = &file_[start];
+        const size_t size = static_cast<size_t>(limit - start);
+
+        for(size_t at = pattern.Find(data, size); at < size; at += 1 + pattern.Find(&data[at + 1], size - at - 1))
+        {
+          if(found != NULL)
+            lists[piece].push_back(start + at);
+
+          ++tallies[piece].count;
+        }
+      });
+
+      if(count != NULL)
+      {
+        *count = 0;
+
+        for(size_t i = 0; i < pieces; ++i)
+          *count += tallies[i].count;
+      }
+
+      if(found != NULL)
+      {
+        for(size_t i = 0; i < pieces; ++i)
+          found->insert(found->end(), lists[i].begin(), lists[i].end());
+      }
+    }
+    catch ( std::bad_alloc )
+    {
+      throw File_Exception(E_OUTOFMEMORY);
+    }
+  }
+
+  Range File::Lines(char terminator)
+  {
+    return Range(*this, currentPos_, 0, terminator);
+  }
+
+  Range File::Records(Position size)
+  {
+    if(size == 0)
+      throw File_Exception(E_INVALIDSIZE);
+
+    return Range(*this, currentPos_, size, 0);
+  }
+
+  View File::Piece(Position& position, Position maxLength, bool stopAtTerminator, char terminator, std::vector<char>& spill)
+  {
+    const Position end = (fileSize_ - position > maxLength ? position + maxLength : fileSize_);
+
+    // Usually it's all in memory in one piece already.
+    Position available = mindef(Readable(position), end - position);
+    const char* start  = At(position);
+    Position length    = (stopAtTerminator ? Scan::Find(start, static_cast<size_t>(available), terminator) : available);
+
+    if(length < available || position + length == end)
+    {
+      position += (length < available ? length + 1 : length);
+      return MakeView(start, length);
+    }
+
+    // It runs into the next window, so put it together a window at a time.
+    try
+    {
+      spill.assign(start, start + length);
+      position += length;
+
+      while(position < end)
+      {
+        available = mindef(Readable(position), end - position);
+        start     = At(position);
+        length    = (stopAtTerminator ? Scan::Find(start, static_cast<size_t>(available), terminator) : available);
+
+        spill.insert(spill.end(), start, start + length);
+        position += length;
+
+        // Stopped on the terminator.
+        if(length < available)
+        {
+          ++position;
+          break;
+        }
+      }
+    }
+    catch ( std::bad_alloc )
+    {
+      throw File_Exception(E_OUTOFMEMORY);
+    }
+
+    return View(&spill[0], spill.size());
   }
 
   void File::Reopen(void)
   {
     // Keep track of our filename
-    char* filename = Utils::CopyString(filename_);
+    char* filename = Utils::CopyString(filename_, *allocator_);
 
     Close(false);
-    Open(filename, MODE_SAME);
 
-    delete [] filename;
+    try
+    {
+      Open(filename, MODE_SAME);
+    }
+    catch ( File_Exception )
+    {
+      Utils::FreeString(filename, *allocator_);
+      throw;
+    }
+
+    Utils::FreeString(filename, *allocator_);
   }
 
-  void File::SetPos(unsigned position)
+  void File::SetPos(Position position)
   {
     if(position > fileSize_)
       throw File_Exception(E_INVALIDPOSITION);
@@ -444,9 +2474,9 @@ namespace File
     currentPos_ = position;
   }
 
-  void File::Seek(int offset, Seek_Origin origin)
+  void File::Seek(Offset offset, Seek_Origin origin)
   {
-    unsigned start;
+    Position start;
     
     switch (origin)
     {
@@ -466,7 +2496,8 @@ namespace File
       throw File_Exception(E_INVALIDPOSITION);
     }
 
-    start += offset;
+    // Negative offsets wrap around to huge positions, which the check below catches.
+    start += static_cast<Position>(offset);
 
     // Make sure we're still inside the file.
     if(start > fileSize_)
@@ -475,20 +2506,89 @@ namespace File
     currentPos_ = start;
   }
 
-  void File::Write(const void* data, unsigned numBytes, bool ignoreErrors)
+  void File::Write(const void* data, Position numBytes, bool ignoreErrors)
+  {
+    // Nothing to write, nothing to check.
+    if(numBytes == 0 || !CanWrite(numBytes, ignoreErrors))
+      return;
+
+    // Lines starting after here may not start there anymore.
+    lines_.Truncate(currentPos_);
+
+    // Copy the data into the buffer. Everything fits in one go, unless
+    // we're streaming and the data crosses windows.
+    const char* bytes = static_cast<const char*>(data);
+
+    while(numBytes > 0)
+    {
+      const Position count = Writable(currentPos_, numBytes);
+
+      // Keep what's about to be written over, if there's a transaction.
+      const Position overwritten = (currentPos_ < fileSize_ ? mindef(count, fileSize_ - currentPos_) : 0);
+      char* saved = journal_.Record(currentPos_, count, overwritten);
+
+      if(saved != NULL)
+        std::memcpy(saved, At(currentPos_), static_cast<size_t>(overwritten));
+
+      std::memcpy(At(currentPos_), bytes, static_cast<size_t>(count));
+      Wrote(count);
+
+      bytes    += count;
+      numBytes -= count;
+    }
+  }
+
+  bool File::CanWrite(Position numBytes, bool ignoreErrors)
   {
-    // There already exists a function that writes data to the file buffer.
-    // All we need to do is convert it to a character array.
-    const char* byteArray = reinterpret_cast<const char*>(data);
+    // If we're in read-only mode, do nothing.
+    if(mode_ & MODE_READ)
+    {
+      if(ignoreErrors) // Don't throw
+        return false;
 
-    for(unsigned i = 0; i < numBytes; ++i)
+      throw File_Exception(E_PROTECTED);
+    }
+
+    // Make sure we're not writing into protected memory. Only the first byte
+    // needs checking, since everything protected comes before protectEnd_.
+    if(currentPos_ < protectEnd_)
     {
-      PutChar(byteArray[i], ignoreErrors);
+      if(ignoreErrors) // Don't throw
+        return false;
+
+      throw File_Exception(E_PROTECTED);
     }
+
+    // Make sure the write doesn't take the file past the largest size we can
+    // hold. Streamed files don't need to fit in memory.
+    const Position maxSize = (stream_ != Platform::InvalidHandle ? std::numeric_limits<Position>::max() : Utils::MaxBufferSize);
+
+    if(numBytes > maxSize - currentPos_)
+      throw File_Exception(E_FILETOOLARGE);
+
+    return true;
+  }
+
+  void File::Wrote(Position count)
+  {
+    // Remember which part of the file has to be written back. Not needed
+    // if the whole file will be rewritten anyway.
+    if(!rewrite_)
+      dirty_.Add(currentPos_, currentPos_ + count);
+
+    currentPos_ += count;
+
+    // Did we write past the end of the file?
+    if(currentPos_ > fileSize_)
+      fileSize_ = currentPos_;
   }
 
-  void File::Write(const void* data, unsigned objectSize, unsigned numObjects, bool ignoreErrors)
+  void File::Write(const void* data, Position objectSize, Position numObjects, bool ignoreErrors)
   {
+    // Make sure the total size doesn't overflow.
+    if(numObjects != 0 && objectSize > Utils::MaxBufferSize / numObjects)
+      throw File_Exception(E_FILETOOLARGE);
+
     // Do the math and call the other Write function.
     Write(data, objectSize * numObjects, ignoreErrors);
   }
@@ -8,7 +8,26 @@
 #ifndef FILE_WRAPPER_H
 #define FILE_WRAPPER_H
 
+#include "File_Types.h"
 #include "File_Exception.h"
+#include "File_Platform.h"
+#include "File_RangeSet.h"
+#include "File_Buffer.h"
+#include "File_Allocator.h"
+#include "File_LineIndex.h"
+#include "File_View.h"
+#include "File_Range.h"
+#include "File_Search.h"
+#include "File_Endian.h"
+#include "File_Format.h"
+#include "File_Parse.h"
+#include "File_PieceTable.h"
+#include "File_Journal.h"
+#include "File_Compress.h"
+
+#include <cstdarg>
+#include <type_traits>
+#include <vector>
 
 namespace File
 {
@@ -22,7 +41,7 @@ namespace File
 
     // Translation mode
     MODE_BINARY =    0x00000004, // Binary mode. No translation of newlines
-    MODE_TEXT   =    0x00000008, // Text mode. Translation of newlines occurs.
+    MODE_TEXT   =    0x00000008, // Text mode. \r\n is read in as \n, the same on every platform.
 
     // What to do if the file already exists
     MODE_CLEAR =     0x00000010, // Erase the file and create a blank one.
@@ -33,6 +52,13 @@ namespace File
 
     MODE_CREATE =    0x00000100, // Create the file if it does not exist. If the file exists, does nothing special.
 
+    MODE_MMAP =      0x00000200, // Map the file into memory instead of reading it into a buffer. Implies MODE_READ.
+    MODE_STREAM =    0x00000400, // Only keep a window of the file in memory, paging it in and out as needed.
+    MODE_ATOMIC =    0x00000800, // Save by writing a new file and renaming it over the old one. Can't be used with MODE_STREAM.
+    MODE_CRLF =      0x00001000, // With MODE_TEXT, write \n out as \r\n. Otherwise text mode writes \n as-is.
+    MODE_PIECES =    0x00002000, // Never write to the file itself, only keep track of the edits to it, and save by replacing it. Implies MODE_STREAM.
+    MODE_COMPRESSED = 0x00004000, // Store the file compressed, in blocks unpacked as they're used. Can't be used with MODE_MMAP or MODE_STREAM.
+
 
 
     // Cannot be used in constructor
@@ -40,6 +66,18 @@ namespace File
   };
 
   // Used for Seek function. Where offset starts from
+  //
+  // <cstdio> makes the C names macros, and most of the standard library
+  // brings it in (<iterator>, <mutex>, <future> and the rest). They're set
+  // aside while the enum is declared, so the headers can come in any order,
+  // but anywhere <cstdio> is included they're still the macros afterwards.
+  // Use the aliases outside of File_Wrapper.cpp, which undefines them.
+#pragma push_macro("SEEK_SET")
+#pragma push_macro("SEEK_CUR")
+#pragma push_macro("SEEK_END")
+#undef SEEK_SET
+#undef SEEK_CUR
+#undef SEEK_END
   enum Seek_Origin
   {
     // The C values
@@ -52,6 +90,18 @@ namespace File
     SEEK_CURRENT =    SEEK_CUR,
     SEEK_CURRENTPOS = SEEK_CUR,
   };
+#pragma pop_macro("SEEK_SET")
+#pragma pop_macro("SEEK_CUR")
+#pragma pop_macro("SEEK_END")
+
+  // How hard saving a file tries to make sure it's actually on the disk
+  // before returning. See: File::SetDurability
+  enum Durability
+  {
+    DURABLE_NONE, // Leave it to the operating system to write the file out eventually.
+    DURABLE_DATA, // Wait until the contents of the file are on the disk.
+    DURABLE_FULL, // Wait until the contents, the metadata and the directory entry are on the disk.
+  };
 
   // The file class to be used when dealing with files.
   class File
@@ -61,33 +111,66 @@ namespace File
      *
      * filename: The name of the file to open. Can contain a path.
      * mode: The mode specifying how the file should be opened. See: Mode enum.
+     * allocator: Where the memory for the buffer and filename comes from,
+     *            for this file and any opened afterwards. Has to outlive the
+     *            File and every copy of it. See: Allocator
      *
      * Throws: See: Open
      */
-    File(const char* filename, Mode mode = static_cast<Mode>(MODE_WRITE | MODE_BINARY | MODE_OVERWRITE)) throw(File_Exception);
+    File(const char* filename, Mode mode = static_cast<Mode>(MODE_WRITE | MODE_BINARY | MODE_OVERWRITE),
+         Allocator& allocator = Allocator::Default()) throw(File_Exception);
 
     /* Copies the buffer and status of the rhs file. All edits made
      * to rhs since file was opened will be copied over to the newly
      * created file. However, changes made to rhs after copy will not
      * be automatically applied.
      *
+     * The buffer isn't actually copied. Both files share it until one of
+     * them writes to it, which makes copying cheap no matter how large the
+     * file is. Copies can be handed to other threads.
+     *
      * rhs: The file to copy status and buffer from.
      *
-     * Throws: E_OUTOFMEMORY - new had an error while copying the filename/buffer.
+     * The copy gets its memory from the same Allocator as rhs.
+     *
+     * Throws: E_OUTOFMEMORY - The allocator ran out of memory copying the filename.
      */
     File(const File& rhs) throw(File_Exception);
 
+    /* Takes over the buffer and status of the rhs file without copying
+     * anything, so Files can be returned from functions and kept in
+     * containers cheaply. rhs is left closed, and won't write anything out
+     * when it's closed or destroyed.
+     *
+     * rhs: The file to take over.
+     */
+    File(File&& rhs) throw();
+
     /* If a file is open, it will be closed first. Then does the
-     * same thing as the copy constructor. Status of file is copied
-     * as-is. All changes made afterwards are not copied over.
+     * same thing as the copy constructor (sharing the buffer). Status of
+     * file is copied as-is. All changes made afterwards are not copied over.
      *
      * rhs: The file to copy status and buffer from.
      *
-     * Throws: E_OUTOFMEMORY - new had an eeror while copying the filename/buffer.
+     * Throws: E_OUTOFMEMORY - The allocator ran out of memory copying the filename.
      * Status after Throw: File is closed.
      */
     File& operator=(const File& rhs) throw(File_Exception);
 
+    /* Closes this file the same way the destructor does, then takes over
+     * rhs the same way the move constructor does. rhs is left closed.
+     *
+     * rhs: The file to take over.
+     */
+    File& operator=(File&& rhs) throw();
+
+    /* Swaps the buffers and status of two files, open or not. Nothing is
+     * copied, opened, closed or written out.
+     *
+     * rhs: The file to swap with.
+     */
+    void Swap(File& rhs) throw();
+
     /* Automatically calls Close on the file.
      */
     ~File() throw();
@@ -98,9 +181,57 @@ namespace File
      * filename: The file to open.
      * mode: The mode specifying how to open the file. See: Mode enum.
      *
+     * With MODE_MMAP, the file is mapped read-only and read straight out of
+     * the operating system's page cache, so opening is nearly free and the
+     * pages are shared with every other process mapping the same file. The
+     * file must not be truncated by anyone else while it's mapped. No newline
+     * translation is done on a mapped file.
+     *
+     * With MODE_STREAM, the file stays open and only one window of it is
+     * kept in memory at a time (see: SetWindowSize). Reading, writing and
+     * seeking work the same as always, but windows are paged in on demand
+     * and changed windows are written back to the file when they're paged
+     * out, so files of any size can be used with a fixed amount of memory.
+     * No newline translation is done on a streamed file.
+     *
+     * With MODE_TEXT, the file is read in with every \r\n turned into \n,
+     * whatever platform this is. It's written back out with \n line
+     * endings, or \r\n ones with MODE_CRLF. The buffer is exactly as large
+     * as the file.
+     *
+     * With MODE_ATOMIC, saving writes the whole file out to a temporary file
+     * in the same directory and then renames it over the original, so the
+     * file on disk is always either the old version or the new one, never
+     * something half-written. Combine it with SetDurability for it to hold
+     * up against power loss as well as crashes.
+     *
+     * With MODE_PIECES, the file is streamed, but windows that are paged
+     * out go into a piece table (see: File_PieceTable.h) rather than back
+     * into the file. The file itself is mapped read-only where it fits in
+     * the address space and never written to, so only the edits take up
+     * memory, however large the file is. Insert and Erase work on it
+     * without moving the rest of the file. Saving writes the pieces out to
+     * a temporary file, with as few system calls as possible, and renames it
+     * over the original, the same as MODE_ATOMIC.
+     *
+     * With MODE_COMPRESSED, the file on disk is compressed in fixed-size
+     * blocks that are each packed on their own, with an index of where
+     * they are (see: File_Compress.h). Opening only reads the index; each
+     * block is read and unpacked into the buffer the first time any of it
+     * is used, and reads that span several blocks unpacks them on every
+     * core at once, so seeking anywhere only costs the block landed in.
+     * Anything that needs the whole file, like Contents, Find or editing
+     * with Insert and Erase, unpacks the rest first. Saving packs the
+     * blocks on every core and rewrites the whole file, but only if it was
+     * changed. No newline translation is done on a compressed file.
+     *
      * Throws: E_FOPENERROR   - fopen didn't return a valid file.
-     *         E_FILETOOLARGE - The largest file that can be opened is INT_MAX. The file is larger than that.
+     *         E_FILETOOLARGE - The file doesn't fit in the address space of the process.
      *         E_OUTOFMEMORY  - new had an error allocating the filename or buffer for the file.
+     *         E_MMAPERROR    - The file couldn't be mapped into memory. (MODE_MMAP only)
+     *         E_BADFLAGS     - MODE_ATOMIC and MODE_STREAM were both given (without MODE_PIECES).
+     *         E_BADFLAGS     - MODE_COMPRESSED was given with MODE_MMAP or MODE_STREAM.
+     *         E_BADFORMAT    - The file isn't a compressed file. (MODE_COMPRESSED only)
      * Status after Throw: File is closed.
      */
     void Open(const char* filename, Mode mode = MODE_SAME) throw(File_Exception);
@@ -108,23 +239,76 @@ namespace File
     /* Writes out changes to the file and closes the file.
      * File will be re-created if it has since been deleted.
      *
+     * Only the parts of the file that were changed get written, in place.
+     * The whole file is rewritten instead when that's cheaper (most of it
+     * changed), or when it's the only safe option (the file was cleared,
+     * newlines get translated, or the file changed size on disk since it
+     * was opened, or MODE_ATOMIC is on). WriteFile always rewrites the
+     * whole file.
+     *
+     * A streamed file has already written out every window that was paged
+     * out, so not saving only throws away the changes to the current window.
+     * With MODE_PIECES, nothing has been written, so not saving throws away
+     * every change.
+     *
      * save: True - Saves the file out to disk.
      *       False - Closes the file, but does not write it out.
      *
      * Throws: E_FOPENERROR - fopen didn't return a valid file.
+     *         E_IOERROR    - Writing out the changes failed.
      * Status after Throw: No change. File is not closed.
      */
     void Close(bool save = true) throw(File_Exception);
 
-    /* Writes out the current status of the buffer to a file.
-     *
-     * filename: The file to write out to.
+    /* Writes out changes to the file without closing it, the same way
+     * Close does. Does nothing on a read-only file.
      *
      * Throws: E_FOPENERROR - fopen didn't return a valid file.
+     *         E_IOERROR    - Writing out the changes failed.
      * Status after Throw: No change.
      */
+    void Flush() throw(File_Exception);
+
+    /* Writes out the current status of the buffer to a file. A streamed
+     * file can't be written over itself this way; use Flush instead.
+     * With MODE_ATOMIC, the file is replaced in one step (see: Open).
+     *
+     * filename: The file to write out to.
+     *
+     * Throws: E_FOPENERROR  - The file (or temporary file) couldn't be created.
+     *         E_IOERROR     - Writing the file, or reading the streamed file, failed.
+     *         E_OUTOFMEMORY - new failed allocating room to copy the file through.
+     *         E_BADFLAGS    - filename is the streamed file itself.
+     * Status after Throw: No change to the File. The file on disk is
+     *                     unchanged with MODE_ATOMIC, and may be partly
+     *                     written without it.
+     */
     void WriteFile(const char* filename) const throw(File_Exception);
 
+    /* Sets how much of a streamed file is kept in memory at once. Somewhere
+     * between 1 and 64 MB is sensible. The default is 4 MB. Takes effect
+     * right away on a streamed file (after writing out the current window),
+     * or otherwise the next time a file is opened with MODE_STREAM.
+     *
+     * size: The size of the window in bytes.
+     *
+     * Throws: E_INVALIDSIZE - size is 0.
+     *         E_IOERROR     - Writing out the current window failed.
+     * Status after Throw: No change.
+     */
+    void SetWindowSize(Position size) throw(File_Exception);
+
+    /* Sets how sure saving (Close, Flush and WriteFile) makes that the file
+     * is on the disk before returning. The default is DURABLE_NONE, which is
+     * fastest but can lose the latest changes if the power goes out.
+     * DURABLE_FULL also waits on the directory, so a newly created or
+     * renamed (MODE_ATOMIC) file can't disappear either. Stays set across
+     * calls to Open.
+     *
+     * durability: See: Durability enum.
+     */
+    void SetDurability(Durability durability) throw();
+
     /* Whether or not the end of the file has been reached.
      * You do not need to have tried to read past the end of the
      * file for this to be true.
@@ -141,27 +325,178 @@ namespace File
      *                    character.
      *
      * Returns: The next character in the file.
+     *
+     * Throws: E_IOERROR - Paging in a window failed. (MODE_STREAM only)
      */
-    char GetChar(bool ignoreWhitespace = false) throw();
+    char GetChar(bool ignoreWhitespace = false) throw(File_Exception);
 
     /* Gets the current position of the internal buffer pointer
      *
      * Returns: Buffer pointer position.
      */
-    unsigned GetPos() const throw();
+    Position GetPos() const throw();
 
     /* Gets the next string in the file. Reads from the next non-whitespace
      * character inside the buffer, until the next terminator character,
      * EOF is reached, or untl maxLength is reached. The string is
      * guranteed to be null-terminated.
      *
+     * The terminator (and, in text mode, the end of the whitespace) is
+     * searched for 16 or 32 bytes at a time. See: File_Scan.h
+     *
      * outputString: Where the string will be stored.
      * maxLength: The largest the string can be.
      * terminator: The signal of the end of the string.
      *
      * Returns: The number of characters read. Includes null terminator.
+     *
+     * Throws: E_IOERROR - Paging in a window failed. (MODE_STREAM only)
+     */
+    unsigned GetString(char* outputString, unsigned maxLength, char terminator = '\n') throw(File_Exception);
+
+    /* Reads a number straight out of the buffer, with the same rules as
+     * std::from_chars (see: File_Parse.h). In text mode, whitespace before
+     * the number is skipped first, the same as GetString.
+     *
+     * Nothing is thrown for text that isn't a number; check what comes
+     * back instead. The file pointer is left after the number, or where it
+     * was if there isn't one.
+     *
+     * value: Receives the number, if it's PARSE_OK.
+     *
+     * Returns: PARSE_OK         - Read it.
+     *          PARSE_INVALID    - There's no number there.
+     *          PARSE_OUTOFRANGE - The number doesn't fit in value. It's skipped.
+     *          PARSE_ENDOFFILE  - There's nothing left to read.
+     *
+     * Throws: E_OUTOFMEMORY - A number crossing windows couldn't be put together. (MODE_STREAM only)
+     *         E_IOERROR     - Paging in a window failed. (MODE_STREAM only)
+     */
+    ParseResult ReadInt(int& value) throw(File_Exception);
+    ParseResult ReadInt(long long& value) throw(File_Exception);
+    ParseResult ReadUInt(unsigned& value) throw(File_Exception);
+    ParseResult ReadUInt(unsigned long long& value) throw(File_Exception);
+    ParseResult ReadDouble(double& value) throw(File_Exception);
+
+    /* Reads numbers into values until count have been read or one can't be,
+     * without going back through ReadInt for each. Meant for large blocks
+     * of numbers, like a column of data. See: ReadInt
+     *
+     * Returns: How many numbers were read. The file pointer is left after
+     *          the last of them.
+     */
+    Position ReadInts(int* values, Position count) throw(File_Exception);
+    Position ReadInts(long long* values, Position count) throw(File_Exception);
+    Position ReadDoubles(double* values, Position count) throw(File_Exception);
+
+    /* Reads a token: everything up to the next whitespace. In text mode,
+     * the whitespace before it is skipped first. See: ReadInt
+     *
+     * output: Where to put the token. Always null-terminated.
+     * maxLength: The most it can hold, null terminator included.
+     *
+     * Returns: PARSE_OK         - Read it.
+     *          PARSE_INVALID    - The file pointer is on whitespace. (Binary mode only)
+     *          PARSE_OUTOFRANGE - The token doesn't fit. What did fit is in
+     *                             output, and the pointer is left after it.
+     *          PARSE_ENDOFFILE  - There's nothing left to read.
+     */
+    ParseResult ReadToken(char* output, unsigned maxLength) throw(File_Exception);
+
+    /* Reads each argument in turn, fscanf style, but with the types taken
+     * from the arguments instead of a format string:
+     *
+     *   int id; double price; char name[32];
+     *   if(file.Scan(id, name, price) == 3) ...
+     *
+     * ints, unsigneds, long longs, unsigned long longs and doubles are read
+     * as numbers and char arrays as tokens. Anything else fails to compile.
+     *
+     * Takes up to 10 arguments, the same as Format.
+     *
+     * Returns: How many arguments were read before one couldn't be.
+     */
+    template <typename A>
+    unsigned Scan(A& a) throw(File_Exception);
+    template <typename A, typename B>
+    unsigned Scan(A& a, B& b) throw(File_Exception);
+    template <typename A, typename B, typename C>
+    unsigned Scan(A& a, B& b, C& c) throw(File_Exception);
+    template <typename A, typename B, typename C, typename D>
+    unsigned Scan(A& a, B& b, C& c, D& d) throw(File_Exception);
+    template <typename A, typename B, typename C, typename D, typename E>
+    unsigned Scan(A& a, B& b, C& c, D& d, E& e) throw(File_Exception);
+    template <typename A, typename B, typename C, typename D, typename E, typename F>
+    unsigned Scan(A& a, B& b, C& c, D& d, E& e, F& f) throw(File_Exception);
+    template <typename A, typename B, typename C, typename D, typename E, typename F, typename G>
+    unsigned Scan(A& a, B& b, C& c, D& d, E& e, F& f, G& g) throw(File_Exception);
+    template <typename A, typename B, typename C, typename D, typename E, typename F, typename G, typename H>
+    unsigned Scan(A& a, B& b, C& c, D& d, E& e, F& f, G& g, H& h) throw(File_Exception);
+    template <typename A, typename B, typename C, typename D, typename E, typename F, typename G, typename H, typename I>
+    unsigned Scan(A& a, B& b, C& c, D& d, E& e, F& f, G& g, H& h, I& i) throw(File_Exception);
+    template <typename A, typename B, typename C, typename D, typename E, typename F, typename G, typename H, typename I, typename J>
+    unsigned Scan(A& a, B& b, C& c, D& d, E& e, F& f, G& g, H& h, I& i, J& j) throw(File_Exception);
+
+    /* Gets a whole line, without the \n at the end of it, and leaves the
+     * internal file pointer at the start of the next line. Unlike GetString,
+     * no whitespace is skipped, so empty lines come back empty. If the line
+     * doesn't fit, the pointer is left after the part that did.
+     *
+     * line: Which line to get. The first line is line 0. See: SeekToLine
+     * outputString: Where the line will be stored. Always null-terminated.
+     * maxLength: The largest the line can be, null terminator included.
+     *
+     * Returns: The number of characters read. Includes null terminator.
+     *
+     * Throws: E_INVALIDPOSITION - There's no such line.
+     *         E_OUTOFMEMORY     - The line index couldn't grow.
+     *         E_IOERROR         - Paging in a window failed. (MODE_STREAM only)
+     * Status after Throw: No change.
+     */
+    unsigned GetLine(Position line, char* outputString, unsigned maxLength) throw(File_Exception);
+
+    /* Moves the internal file pointer to the start of a line.
+     *
+     * Where lines start is worked out the first time it's needed and then
+     * remembered, only going as far into the file as asked for. Getting to
+     * a line the file has already been indexed past is O(1). Writing to the
+     * file forgets the lines after where it was written.
+     *
+     * line: Which line to go to. The first line is line 0, which can always
+     *       be gone to, even in an empty file.
+     *
+     * Throws: E_INVALIDPOSITION - There's no such line.
+     *         E_OUTOFMEMORY     - The line index couldn't grow.
+     *         E_IOERROR         - Paging in a window failed. (MODE_STREAM only)
+     * Status after Throw: No change.
+     */
+    void SeekToLine(Position line) throw(File_Exception);
+
+    /* Gets how many lines are in the file. Lines end with \n. A \n at the
+     * very end of the file ends the last line rather than starting an empty
+     * one, and an empty file has no lines at all.
+     *
+     * Throws: E_OUTOFMEMORY - The line index couldn't grow.
+     *         E_IOERROR     - Paging in a window failed. (MODE_STREAM only)
+     */
+    Position LineCount() throw(File_Exception);
+
+    /* Gets where a line starts. See: SeekToLine
+     *
+     * Throws: E_INVALIDPOSITION - There's no such line.
+     *         E_OUTOFMEMORY     - The line index couldn't grow.
+     *         E_IOERROR         - Paging in a window failed. (MODE_STREAM only)
      */
-    unsigned GetString(char* outputString, unsigned maxLength, char terminator = '\n') throw();
+    Position LineStart(Position line) throw(File_Exception);
+
+    /* Gets which line a position in the file is on. The end of the file
+     * counts as being on the line that would be written there next.
+     *
+     * Throws: E_INVALIDPOSITION - position is past the end of the file.
+     *         E_OUTOFMEMORY     - The line index couldn't grow.
+     *         E_IOERROR         - Paging in a window failed. (MODE_STREAM only)
+     */
+    Position LineOf(Position position) throw(File_Exception);
 
     /* Puts a character onto the file buffer.
      *
@@ -177,13 +512,16 @@ namespace File
     void PutChar(char character, bool ignoreErrors = false) throw (File_Exception);
 
     /* Increases the internal buffer size to a desired amount.
-     * If lower than the current buffer size, does nothing.
+     * If lower than the current buffer size, does nothing. Streamed files
+     * don't keep the whole file in the buffer, so this does nothing for them
+     * either (see: SetWindowSize).
      *
      * desiredSize: How large the internal buffer should be.
-     * Throws: E_OUTOFMEMORY - New failed while trying to resize internal buffer.
+     * Throws: E_OUTOFMEMORY  - New failed while trying to resize internal buffer.
+     *         E_FILETOOLARGE - desiredSize doesn't fit in the address space of the process.
      * Status after Throw: No change.
      */
-    void Resize(unsigned desiredSize) throw (File_Exception);
+    void Resize(Position desiredSize) throw (File_Exception);
 
     /* Put a null-terminated string onto the file buffer.
      *
@@ -197,6 +535,59 @@ namespace File
      * Status after Throw: No change.
      */
     void PutString(const char* string, bool ignoreErrors = false) throw (File_Exception);
+
+    /* fprintf for the file buffer. When adding to the end of a file that's
+     * in memory, the output is formatted straight into the buffer, which
+     * grows at most once. Anywhere else it's formatted on the side and
+     * written over what's there.
+     *
+     * format: A printf format string. Checked against the arguments where
+     *         the compiler can.
+     *
+     * Throws: E_PROTECTED    - Attempting to write into protected area of the file.
+     *         E_PROTECTED    - Attempting to write into a read-only file.
+     *         E_OUTOFMEMORY  - New failed while trying to resize internal buffer.
+     *         E_FORMATERROR  - vsnprintf failed, like for an invalid multibyte character.
+     * Status after Throw: No change.
+     */
+    void Printf(FILE_FORMAT_STRING const char* format, ...) throw(File_Exception) FILE_PRINTF_FORMAT(2);
+    void VPrintf(const char* format, va_list args) throw(File_Exception);
+
+    /* Writes each argument out in turn, with no format string to get wrong:
+     *
+     *   file.Format("Total: ", total, " (", percent, "%)\n");
+     *
+     * Strings, characters, Views and numbers can be written, and anything
+     * else fails to compile. Integers are written two digits at a time,
+     * floats with as few digits as it takes to read them back exactly, and
+     * bools as true or false. Everything goes into the file in one Write,
+     * unless it's large.
+     *
+     * Takes up to 10 arguments. (There's an overload for each number of
+     * them, since VS2012 has no variadic templates.)
+     *
+     * Throws: See: Write(data, numBytes)
+     */
+    template <typename A>
+    void Format(const A& a) throw(File_Exception);
+    template <typename A, typename B>
+    void Format(const A& a, const B& b) throw(File_Exception);
+    template <typename A, typename B, typename C>
+    void Format(const A& a, const B& b, const C& c) throw(File_Exception);
+    template <typename A, typename B, typename C, typename D>
+    void Format(const A& a, const B& b, const C& c, const D& d) throw(File_Exception);
+    template <typename A, typename B, typename C, typename D, typename E>
+    void Format(const A& a, const B& b, const C& c, const D& d, const E& e) throw(File_Exception);
+    template <typename A, typename B, typename C, typename D, typename E, typename F>
+    void Format(const A& a, const B& b, const C& c, const D& d, const E& e, const F& f) throw(File_Exception);
+    template <typename A, typename B, typename C, typename D, typename E, typename F, typename G>
+    void Format(const A& a, const B& b, const C& c, const D& d, const E& e, const F& f, const G& g) throw(File_Exception);
+    template <typename A, typename B, typename C, typename D, typename E, typename F, typename G, typename H>
+    void Format(const A& a, const B& b, const C& c, const D& d, const E& e, const F& f, const G& g, const H& h) throw(File_Exception);
+    template <typename A, typename B, typename C, typename D, typename E, typename F, typename G, typename H, typename I>
+    void Format(const A& a, const B& b, const C& c, const D& d, const E& e, const F& f, const G& g, const H& h, const I& i) throw(File_Exception);
+    template <typename A, typename B, typename C, typename D, typename E, typename F, typename G, typename H, typename I, typename J>
+    void Format(const A& a, const B& b, const C& c, const D& d, const E& e, const F& f, const G& g, const H& h, const I& i, const J& j) throw(File_Exception);
     
     /* Get a certain amount of bytes from the buffer. Does not null-terminate.
      *
@@ -204,8 +595,150 @@ namespace File
      * maxLength: The maximum length that should be read.
      *
      * Returns: The number of bytes read.
+     *
+     * Throws: E_IOERROR - Paging in a window failed. (MODE_STREAM only)
+     */
+    Position Read(void* output, Position maxLength) throw(File_Exception);
+
+    /* Reads a value straight out of the file: a number, or anything else
+     * that can be copied byte for byte, like a struct of numbers.
+     *
+     * Order: The byte order the value is stored in, LittleEndian or
+     *        BigEndian. Left out, it's the machine's own (NativeEndian).
+     *        Only numbers can be read in the other order. See: File_Endian.h
+     * value: Where to put the value.
+     *
+     * Returns: Whether there was a whole value left to read. If there
+     *          wasn't, nothing is read and the file pointer stays put.
+     *
+     * Throws: E_IOERROR - Paging in a window failed. (MODE_STREAM only)
+     */
+    template <typename T> bool Read(T& value) throw(File_Exception);
+    template <typename Order, typename T> typename Endian::IfOrder<Order, bool>::type Read(T& value) throw(File_Exception);
+
+    /* Reads as many values as are asked for, or as many whole ones as are
+     * left. Values in the other byte order are swapped 16 bytes at a time.
+     * See: Read(T&)
+     *
+     * Returns: How many values were read.
+     *
+     * Throws: E_IOERROR - Paging in a window failed. (MODE_STREAM only)
+     */
+    template <typename T> Position ReadArray(T* values, Position count) throw(File_Exception);
+    template <typename Order, typename T> typename Endian::IfOrder<Order, Position>::type ReadArray(T* values, Position count) throw(File_Exception);
+
+    /* Like Read, but rather than copying the bytes out, gives back a view of
+     * them where they are in the buffer. See File_View.h for how long the
+     * view can be used for.
+     *
+     * maxLength: The most bytes the view should hold.
+     *
+     * Returns: A view of the next bytes in the file. Shorter than maxLength
+     *          at the end of the file, and with MODE_STREAM, at the end of
+     *          the current window too.
+     *
+     * Throws: E_IOERROR - Paging in a window failed. (MODE_STREAM only)
+     */
+    View ReadView(Position maxLength) throw(File_Exception);
+
+    /* Gets a view of everything up to the next terminator, and leaves the
+     * internal file pointer after the terminator. Nothing is copied, and
+     * unlike GetString, no whitespace is skipped. See File_View.h for how
+     * long the view can be used for.
+     *
+     * terminator: The signal of the end of the line. Not part of the view.
+     *
+     * Returns: A view of the line. With MODE_STREAM, a line that runs into
+     *          the next window comes back in two parts: the first ends at
+     *          the end of the window, and the next call gets the rest.
+     *
+     * Throws: E_IOERROR - Paging in a window failed. (MODE_STREAM only)
+     */
+    View GetLineView(char terminator = '\n') throw(File_Exception);
+
+    /* Gets a view of the whole file, wherever the internal file pointer is.
+     * Doesn't move it. See File_View.h for how long the view can be used for.
+     *
+     * Throws: E_BADFLAGS - The file is streamed, so it isn't all in memory at once.
+     */
+    View Contents() throw(File_Exception);
+
+    /* Finds the first place a pattern of bytes shows up, from a given
+     * position on. Doesn't move the internal file pointer. See: Pattern
+     *
+     * pattern: The bytes to look for. The string versions look for a
+     *          null-terminated string, without the null, from the start.
+     * length: How many bytes are in the pattern.
+     * from: Where to start looking.
+     *
+     * Returns: Where the pattern starts, ready to SetPos to. NotFound if
+     *          it isn't there. An empty pattern is found right at from.
+     *
+     * Throws: E_IOERROR - Paging in a window failed. (MODE_STREAM only)
+     */
+    Position Find(const void* pattern, Position length, Position from = 0) throw(File_Exception);
+    Position Find(const char* pattern) throw(File_Exception);
+
+    /* Finds the next place a pattern of bytes shows up, from the internal
+     * file pointer on, and moves the pointer to just past it, so calling it
+     * again finds the one after. Doesn't move the pointer if it isn't found.
+     *
+     * Returns: Where the pattern starts. NotFound if it isn't there.
+     *
+     * Throws: E_IOERROR - Paging in a window failed. (MODE_STREAM only)
+     */
+    Position FindNext(const void* pattern, Position length) throw(File_Exception);
+    Position FindNext(const char* pattern) throw(File_Exception);
+
+    /* Finds everywhere a pattern of bytes shows up in the file, including
+     * where they overlap ("aa" is in "aaa" twice). Doesn't move the internal
+     * file pointer. An empty pattern isn't found anywhere.
+     *
+     * Files larger than a few MB that are all in memory are split up and
+     * searched on every core at once. See: ThreadPool::Default
+     *
+     * Returns: Where each one starts, from first to last.
+     *
+     * Throws: E_OUTOFMEMORY - The list of places couldn't grow.
+     *         E_THREADERROR - The threads to search on couldn't be started.
+     *         E_IOERROR     - Paging in a window failed. (MODE_STREAM only)
+     */
+    std::vector<Position> FindAll(const void* pattern, Position length) throw(File_Exception);
+    std::vector<Position> FindAll(const char* pattern) throw(File_Exception);
+
+    /* Counts how many times a pattern of bytes shows up in the file, the
+     * same way FindAll does, without keeping track of where.
+     *
+     * Throws: E_OUTOFMEMORY - The search couldn't be set up.
+     *         E_THREADERROR - The threads to search on couldn't be started.
+     *         E_IOERROR     - Paging in a window failed. (MODE_STREAM only)
+     */
+    Position Count(const void* pattern, Position length) throw(File_Exception);
+    Position Count(const char* pattern) throw(File_Exception);
+
+    /* Gets the lines of the file, from the internal file pointer on, for
+     * going through with a range-based for:
+     *
+     *   for(File::View line : file.Lines())
+     *
+     * Lines come back without their terminator, however long they are, and
+     * a terminator at the very end of the file doesn't start another line.
+     * Doesn't move the internal file pointer. See File_Range.h for how long
+     * each line can be used for.
+     *
+     * terminator: The signal of the end of a line.
+     *
+     * Throws: Nothing, but going through the range can. See: Range::iterator
      */
-    unsigned Read(void* output, unsigned maxLength) throw();
+    Range Lines(char terminator = '\n') throw();
+
+    /* Gets the file split into size byte records, from the internal file
+     * pointer on. The last record is shorter if the file doesn't split
+     * evenly. Otherwise works the same as Lines.
+     *
+     * Throws: E_INVALIDSIZE - size is 0.
+     */
+    Range Records(Position size) throw(File_Exception);
 
     /* Re-opens the file. Does not write out the buffer before closing.
      * If you want the file to be written out, call "SaveFile"
@@ -223,7 +756,7 @@ namespace File
      * Throws: E_INVALIDPOSITION - Invalid position specified.
      * Status after Throw: No change.
      */
-    void SetPos(unsigned position) throw(File_Exception);
+    void SetPos(Position position) throw(File_Exception);
 
     /* Moves the internal file pointer to a specified offset. Note that
      * when using SEEK_END, you must specify a negative offset.
@@ -235,7 +768,7 @@ namespace File
      *         E_INVALIDPOSITION - Invalid origin specified.
      * Status after Throw: No change.
      */
-    void Seek(int offset, Seek_Origin origin) throw(File_Exception);
+    void Seek(Offset offset, Seek_Origin origin) throw(File_Exception);
 
     /* Writes data to the file buffer.
      * 
@@ -247,12 +780,163 @@ namespace File
      * objectSize: How large each object to be written is.
      * numObjects: How many objects to write to the buffer.
      *
-     * Throws: E_OUTOFMEMORY - new had an error allocating extra memory.
-     *         E_PROTECTED   - Attempt to write to protected file area.
+     * The buffer is grown at most once and the data is copied in one go.
+     * Either all of the data is written, or none of it is. (A streamed file
+     * can be left part way through if paging a window in or out fails.)
+     *
+     * Throws: E_OUTOFMEMORY  - new had an error allocating extra memory.
+     *         E_PROTECTED    - Attempt to write to protected file area.
+     *         E_FILETOOLARGE - The file would grow past the largest size it can be.
+     *         E_IOERROR      - Paging a window in or out failed. (MODE_STREAM only)
+     */
+    void Write(const void* data, Position numBytes, bool ignoreErrors = false) throw(File_Exception);
+    void Write(const void* data, Position objectSize, Position numObjects, bool ignoreErrors = false) throw(File_Exception);
+
+    /* Writes a value straight into the file, the same way Write(data,
+     * numBytes) does: one check, then one copy. Anything that can be copied
+     * byte for byte can be written, but not pointers, since what they point
+     * at wouldn't be.
+     *
+     * Order: The byte order to store the value in, LittleEndian or
+     *        BigEndian. Left out, it's the machine's own (NativeEndian).
+     *        Only numbers can be written in the other order. See: File_Endian.h
+     *
+     * Throws: See: Write(data, numBytes)
+     */
+    template <typename T> void Write(const T& value) throw(File_Exception);
+    template <typename Order, typename T> typename Endian::IfOrder<Order, void>::type Write(const T& value) throw(File_Exception);
+
+    /* Writes count values in one go. Values in the other byte order are
+     * copied in and then swapped where they are, 16 bytes at a time.
+     * See: Write(const T&)
+     */
+    template <typename T> void WriteArray(const T* values, Position count) throw(File_Exception);
+    template <typename Order, typename T> typename Endian::IfOrder<Order, void>::type WriteArray(const T* values, Position count) throw(File_Exception);
+
+    /* Inserts data into the file, moving everything after it along, rather
+     * than writing over what's there. Leaves the file pointer after the
+     * inserted data, the same as Write.
+     *
+     * The buffer keeps a gap where it was last edited, so inserting and
+     * erasing near there only moves the bytes in between, not everything
+     * after them. The gap is closed up again, moving everything after it
+     * once, the next time the file is read, written or saved, so edits that
+     * come together are cheapest done together. With MODE_PIECES, only the
+     * pieces around position are split up, and nothing is moved.
+     *
+     * position: Where to insert the data. Can be the end of the file.
+     *           Leave it out to insert at the file pointer.
+     * data: What to insert. Can be part of this file.
+     * numBytes: How many bytes to insert.
+     *
+     * Throws: E_PROTECTED       - position is in the protected part of the file.
+     *         E_PROTECTED       - The file is read-only.
+     *         E_INVALIDPOSITION - position is past the end of the file.
+     *         E_BADFLAGS        - The file is streamed. Only files in memory, or opened with MODE_PIECES, can be edited this way.
+     *         E_OUTOFMEMORY     - The buffer couldn't grow.
+     *         E_FILETOOLARGE    - The file would grow past the largest size it can be.
+     * Status after Throw: No change.
+     */
+    void Insert(Position position, const void* data, Position numBytes) throw(File_Exception);
+    void Insert(const void* data, Position numBytes) throw(File_Exception);
+
+    /* Removes bytes from the file, moving everything after them back, and
+     * leaves the file pointer where they were. Uses the same gap as Insert.
+     *
+     * position: Where the bytes to remove start. Leave it out to remove
+     *           them from the file pointer on.
+     * numBytes: How many bytes to remove. Stops at the end of the file.
+     *
+     * Throws: See: Insert
+     * Status after Throw: No change.
+     */
+    void Erase(Position position, Position numBytes) throw(File_Exception);
+    void Erase(Position numBytes) throw(File_Exception);
+
+    /* Starts a transaction. Every edit made from here on (writing, Insert
+     * and Erase) keeps a copy of the bytes it writes over or erases, so
+     * Rollback can put them back. Only the bytes that were touched are
+     * kept, and writing sequentially is kept as one edit, so the journal
+     * and rolling it back cost as much as the edits, not the file.
+     *
+     * Transactions can be started inside of each other. Each one is a
+     * savepoint that Commit or Rollback ends on its own, without ending
+     * the one around it.
+     *
+     * Transactions only cover the contents of the file, not saving it:
+     * Flush and WriteFile save it as it is, in the middle of a transaction
+     * or not, and a rollback after saving is only saved the next time.
+     * Opening or closing the file drops every transaction, and copies of
+     * the File don't share them.
+     *
+     * Throws: E_OUTOFMEMORY - The transaction couldn't be started.
+     */
+    void BeginTransaction() throw(File_Exception);
+
+    /* Ends the innermost transaction, keeping its edits. Inside of another
+     * transaction, they can still be rolled back with that one.
+     *
+     * Throws: E_NOTRANSACTION - No transaction has been started.
+     */
+    void Commit() throw(File_Exception);
+
+    /* Ends the innermost transaction, undoing its edits from the latest back,
+     * and puts the file pointer back where it was when it began.
+     *
+     * Throws: E_NOTRANSACTION - No transaction has been started.
+     *         E_OUTOFMEMORY   - The buffer couldn't grow to put erased bytes back.
+     *         E_IOERROR       - Paging a window in or out failed. (MODE_STREAM only)
+     * Status after Throw: The edits undone so far stay undone. Calling
+     *                     Rollback again carries on from there.
      */
-    void Write(const void* data, unsigned numBytes, bool ignoreErrors = false) throw(File_Exception);
-    void Write(const void* data, unsigned objectSize, unsigned numObjects, bool ignoreErrors = false) throw(File_Exception);
+    void Rollback() throw(File_Exception);
+
+    /* How many transactions are going on inside each other. 0 outside of
+     * any transaction.
+     */
+    unsigned TransactionDepth() const throw();
   private:
+    friend class Range;
+    friend class Range::iterator;
+    friend class IORing;
+
+    // Opens a file whose contents were already read into loaded, the same
+    // way Open would have read them in. Takes over loaded, or frees it if
+    // this throws. Used to read files in through io_uring. See: OpenAsync
+    File(const char* filename, Mode mode, Allocator& allocator, Buffer* loaded, Position loadedSize) throw(File_Exception);
+
+    // Open, taking over loaded (the first loadedSize bytes of which are
+    // the file) rather than reading the file in, if it isn't NULL.
+    void Open(const char* filename, Mode mode, Buffer* loaded, Position loadedSize) throw(File_Exception);
+
+    // Finishes off a file just read into the buffer: translates newlines,
+    // and works out whether saving has to rewrite all of it.
+    // size: How large the file is on disk.
+    void FinishLoad(Position size) throw();
+
+    // Reads a number of some type out of text. See: Parse::Number
+    typedef ParseResult (*Parser)(const char*& at, const char* end, void* value);
+
+    // Runs parser on the text at the file pointer, after skipping
+    // whitespace in text mode, and moves past what it read.
+    ParseResult ParseNext(Parser parser, void* value) throw(File_Exception);
+
+    // Runs parser up to count times, size bytes further into values each time.
+    Position ParseMany(Parser parser, void* values, std::size_t size, Position count) throw(File_Exception);
+
+    // Moves the file pointer past any whitespace. Used in text mode.
+    void SkipWhitespace() throw(File_Exception);
+
+    // Reads one of Scan's arguments.
+    ParseResult ScanOne(int& value) throw(File_Exception)                { return ReadInt(value); }
+    ParseResult ScanOne(long long& value) throw(File_Exception)          { return ReadInt(value); }
+    ParseResult ScanOne(unsigned& value) throw(File_Exception)           { return ReadUInt(value); }
+    ParseResult ScanOne(unsigned long long& value) throw(File_Exception) { return ReadUInt(value); }
+    ParseResult ScanOne(double& value) throw(File_Exception)             { return ReadDouble(value); }
+
+    template <std::size_t Length>
+    ParseResult ScanOne(char (&token)[Length]) throw(File_Exception)   { return ReadToken(token, Length); }
+
     File();
 
     // Copies over the data and the status of the other file.
@@ -261,17 +945,486 @@ namespace File
     // Applies defaults to a given mode.
     void ApplyDefaults(Mode& mode);
 
+    // Stops using the internal buffer. It's freed once no copies use it either.
+    void FreeBuffer() throw();
+
+    // Makes a view into the buffer, checked against views_ in debug builds.
+    View MakeView(const char* data, Position size) throw();
+
+    // Tells the views into the buffer that the memory they point at is gone.
+    // Const so closing the gap can call it; only what views_ points at changes.
+    void InvalidateViews() const throw();
+
+    // Makes sure the file can be edited at position with Insert or Erase.
+    void CheckEdit(Position position) const throw(File_Exception);
+
+    // Opens a gap at position the size of all of the room left in the buffer.
+    void OpenGap(Position position) throw();
+
+    // Moves the gap to position, moving the bytes in between across it.
+    void MoveGap(Position position) throw();
+
+    // Puts the buffer back in one piece, so the file is all together at the
+    // start of it again. Only moves memory the first time after an edit,
+    // and only unpacks a compressed file the first time after opening it.
+    // Const, since it doesn't change what's in the file, but moving the
+    // bytes after the gap still invalidates the views into them.
+    void CloseGap() const throw(File_Exception)
+    {
+      if(gapSize_ != 0)
+        CloseGapNow();
+
+      if(packed_ != NULL)
+        Unpack(0, fileSize_);
+    }
+
+    void CloseGapNow() const throw();
+
+    // Where position is in the buffer: counted from the start of the
+    // window, and past the gap if it's after it. Only for bytes Readable or
+    // Writable said were there.
+    char* At(Position position) const throw()
+    {
+      return &file_[position - windowStart_ + (position < gapStart_ ? 0 : gapSize_)];
+    }
+
+    // Notes that everything in the file from position on has moved.
+    void Edited(Position position) throw();
+
+    // Unpacks the blocks of a compressed file holding [start, end), and
+    // lets go of the compressed file once they're all unpacked. Returns
+    // where the last of those blocks ends.
+    Position Unpack(Position start, Position end) const throw(File_Exception);
+
+    // Undoes an edit from the journal: replaces the bytes it put in with
+    // the savedLength bytes at saved.
+    void Restore(const Journal::Edit& edit, const char* saved) throw(File_Exception);
+
+    // Gets the maxLength bytes from position on, or up to the next terminator
+    // if stopAtTerminator, and moves position past them (and the terminator).
+    // Points into the buffer if they're in one piece, otherwise copies them
+    // together into spill.
+    View Piece(Position& position, Position maxLength, bool stopAtTerminator, char terminator, std::vector<char>& spill) throw(File_Exception);
+
+    // Checks that numBytes can be written at the file pointer. False if
+    // they can't and errors are being ignored.
+    bool CanWrite(Position numBytes, bool ignoreErrors) throw(File_Exception);
+
+    // Notes that count bytes were just put in the buffer at the file
+    // pointer, and moves past them.
+    void Wrote(Position count) throw();
+
+    // Writes count values of size bytes each, swapping their bytes on the way.
+    void WriteSwapped(const void* data, Position size, Position count) throw(File_Exception);
+
+    // Finds the first place pattern starts from from on. Looks across the
+    // seams between windows of a streamed file too.
+    Position FindFrom(const Pattern& pattern, Position from) throw(File_Exception);
+
+    // Finds every place pattern starts in a file that's all in memory, on
+    // every core at once. Fills in found, or just adds them up in count.
+    void FindEverywhere(const Pattern& pattern, std::vector<Position>* found, Position* count) throw(File_Exception);
+
+    // Gives this File a buffer of its own if it's sharing one, so it can be
+    // written to.
+    void Unshare() throw(File_Exception);
+
+    // Gets how many bytes starting at position can be read straight out of
+    // the buffer. When streaming, pages in the window holding position first.
+    Position Readable(Position position) throw(File_Exception);
+
+    // Gets how many of numBytes bytes starting at position can be written
+    // straight into the buffer, growing it or paging in a window as needed.
+    Position Writable(Position position, Position numBytes) throw(File_Exception);
+
+    // Streaming only. Pages in the window that holds position, writing out
+    // the current one first if it was changed.
+    void LoadWindow(Position position) throw(File_Exception);
+
+    // Streaming only. Writes out the changed part of the current window.
+    void FlushWindow() throw(File_Exception);
+
+    // Streaming only. Writes out the current window and lets it go, so the
+    // next access pages in a fresh one.
+    void DropWindow() throw(File_Exception);
+
+    // MODE_PIECES only. Writes the pieces out over the file, and starts a
+    // new piece table on the file that replaced it.
+    void SavePieces() throw(File_Exception);
+
+    // Indexes lines until the index reaches offset, has found line, or
+    // reaches the end of the file, whichever comes first.
+    void IndexLines(Position offset, Position line) throw(File_Exception);
+
+    // Writes just the changed ranges of the buffer over the file in place.
+    // Returns false (without writing anything) if the whole file has to be
+    // rewritten instead.
+    bool WriteChanges() throw(File_Exception);
+
+    // Writes the whole file out to an open file, starting at the beginning.
+    // Translates newlines if needed. Returns how many bytes were written.
+    Position WriteContents(Platform::Handle file) const throw(File_Exception);
+
+    // Whether saving always rewrites the whole file: atomic saves can't be
+    // done in place, and \r\n line endings never line up with the buffer.
+    bool AlwaysRewrites() const throw();
+
+    // Waits for a file to reach the disk, as far as durability_ asks for.
+    void SyncFile(Platform::Handle file) const throw(File_Exception);
+
     bool open_; // Whether or not the file is currently opened.
 
-    char* filename_; // The file we have open
-    char* file_;     // The internal buffer that contains the contents of the file.
+    Allocator* allocator_; // Where the memory for the buffer and filename comes from.
 
-    unsigned fileSize_;   // The size of the file inside the buffer.
-    unsigned bufferSize_; // The size of the internal buffer.
-    unsigned currentPos_; // The current position of where we're reading/writing at in the buffer.
-    unsigned protectEnd_; // The last byte in the file that is protected from writing to.
+    char*   filename_; // The file we have open
+    Buffer* buffer_;   // The internal buffer, possibly shared with copies of this File. NULL if there isn't one.
+    char*   file_;     // The contents of the file inside buffer_. Same as buffer_->Data().
+
+    Position fileSize_;   // The size of the file inside the buffer.
+    Position bufferSize_; // The size of the internal buffer. Same as buffer_->Size().
+    Position currentPos_; // The current position of where we're reading/writing at in the buffer.
+    Position protectEnd_; // The last byte in the file that is protected from writing to.
     Mode     mode_;       // How the file is opened.
+
+    Platform::Handle stream_; // The file, kept open while streaming. InvalidHandle otherwise.
+    Position windowStart_;    // Where in the file file_[0] is. Always 0 unless streaming.
+    Position windowSize_;     // How large the window is when streaming.
+    Durability durability_;   // How sure saving makes that the file is on the disk.
+    Position diskSize_;       // How large the file is on disk, as of the last time it was read or written.
+    PieceTable* pieces_;      // MODE_PIECES only. What the file is made of since it was last saved. NULL otherwise.
+    mutable Packed* packed_;  // MODE_COMPRESSED only. The blocks not unpacked yet. NULL once they all are.
+
+    RangeSet dirty_;   // The parts of the file changed since it was last written out.
+    bool     rewrite_; // Whether the next save has to rewrite the whole file rather than just dirty_.
+
+    mutable Position gapStart_; // Where the gap left by Insert and Erase starts in the buffer.
+    mutable Position gapSize_;  // How large the gap is. 0 when the file is all in one piece, as everything but Insert and Erase expects.
+
+    LineIndex lines_; // Where the lines start, as far as anyone has asked.
+
+    Journal journal_; // What the edits since BeginTransaction took the place of.
+
+    ViewCheck* views_; // Debug builds only. Shared with the views into the buffer. NULL until a view is made.
   };
+
+  template <typename A>
+  void File::Format(const A& a)
+  {
+    Text::Formatter output(*this);
+
+    output.Add(a);
+
+    output.Flush();
+  }
+
+  template <typename A, typename B>
+  void File::Format(const A& a, const B& b)
+  {
+    Text::Formatter output(*this);
+
+    output.Add(a);
+    output.Add(b);
+
+    output.Flush();
+  }
+
+  template <typename A, typename B, typename C>
+  void File::Format(const A& a, const B& b, const C& c)
+  {
+    Text::Formatter output(*this);
+
+    output.Add(a);
+    output.Add(b);
+    output.Add(c);
+
+    output.Flush();
+  }
+
+  template <typename A, typename B, typename C, typename D>
+  void File::Format(const A& a, const B& b, const C& c, const D& d)
+  {
+    Text::Formatter output(*this);
+
+    output.Add(a);
+    output.Add(b);
+    output.Add(c);
+    output.Add(d);
+
+    output.Flush();
+  }
+
+  template <typename A, typename B, typename C, typename D, typename E>
+  void File::Format(const A& a, const B& b, const C& c, const D& d, const E& e)
+  {
+    Text::Formatter output(*this);
+
+    output.Add(a);
+    output.Add(b);
+    output.Add(c);
+    output.Add(d);
+    output.Add(e);
+
+    output.Flush();
+  }
+
+  template <typename A, typename B, typename C, typename D, typename E, typename F>
+  void File::Format(const A& a, const B& b, const C& c, const D& d, const E& e, const F& f)
+  {
+    Text::Formatter output(*this);
+
+    output.Add(a);
+    output.Add(b);
+    output.Add(c);
+    output.Add(d);
+    output.Add(e);
+    output.Add(f);
+
+    output.Flush();
+  }
+
+  template <typename A, typename B, typename C, typename D, typename E, typename F, typename G>
+  void File::Format(const A& a, const B& b, const C& c, const D& d, const E& e, const F& f, const G& g)
+  {
+    Text::Formatter output(*this);
+
+    output.Add(a);
+    output.Add(b);
+    output.Add(c);
+    output.Add(d);
+    output.Add(e);
+    output.Add(f);
+    output.Add(g);
+
+    output.Flush();
+  }
+
+  template <typename A, typename B, typename C, typename D, typename E, typename F, typename G, typename H>
+  void File::Format(const A& a, const B& b, const C& c, const D& d, const E& e, const F& f, const G& g, const H& h)
+  {
+    Text::Formatter output(*this);
+
+    output.Add(a);
+    output.Add(b);
+    output.Add(c);
+    output.Add(d);
+    output.Add(e);
+    output.Add(f);
+    output.Add(g);
+    output.Add(h);
+
+    output.Flush();
+  }
+
+  template <typename A, typename B, typename C, typename D, typename E, typename F, typename G, typename H, typename I>
+  void File::Format(const A& a, const B& b, const C& c, const D& d, const E& e, const F& f, const G& g, const H& h, const I& i)
+  {
+    Text::Formatter output(*this);
+
+    output.Add(a);
+    output.Add(b);
+    output.Add(c);
+    output.Add(d);
+    output.Add(e);
+    output.Add(f);
+    output.Add(g);
+    output.Add(h);
+    output.Add(i);
+
+    output.Flush();
+  }
+
+  template <typename A, typename B, typename C, typename D, typename E, typename F, typename G, typename H, typename I, typename J>
+  void File::Format(const A& a, const B& b, const C& c, const D& d, const E& e, const F& f, const G& g, const H& h, const I& i, const J& j)
+  {
+    Text::Formatter output(*this);
+
+    output.Add(a);
+    output.Add(b);
+    output.Add(c);
+    output.Add(d);
+    output.Add(e);
+    output.Add(f);
+    output.Add(g);
+    output.Add(h);
+    output.Add(i);
+    output.Add(j);
+
+    output.Flush();
+  }
+
+  template <typename A>
+  unsigned File::Scan(A& a)
+  {
+    return (ScanOne(a) == PARSE_OK ? 1 : 0);
+  }
+
+  template <typename A, typename B>
+  unsigned File::Scan(A& a, B& b)
+  {
+    if(ScanOne(a) != PARSE_OK)
+      return 0;
+
+    return 1 + Scan(b);
+  }
+
+  template <typename A, typename B, typename C>
+  unsigned File::Scan(A& a, B& b, C& c)
+  {
+    if(ScanOne(a) != PARSE_OK)
+      return 0;
+
+    return 1 + Scan(b, c);
+  }
+
+  template <typename A, typename B, typename C, typename D>
+  unsigned File::Scan(A& a, B& b, C& c, D& d)
+  {
+    if(ScanOne(a) != PARSE_OK)
+      return 0;
+
+    return 1 + Scan(b, c, d);
+  }
+
+  template <typename A, typename B, typename C, typename D, typename E>
+  unsigned File::Scan(A& a, B& b, C& c, D& d, E& e)
+  {
+    if(ScanOne(a) != PARSE_OK)
+      return 0;
+
+    return 1 + Scan(b, c, d, e);
+  }
+
+  template <typename A, typename B, typename C, typename D, typename E, typename F>
+  unsigned File::Scan(A& a, B& b, C& c, D& d, E& e, F& f)
+  {
+    if(ScanOne(a) != PARSE_OK)
+      return 0;
+
+    return 1 + Scan(b, c, d, e, f);
+  }
+
+  template <typename A, typename B, typename C, typename D, typename E, typename F, typename G>
+  unsigned File::Scan(A& a, B& b, C& c, D& d, E& e, F& f, G& g)
+  {
+    if(ScanOne(a) != PARSE_OK)
+      return 0;
+
+    return 1 + Scan(b, c, d, e, f, g);
+  }
+
+  template <typename A, typename B, typename C, typename D, typename E, typename F, typename G, typename H>
+  unsigned File::Scan(A& a, B& b, C& c, D& d, E& e, F& f, G& g, H& h)
+  {
+    if(ScanOne(a) != PARSE_OK)
+      return 0;
+
+    return 1 + Scan(b, c, d, e, f, g, h);
+  }
+
+  template <typename A, typename B, typename C, typename D, typename E, typename F, typename G, typename H, typename I>
+  unsigned File::Scan(A& a, B& b, C& c, D& d, E& e, F& f, G& g, H& h, I& i)
+  {
+    if(ScanOne(a) != PARSE_OK)
+      return 0;
+
+    return 1 + Scan(b, c, d, e, f, g, h, i);
+  }
+
+  template <typename A, typename B, typename C, typename D, typename E, typename F, typename G, typename H, typename I, typename J>
+  unsigned File::Scan(A& a, B& b, C& c, D& d, E& e, F& f, G& g, H& h, I& i, J& j)
+  {
+    if(ScanOne(a) != PARSE_OK)
+      return 0;
+
+    return 1 + Scan(b, c, d, e, f, g, h, i, j);
+  }
+
+  template <typename T>
+  bool File::Read(T& value)
+  {
+    return Read<NativeEndian>(value);
+  }
+
+  template <typename Order, typename T>
+  typename Endian::IfOrder<Order, bool>::type File::Read(T& value)
+  {
+    static_assert(std::is_trivially_copyable<T>::value && !std::is_pointer<T>::value, "Only values that can be copied byte for byte can be read.");
+
+    if(currentPos_ > fileSize_ || fileSize_ - currentPos_ < sizeof(T))
+      return false;
+
+    Read(static_cast<void*>(&value), sizeof(T));
+    Endian::Convert<Order>(value);
+
+    return true;
+  }
+
+  template <typename T>
+  Position File::ReadArray(T* values, Position count)
+  {
+    return ReadArray<NativeEndian>(values, count);
+  }
+
+  template <typename Order, typename T>
+  typename Endian::IfOrder<Order, Position>::type File::ReadArray(T* values, Position count)
+  {
+    static_assert(std::is_trivially_copyable<T>::value && !std::is_pointer<T>::value, "Only values that can be copied byte for byte can be read.");
+    static_assert(Endian::CanConvert<Order, T>::value, "Only numbers can be converted to another byte order. Read the members one at a time.");
+
+    // Only whole values.
+    const Position left = (currentPos_ < fileSize_ ? (fileSize_ - currentPos_) / sizeof(T) : 0);
+
+    if(count > left)
+      count = left;
+
+    Read(static_cast<void*>(values), count * sizeof(T));
+
+    if(Endian::NeedsSwap<Order>::value)
+      Endian::SwapArray(values, sizeof(T), static_cast<std::size_t>(count));
+
+    return count;
+  }
+
+  template <typename T>
+  void File::Write(const T& value)
+  {
+    Write<NativeEndian>(value);
+  }
+
+  template <typename Order, typename T>
+  typename Endian::IfOrder<Order, void>::type File::Write(const T& value)
+  {
+    static_assert(std::is_trivially_copyable<T>::value && !std::is_pointer<T>::value, "Only values that can be copied byte for byte can be written.");
+
+    T converted = value;
+    Endian::Convert<Order>(converted);
+
+    Write(static_cast<const void*>(&converted), sizeof(T));
+  }
+
+  template <typename T>
+  void File::WriteArray(const T* values, Position count)
+  {
+    WriteArray<NativeEndian>(values, count);
+  }
+
+  template <typename Order, typename T>
+  typename Endian::IfOrder<Order, void>::type File::WriteArray(const T* values, Position count)
+  {
+    static_assert(std::is_trivially_copyable<T>::value && !std::is_pointer<T>::value, "Only values that can be copied byte for byte can be written.");
+    static_assert(Endian::CanConvert<Order, T>::value, "Only numbers can be converted to another byte order. Write the members one at a time.");
+
+    if(Endian::NeedsSwap<Order>::value && sizeof(T) > 1)
+      WriteSwapped(values, sizeof(T), count);
+    else
+      Write(static_cast<const void*>(values), sizeof(T), count);
+  }
+
+  // Lets std algorithms and containers swap Files without copying them.
+  inline void swap(File& lhs, File& rhs) throw()
+  {
+    lhs.Swap(rhs);
+  }
 }
 
 #endif
\ No newline at end of file
@@ -6,9 +6,39 @@
 
 
 #include "File_Wrapper.h"
+#include "File_Async.h"
+#include "File_Scan.h"
+#include "File_FileSet.h"
+#include "File_Parallel.h"
+#include "File_ErrorCodes.h"
+#include <chrono>
+#include <cmath>
 #include <cstdlib>
 #include <cstdio>
 #include <cstring>
+#include <ctime>
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+// 64-bit fseek, for making files larger than 4 GB
+#ifdef _WIN32
+  #define fseek64 _fseeki64
+#else
+  #define fseek64 fseeko
+#endif
+
+// Making and removing directories, for saves with nowhere to go
+#ifdef _WIN32
+  #include <direct.h>
+  #define makedir(name) _mkdir(name)
+  #define removedir(name) _rmdir(name)
+#else
+  #include <sys/stat.h>
+  #include <unistd.h>
+  #define makedir(name) mkdir(name, 0777)
+  #define removedir(name) rmdir(name)
+#endif
 
 #define flags(f) static_cast<File::Mode>(f)
 #define constlen(s) (sizeof(s) / sizeof(*s))
@@ -447,7 +477,7 @@ void test21(void)
   std::printf("\n");
 
   unsigned char expectedString[10] = {0xFF, 0xFF, 0xFF, 'H', 'e', 'l', 'l', 0xEE, 0xEE, 0xEE};
-  ErrorIf(std::memcmp(expectedString, string, 11) != 0);
+  ErrorIf(std::memcmp(expectedString, string, 10) != 0);
 }
 
 // Test Reopen
@@ -565,6 +595,1734 @@ void test25(void)
     bytesRead != sizeof(checkString) / sizeof(*checkString));
 }
 
+// Test reading through a memory mapped file
+void test26(void)
+{
+  File::File f("testfile.txt", flags(File::MODE_MMAP));
+
+  char string[100];
+  unsigned length = f.GetString(string, 100);
+
+  printf("String was: \"%s\" (Length of %d)\n", string, length);
+  ErrorIf(std::strcmp("This is what's in the first text file.", string) != 0 || !f.EndOfFile());
+
+  // "what's"
+  f.Seek(8, File::SEEK_BEGIN);
+  char word[6];
+  f.Read(word, 6);
+  ErrorIf(std::memcmp("what's", word, 6) != 0);
+
+  // Mappings are read-only.
+  try
+  {
+    f.PutChar('X');
+  }
+  catch ( File::File_Exception e )
+  {
+    printf("Caught expected exception.\n%s\n", e.what());
+
+    // A copy of a mapped file shares the mapping.
+    File::File copy(f);
+    copy.SetPos(0);
+    ErrorIf(copy.GetChar() != 'T');
+    return;
+  }
+
+  ErrorIf(true);
+}
+
+// Test memory mapping an empty file
+void test27(void)
+{
+  File::File f("test27.txt", flags(File::MODE_MMAP | File::MODE_TEXT));
+
+  char string[10];
+  unsigned length = f.GetString(string, 10);
+
+  ErrorIf(!f.EndOfFile() || f.GetChar() != 0 || length != 1 || string[0] != 0);
+}
+
+// Test writing a large block, and writing into a protected area without throwing
+void test28(void)
+{
+  const unsigned size = 1024 * 1024;
+  char* data = new char[size];
+
+  for(unsigned i = 0; i < size; ++i)
+    data[i] = static_cast<char>('a' + i % 26);
+
+  File::File f("test28.txt", flags(File::MODE_WRITE | File::MODE_CLEAR | File::MODE_CREATE));
+  f.PutString("Header\n");
+  f.Write(data, size);
+  f.Close();
+
+  // Everything written so far is protected.
+  File::File check("test28.txt", flags(File::MODE_WRITE | File::MODE_APPEND | File::MODE_PROTECT));
+  check.SetPos(0);
+  check.Write(data, size, true);
+  check.PutString("Overwritten", true);
+
+  ErrorIf(check.GetPos() != 0);
+
+  char header[7];
+  check.Read(header, 7);
+  ErrorIf(std::memcmp(header, "Header\n", 7) != 0);
+
+  char* readBack = new char[size];
+  unsigned bytesRead = check.Read(readBack, size);
+  bool same = (bytesRead == size && std::memcmp(data, readBack, size) == 0);
+
+  delete [] readBack;
+  delete [] data;
+
+  ErrorIf(!same || !check.EndOfFile());
+}
+
+// Test positions past 4 GB
+void test29(void)
+{
+  const File::Position size = 5ULL * 1024 * 1024 * 1024 + 3;
+
+  // Make a sparse file, so it doesn't take up 5 GB of disk space.
+  std::FILE* sparse = std::fopen("test29.bin", "wb");
+  fseek64(sparse, size - 3, SEEK_SET);
+  std::fwrite("End", 1, 3, sparse);
+  std::fclose(sparse);
+
+  bool passed = false;
+
+  {
+    File::File f("test29.bin", flags(File::MODE_MMAP));
+
+    f.SetPos(size);
+    f.Seek(-3, File::SEEK_CURRENT);
+    File::Position endPos = f.GetPos();
+
+    char end[3];
+    File::Position bytesRead = f.Read(end, 100);
+
+    std::printf("Read %llu bytes at position %llu\n", bytesRead, endPos);
+
+    // Past 4 GB, but before the end.
+    f.SetPos(4ULL * 1024 * 1024 * 1024 + 1);
+    char zero = f.GetChar();
+
+    passed = (endPos == size - 3 && bytesRead == 3 && std::memcmp(end, "End", 3) == 0 &&
+              zero == 0 && f.GetPos() == 4ULL * 1024 * 1024 * 1024 + 2);
+  }
+
+  std::remove("test29.bin");
+  ErrorIf(!passed);
+}
+
+// Test streaming a file through a window smaller than the file
+void test30(void)
+{
+  File::File f("test30.txt", flags(File::MODE_WRITE | File::MODE_STREAM | File::MODE_TEXT));
+  f.SetWindowSize(8);
+
+  // Lines cross windows.
+  char string[100];
+  f.GetString(string, 100);
+  printf("First string was: \"%s\"\n", string);
+  ErrorIf(std::strcmp(string, "First line of the file") != 0);
+
+  // Overwrite across a window boundary, then go back and append.
+  File::Position secondLine = f.GetPos() + 1;
+  f.SetPos(secondLine);
+  f.PutString("SECOND");
+
+  f.SetPos(0);
+  ErrorIf(f.GetChar() != 'F');
+
+  f.Seek(0, File::SEEK_CURRENT);
+  f.SetPos(secondLine);
+  f.GetString(string, 100);
+  printf("Second string is now: \"%s\"\n", string);
+  ErrorIf(std::strcmp(string, "SECOND line") != 0);
+
+  f.SetPos(secondLine + 11);
+  f.PutString("\nFourth line, appended past the end");
+  f.Close();
+
+  File::File check("test30.txt", flags(File::MODE_READ));
+  char contents[200] = {0};
+  check.Read(contents, 200);
+  printf("File now contains:\n%s\n", contents);
+  ErrorIf(std::strcmp(contents, "First line of the file\nSECOND line\nFourth line, appended past the end") != 0);
+
+  // Clearing a streamed file cuts it off when it's saved.
+  File::File cleared("test30.txt", flags(File::MODE_WRITE | File::MODE_STREAM | File::MODE_CLEAR));
+  cleared.SetWindowSize(4);
+  cleared.PutString("Cleared");
+  cleared.Close();
+
+  File::File checkCleared("test30.txt", flags(File::MODE_READ));
+  checkCleared.GetString(contents, 200);
+  ErrorIf(std::strcmp(contents, "Cleared") != 0 || !checkCleared.EndOfFile());
+}
+
+// Test editing past 4 GB in a streamed file
+void test31(void)
+{
+  const File::Position size = 5ULL * 1024 * 1024 * 1024;
+
+  std::FILE* sparse = std::fopen("test31.bin", "wb");
+  fseek64(sparse, size - 1, SEEK_SET);
+  std::fwrite("", 1, 1, sparse);
+  std::fclose(sparse);
+
+  bool passed = false;
+
+  {
+    File::File f("test31.bin", flags(File::MODE_WRITE | File::MODE_STREAM | File::MODE_APPEND));
+    f.SetWindowSize(1024 * 1024);
+
+    f.PutString("Past the end");
+    f.SetPos(size - 4);
+    f.PutString("1234");
+    f.Close();
+
+    File::File check("test31.bin", flags(File::MODE_MMAP));
+    check.SetPos(size - 4);
+
+    char string[17] = {0};
+    File::Position bytesRead = check.Read(string, 16);
+    printf("End of file: \"%s\"\n", string);
+
+    passed = (bytesRead == 16 && std::strcmp(string, "1234Past the end") == 0);
+  }
+
+  std::remove("test31.bin");
+  ErrorIf(!passed);
+}
+
+// Test that saving only writes the bytes that changed
+void test32(void)
+{
+  File::File f("test32.txt", flags(File::MODE_WRITE));
+  f.SetPos(4);
+  f.PutChar('X');
+  f.SetPos(6);
+  f.PutChar('Y');
+
+  // Change a byte behind the File's back. It's not part of the changes, so it should survive.
+  std::FILE* other = std::fopen("test32.txt", "r+b");
+  std::fseek(other, 0, SEEK_SET);
+  std::fputc('a', other);
+  std::fclose(other);
+
+  f.Flush();
+
+  char contents[20] = {0};
+  other = std::fopen("test32.txt", "rb");
+  std::fread(contents, 1, 19, other);
+  std::fclose(other);
+  printf("File now contains: \"%s\"\n", contents);
+  ErrorIf(std::strcmp(contents, "a123X5Y789") != 0);
+
+  // A deleted file still gets re-created in full.
+  f.SetPos(0);
+  f.PutChar('Z');
+  std::remove("test32.txt");
+  f.Close();
+
+  File::File check("test32.txt", flags(File::MODE_READ));
+  std::memset(contents, 0, sizeof(contents));
+  check.Read(contents, 19);
+  printf("Re-created file contains: \"%s\"\n", contents);
+  ErrorIf(std::strcmp(contents, "Z123X5Y789") != 0);
+}
+
+// Test saving atomically and durably
+void test33(void)
+{
+  File::File f("test33.txt", flags(File::MODE_WRITE | File::MODE_ATOMIC));
+  f.SetDurability(File::DURABLE_FULL);
+
+  char contents[40] = {0};
+  f.Read(contents, 39);
+  ErrorIf(std::strcmp(contents, "The original, longer contents") != 0);
+
+  f.SetPos(4);
+  f.PutString("new one");
+  f.Flush();
+
+  // A copy saved elsewhere is atomic and durable too, and created from scratch.
+  File::File copy(f);
+  copy.WriteFile("test33b.txt");
+  copy.Close(false);
+
+  f.SetPos(0);
+  f.PutString("Edited again");
+  f.Close();
+
+  File::File check("test33.txt", flags(File::MODE_READ));
+  std::memset(contents, 0, sizeof(contents));
+  check.Read(contents, 39);
+  printf("File now contains: \"%s\"\n", contents);
+  ErrorIf(std::strcmp(contents, "Edited again, longer contents") != 0);
+
+  File::File checkCopy("test33b.txt", flags(File::MODE_READ));
+  std::memset(contents, 0, sizeof(contents));
+  checkCopy.Read(contents, 39);
+  checkCopy.Close(false);
+  std::remove("test33b.txt");
+  printf("Copy contains: \"%s\"\n", contents);
+  ErrorIf(std::strcmp(contents, "The new onel, longer contents") != 0);
+
+  // Streamed files are written in place, so they can't be atomic.
+  try
+  {
+    File::File streamed("test33.txt", flags(File::MODE_WRITE | File::MODE_STREAM | File::MODE_ATOMIC));
+  }
+  catch ( File::File_Exception e )
+  {
+    printf("Caught expected exception.\n%s\n", e.what());
+    return;
+  }
+
+  ErrorIf(true);
+}
+
+// Test that copies share a buffer until one of them writes to it
+void test34(void)
+{
+  File::File f("test34.txt", flags(File::MODE_WRITE));
+  File::File copy(f);
+  File::File another(copy);
+
+  // Writing to the original leaves the copies alone.
+  f.PutString("Changed");
+  char contents[20] = {0};
+  copy.Read(contents, 19);
+  printf("Copy contains: \"%s\"\n", contents);
+  ErrorIf(std::strcmp(contents, "Original") != 0);
+
+  // And writing to a copy leaves the others alone.
+  another.SetPos(0);
+  another.PutString("Another");
+
+  std::memset(contents, 0, sizeof(contents));
+  f.SetPos(0);
+  f.Read(contents, 19);
+  ErrorIf(std::strcmp(contents, "Changedl") != 0);
+
+  std::memset(contents, 0, sizeof(contents));
+  copy.SetPos(0);
+  copy.Read(contents, 19);
+  ErrorIf(std::strcmp(contents, "Original") != 0);
+
+  std::memset(contents, 0, sizeof(contents));
+  another.SetPos(0);
+  another.Read(contents, 19);
+  ErrorIf(std::strcmp(contents, "Anotherl") != 0);
+
+  copy.Close(false);
+  another.Close(false);
+  f.Close(false);
+
+  // A mapping outlives the File that made it while a copy still uses it.
+  File::File* mapped = new File::File("test34.txt", flags(File::MODE_MMAP));
+  File::File mappedCopy(*mapped);
+  delete mapped;
+
+  std::memset(contents, 0, sizeof(contents));
+  mappedCopy.Read(contents, 19);
+  ErrorIf(std::strcmp(contents, "Original") != 0);
+}
+
+// Makes a File for test35, to check returning one doesn't copy it.
+File::File OpenForTest35(const char* filename)
+{
+  File::File f(filename, flags(File::MODE_WRITE | File::MODE_APPEND));
+  f.PutString(" and more");
+  return f;
+}
+
+// Test moving and swapping Files
+void test35(void)
+{
+  File::File f(OpenForTest35("test35a.txt"));
+  ErrorIf(f.GetPos() != 13);
+
+  // Moving into a vector, and growing it, never copies a File.
+  std::vector<File::File> files;
+  files.push_back(std::move(f));
+  files.push_back(File::File("test35b.txt", flags(File::MODE_WRITE)));
+  files.reserve(files.capacity() * 2);
+
+  // A moved-from File is closed, so this doesn't write anything out.
+  f.Close();
+
+  File::File b("test35b.txt", flags(File::MODE_READ));
+  File::swap(files[1], b);
+
+  char contents[20] = {0};
+  files[1].Read(contents, 19);
+  ErrorIf(std::strcmp(contents, "Second") != 0);
+
+  // The moved-to File still writes out its changes.
+  files[0] = File::File("test35b.txt", flags(File::MODE_READ));
+
+  File::File check("test35a.txt", flags(File::MODE_READ));
+  std::memset(contents, 0, sizeof(contents));
+  check.Read(contents, 19);
+  printf("File now contains: \"%s\"\n", contents);
+  ErrorIf(std::strcmp(contents, "Some and more") != 0);
+}
+
+// Test recycling memory between opens with a pool and an arena
+void test36(void)
+{
+  File::PoolAllocator pool;
+  char contents[20] = {0};
+
+  // The second time around, the buffer and filename come out of the pool.
+  for(int i = 0; i < 2; ++i)
+  {
+    File::File f("test36.txt", flags(File::MODE_READ), pool);
+    ErrorIf(pool.Cached() != 0);
+
+    f.Read(contents, 19);
+    ErrorIf(std::strcmp(contents, "Recycled") != 0);
+
+    f.Close();
+    printf("Pool holds %u bytes after closing\n", static_cast<unsigned>(pool.Cached()));
+    ErrorIf(pool.Cached() == 0);
+  }
+
+  // Same block out as went in.
+  char* block = pool.Allocate(100);
+  pool.Free(block, 100);
+  ErrorIf(pool.Allocate(120) != block);
+  pool.Free(block, 120);
+
+  pool.Trim();
+  ErrorIf(pool.Cached() != 0);
+
+  // A batch of files out of an arena, all given back at once.
+  File::ArenaAllocator arena(4096);
+
+  for(int batch = 0; batch < 3; ++batch)
+  {
+    {
+      File::File a("test36.txt", flags(File::MODE_WRITE | File::MODE_APPEND), arena);
+      File::File b("test36.txt", flags(File::MODE_READ), arena);
+      File::File copy(a);
+
+      // Growing past the arena's blocks still works.
+      for(int i = 0; i < 1000; ++i)
+        copy.PutString("More");
+
+      ErrorIf(arena.Used() == 0);
+      copy.Close(false);
+      a.Close(false);
+    }
+
+    arena.Reset();
+    ErrorIf(arena.Used() != 0);
+  }
+}
+
+// Reads a whole file in binary for test37, without any translation.
+unsigned ReadRaw(const char* filename, char* contents, unsigned maxLength)
+{
+  std::FILE* file = std::fopen(filename, "rb");
+  unsigned length = static_cast<unsigned>(std::fread(contents, 1, maxLength - 1, file));
+  std::fclose(file);
+
+  contents[length] = 0;
+  return length;
+}
+
+// Test translating newlines in text mode
+void test37(void)
+{
+  const char crlf[] = "A line long enough to cross a block\r\nShort\r\n\r\nLone\rCR\r\nEnd\r";
+  const char lf[]   = "A line long enough to cross a block\nShort\n\nLone\rCR\nEnd\r";
+
+  std::FILE* raw = std::fopen("test37.txt", "wb");
+  std::fwrite(crlf, 1, sizeof(crlf) - 1, raw);
+  std::fclose(raw);
+
+  // \r\n comes in as \n everywhere.
+  File::File f("test37.txt", flags(File::MODE_WRITE | File::MODE_TEXT | File::MODE_APPEND));
+  ErrorIf(f.GetPos() != sizeof(lf) - 1);
+
+  char contents[200] = {0};
+  f.SetPos(0);
+  f.Read(contents, 199);
+  ErrorIf(std::strcmp(contents, lf) != 0);
+
+  // And goes back out as \n.
+  f.Close();
+  ReadRaw("test37.txt", contents, 200);
+  ErrorIf(std::strcmp(contents, lf) != 0);
+
+  // Unless asked for \r\n.
+  File::File g("test37.txt", flags(File::MODE_WRITE | File::MODE_TEXT | File::MODE_CRLF | File::MODE_APPEND));
+  g.PutString("\n");
+  g.Close();
+
+  ReadRaw("test37.txt", contents, 200);
+  printf("File now contains: \"%s\"\n", contents);
+  ErrorIf(std::strcmp(contents, "A line long enough to cross a block\r\nShort\r\n\r\nLone\rCR\r\nEnd\r\r\n") != 0);
+
+  // Lots of lines, so most of the translating is done in blocks.
+  File::File lines("test37.txt", flags(File::MODE_WRITE | File::MODE_TEXT | File::MODE_CRLF | File::MODE_CLEAR));
+
+  for(int i = 0; i < 1000; ++i)
+    lines.PutString("Line of text\nAnother line of text that's longer\n");
+
+  lines.Close();
+
+  File::File back("test37.txt", flags(File::MODE_READ | File::MODE_TEXT));
+  ErrorIf(back.Read(contents, 199) != 199);
+  ErrorIf(std::strncmp(contents, "Line of text\nAnother line of text that's longer\nLine of text\n", 61) != 0);
+
+  // 2000 lines, each with one \r taken back out.
+  back.SetPos(48000);
+  ErrorIf(!back.EndOfFile());
+}
+
+// Test the vectorized searches against a byte at a time, and time them
+void test38(void)
+{
+  // Every length and every position, so the vector loops and the leftovers
+  // at the end both get checked.
+  char small[100];
+  for(int length = 0; length < 100; ++length)
+  {
+    for(int at = 0; at <= length; ++at)
+    {
+      std::memset(small, 'x', sizeof(small));
+      std::memset(small, ' ', at);
+
+      if(at < length)
+        small[at] = '\n';
+
+      ErrorIf(File::Scan::Find(small, length, '\n') != static_cast<size_t>(at));
+
+      if(at < length)
+        small[at] = '\x80';
+      ErrorIf(File::Scan::SkipSpace(small, length) != static_cast<size_t>(at));
+    }
+  }
+
+  // Lines of all sorts of lengths.
+  const size_t size = 32 * 1024 * 1024;
+  std::vector<char> text(size);
+  for(size_t i = 0, line = 0; i < size; ++line)
+  {
+    size_t length = (line * 7919) % 4000;
+    if(length > size - i - 1)
+      length = size - i - 1;
+    std::memset(&text[i], 'a', length);
+    i += length;
+    text[i++] = '\n';
+  }
+
+  // What GetString used to do.
+  std::clock_t start = std::clock();
+  size_t lines = 0;
+  for(size_t i = 0; i < size; ++lines)
+  {
+    size_t count = 0;
+    while(i + count < size && text[i + count] != '\n')
+      ++count;
+
+    i += count + 1;
+  }
+  const double scalar = static_cast<double>(std::clock() - start) / CLOCKS_PER_SEC;
+
+  // What it does now.
+  start = std::clock();
+  size_t scanLines = 0;
+  for(size_t i = 0; i < size; ++scanLines)
+    i += File::Scan::Find(&text[i], size - i, '\n') + 1;
+  const double scan = static_cast<double>(std::clock() - start) / CLOCKS_PER_SEC;
+
+  printf("%u lines. Byte at a time: %.3fs, %s: %.3fs\n", static_cast<unsigned>(lines), scalar, File::Scan::Implementation(), scan);
+  ErrorIf(lines != scanLines);
+}
+
+// Test going straight to lines, and the line index keeping up with writes
+void test39(void)
+{
+  File::File f("test39.txt", flags(File::MODE_WRITE));
+  printf("File has %u lines\n", static_cast<unsigned>(f.LineCount()));
+  ErrorIf(f.LineCount() != 4);
+
+  // Blank lines and leading spaces come back as they are.
+  char line[20];
+  ErrorIf(f.GetLine(2, line, 20) != 8);
+  printf("Line 2 is: \"%s\"\n", line);
+  ErrorIf(std::strcmp(line, "  Gamma") != 0);
+  f.GetLine(1, line, 20);
+  ErrorIf(line[0] != 0);
+
+  // Left at the start of the next line.
+  ErrorIf(f.GetChar() != ' ');
+  f.SeekToLine(3);
+  ErrorIf(f.GetChar() != 'D');
+
+  // Too long a line gets cut off.
+  ErrorIf(f.GetLine(0, line, 4) != 4 || std::strcmp(line, "Alp") != 0);
+  ErrorIf(f.GetPos() != 3);
+
+  ErrorIf(f.LineStart(3) != 15 || f.LineOf(15) != 3 || f.LineOf(14) != 2);
+
+  // Writing a newline over the middle of a line splits it in two.
+  f.SetPos(2);
+  f.PutString("\n");
+  ErrorIf(f.LineCount() != 5);
+  f.GetLine(1, line, 20);
+  printf("Line 1 is now: \"%s\"\n", line);
+  ErrorIf(std::strcmp(line, "ha") != 0);
+  ErrorIf(f.LineOf(15) != 4);
+
+  // The same file through a window smaller than its lines.
+  f.Close();
+  File::File streamed("test39.txt", flags(File::MODE_READ | File::MODE_STREAM));
+  streamed.SetWindowSize(3);
+  ErrorIf(streamed.GetLine(2, line, 20) != 1);
+  streamed.GetLine(4, line, 20);
+  printf("Streamed line 4 is: \"%s\"\n", line);
+  ErrorIf(std::strcmp(line, "Delta") != 0);
+  ErrorIf(streamed.LineCount() != 5);
+
+  // The trailing newline ends the last line, it doesn't start another.
+  try
+  {
+    streamed.SeekToLine(5);
+  }
+  catch(File::File_Exception e)
+  {
+    printf("Caught expected exception.\n%s\n", e.what());
+    return;
+  }
+
+  ErrorIf(true);
+}
+
+// Test looking at the buffer in place rather than copying out of it
+void test40(void)
+{
+  File::File f("test40.txt", flags(File::MODE_READ));
+
+  // Lines come back without their terminators, blank ones included.
+  const char* expected[] = {"key=value", "second line", "", "last"};
+  for(int i = 0; i < 4; ++i)
+  {
+    File::View line = f.GetLineView();
+    printf("Line %d is: \"%.*s\"\n", i, static_cast<int>(line.Size()), line.Data());
+    ErrorIf(line.Size() != std::strlen(expected[i]) || std::memcmp(line.Data(), expected[i], line.Size()) != 0);
+  }
+  ErrorIf(!f.GetLineView().Empty());
+
+  // Views point into the buffer, so reading the same place twice gives the same memory.
+  f.SetPos(4);
+  File::View value = f.ReadView(5);
+  ErrorIf(f.GetPos() != 9);
+  f.SetPos(4);
+  ErrorIf(f.ReadView(100).Data() != value.Data());
+  ErrorIf(value.Size() != 5 || std::memcmp(value.begin(), "value", 5) != 0);
+
+  // A mapped file is viewed where it's mapped.
+  File::File mapped("test40.txt", flags(File::MODE_READ | File::MODE_MMAP));
+  File::View all = mapped.ReadView(1000);
+  ErrorIf(all.Size() < 27 || all[0] != 'k' || all[all.Size() - 1] != 't');
+
+  // A streamed line that crosses windows comes back in parts.
+  File::File streamed("test40.txt", flags(File::MODE_READ | File::MODE_STREAM));
+  streamed.SetWindowSize(8);
+  File::View first = streamed.GetLineView();
+  ErrorIf(first.Size() != 8 || std::memcmp(first.Data(), "key=valu", 8) != 0);
+  File::View rest = streamed.GetLineView();
+  printf("Rest of the line is: \"%.*s\"\n", static_cast<int>(rest.Size()), rest.Data());
+  ErrorIf(rest.Size() == 0 || rest[0] != 'e');
+}
+
+// Test going through a file a line or a record at a time
+void test41(void)
+{
+  // One line far longer than anything GetString would be given room for.
+  std::vector<char> contents(10000, 'x');
+  const char rest[] = "\nshort\n\nlast\n";
+  contents.insert(contents.end(), rest, rest + sizeof(rest) - 1);
+
+  std::FILE* raw = std::fopen("test41.txt", "wb");
+  std::fwrite(&contents[0], 1, contents.size(), raw);
+  std::fclose(raw);
+
+  File::File f("test41.txt", flags(File::MODE_READ));
+  std::vector<File::Position> lengths;
+  for(File::View line : f.Lines())
+    lengths.push_back(line.Size());
+
+  printf("%u lines, the first %u long\n", static_cast<unsigned>(lengths.size()), static_cast<unsigned>(lengths[0]));
+  ErrorIf(lengths.size() != 4 || lengths[0] != 10000 || lengths[1] != 5 || lengths[2] != 0 || lengths[3] != 4);
+  ErrorIf(f.GetPos() != 0);
+
+  // Works with the standard algorithms.
+  File::Range lines = f.Lines();
+  ErrorIf(std::count_if(lines.begin(), lines.end(), [](const File::View& line) { return line.Empty(); }) != 1);
+
+  // Records, with a short one at the end.
+  f.SetPos(10000);
+  unsigned records = 0;
+  File::Position last = 0;
+  for(File::View record : f.Records(4))
+  {
+    ++records;
+    last = record.Size();
+  }
+  ErrorIf(records != 4 || last != 1);
+
+  // Streamed through small windows, long lines and records are put together.
+  File::File streamed("test41.txt", flags(File::MODE_READ | File::MODE_STREAM));
+  streamed.SetWindowSize(64);
+
+  File::Range::iterator line = streamed.Lines().begin();
+  ErrorIf(line->Size() != 10000 || (*line)[9999] != 'x');
+
+  // A copy of the iterator has the whole line too.
+  File::Range::iterator copy = line;
+  ++line;
+  ErrorIf(copy->Size() != 10000 || (*copy)[0] != 'x');
+  ErrorIf(line->Size() != 5 || std::memcmp(line->Data(), "short", 5) != 0);
+
+  records = 0;
+  for(File::View record : streamed.Records(100))
+    records += (record.Size() == 100);
+  ErrorIf(records != 100);
+}
+
+// Test opening a batch of files side by side
+void test42(void)
+{
+  // Lots of small files, and one that isn't there.
+  const unsigned count = 64;
+  char name[32];
+  char contents[32];
+
+  File::FileSet set;
+  for(unsigned i = 0; i < count; ++i)
+  {
+    std::sprintf(name, "test42_%u.txt", i);
+    std::sprintf(contents, "File number %u", i);
+    std::FILE* raw = std::fopen(name, "wb");
+    std::fputs(contents, raw);
+    std::fclose(raw);
+    ErrorIf(set.Add(name) != i);
+  }
+  const size_t missing = set.Add("test42_missing.txt");
+
+  // Wall-clock time, since the point is that the files load side by side.
+  // std::clock adds up the time spent on every thread.
+  const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  set.Load(4);
+  printf("Loaded %u files in %.3fs\n", static_cast<unsigned>(set.Count()),
+         std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+
+  // Each file is where it was added, whatever order they were opened in.
+  for(unsigned i = 0; i < count; ++i)
+  {
+    std::sprintf(contents, "File number %u", i);
+    ErrorIf(set.Failed(i));
+
+    File::View view = set.Get(i).ReadView(100);
+    ErrorIf(view.Size() != std::strlen(contents) || std::memcmp(view.Data(), contents, view.Size()) != 0);
+  }
+
+  // A file can be moved out of the set.
+  File::File kept = std::move(set.Get(0));
+  kept.SetPos(0);
+  ErrorIf(kept.GetChar() != 'F');
+
+  for(unsigned i = 0; i < count; ++i)
+  {
+    std::sprintf(name, "test42_%u.txt", i);
+    std::remove(name);
+  }
+
+  // The missing file doesn't stop the others, and its error is kept.
+  ErrorIf(!set.Failed(missing) || set.Error(missing).whatcode() != File::E_FOPENERROR);
+
+  try
+  {
+    set.Get(missing);
+  }
+  catch(File::File_Exception e)
+  {
+    printf("Caught expected exception.\n%s\n", e.what());
+    return;
+  }
+
+  ErrorIf(true);
+}
+
+// Test opening, saving and closing files in the background
+void test43(void)
+{
+  // Several at once.
+  std::vector<std::future<File::File> > opening;
+  for(int i = 0; i < 8; ++i)
+    opening.push_back(File::OpenAsync("test43.txt", flags(File::MODE_WRITE)));
+
+  char contents[20] = {0};
+  File::File f = opening[0].get();
+  f.Read(contents, 19);
+  printf("Opened in the background: \"%s\"\n", contents);
+  ErrorIf(std::strcmp(contents, "Background") != 0);
+
+  for(size_t i = 1; i < opening.size(); ++i)
+    opening[i].get().Close(false);
+
+  // More at once than the ring holds, so some of them are opened on the
+  // pool instead. In text mode, which finishes off the same either way.
+  opening.clear();
+  for(int i = 0; i < 100; ++i)
+    opening.push_back(File::OpenAsync("test43.txt", flags(File::MODE_READ | File::MODE_TEXT)));
+
+  for(size_t i = 0; i < opening.size(); ++i)
+  {
+    File::File opened = opening[i].get();
+    const File::View view = opened.Contents();
+    ErrorIf(view.Size() != 10 || std::memcmp(view.Data(), "Background", 10) != 0);
+  }
+
+  // The file is handed over while it's saved, then comes back.
+  f.SetPos(0);
+  f.PutString("Foreground");
+  std::future<File::File> saving = File::FlushAsync(std::move(f));
+  f = saving.get();
+
+  File::File check("test43.txt", flags(File::MODE_READ));
+  std::memset(contents, 0, sizeof(contents));
+  check.Read(contents, 19);
+  ErrorIf(std::strcmp(contents, "Foreground") != 0);
+
+  f.PutString(" again");
+  File::CloseAsync(std::move(f)).get();
+  check.Reopen();
+  std::memset(contents, 0, sizeof(contents));
+  check.Read(contents, 19);
+  printf("Closed in the background: \"%s\"\n", contents);
+  ErrorIf(std::strcmp(contents, "Foreground again") != 0);
+
+  // A save that fails hands the file back, edits and all, to try again.
+  makedir("test43dir");
+  File::File unsaved("test43dir/test43.txt", flags(File::MODE_WRITE | File::MODE_CREATE | File::MODE_CLEAR));
+  unsaved.PutString("Unsaved");
+  std::remove("test43dir/test43.txt");
+  removedir("test43dir");
+  try
+  {
+    File::FlushAsync(std::move(unsaved)).get();
+    ErrorIf(true);
+  }
+  catch(File::Unsaved_Exception e)
+  {
+    printf("Caught expected exception.\n%s\n", e.what());
+    unsaved = e.TakeFile();
+  }
+  try
+  {
+    File::CloseAsync(std::move(unsaved)).get();
+    ErrorIf(true);
+  }
+  catch(File::Unsaved_Exception e)
+  {
+    printf("Caught expected exception.\n%s\n", e.what());
+    unsaved = e.TakeFile();
+  }
+  makedir("test43dir");
+  File::CloseAsync(std::move(unsaved)).get();
+
+  File::File saved("test43dir/test43.txt", flags(File::MODE_READ));
+  ErrorIf(saved.Contents().Size() != 7 || std::strncmp(saved.Contents().Data(), "Unsaved", 7) != 0);
+  saved.Close();
+  std::remove("test43dir/test43.txt");
+  removedir("test43dir");
+
+  // Errors come out of the future.
+  std::future<File::File> missing = File::OpenAsync("NotActuallyAFile");
+  try
+  {
+    missing.get();
+  }
+  catch(File::File_Exception e)
+  {
+    printf("Caught expected exception.\n%s\n", e.what());
+    return;
+  }
+
+  ErrorIf(true);
+}
+
+// Test going through a file on every core at once
+void test44(void)
+{
+  // Lines of every length up to 100, some of them empty.
+  File::File f("test44.txt", flags(File::MODE_WRITE | File::MODE_CLEAR));
+  char line[128];
+  for(unsigned i = 0; i < 20000; ++i)
+  {
+    const unsigned length = (i * 7919) % 101;
+    std::memset(line, 'a' + i % 26, length);
+    line[length] = '\n';
+    f.Write(line, length + 1);
+  }
+
+  // Counted one at a time.
+  f.SetPos(0);
+  size_t lines = 0;
+  File::Position letters = 0;
+  for(File::View view : f.Lines())
+  {
+    ++lines;
+    letters += view.Size();
+  }
+
+  // Counted on every core, with a pool of our own.
+  File::ThreadPool pool(4);
+  struct Counts
+  {
+    size_t lines;
+    File::Position letters;
+  };
+  const Counts none = {0, 0};
+  const Counts counts = File::ParallelForEachLine(f, none,
+    [](Counts& partial, const File::View& view) { ++partial.lines; partial.letters += view.Size(); },
+    [](Counts& total, const Counts& partial) { total.lines += partial.lines; total.letters += partial.letters; },
+    '\n', pool);
+
+  printf("%u lines, %u letters, on %u threads\n", static_cast<unsigned>(counts.lines), static_cast<unsigned>(counts.letters), pool.Threads());
+  ErrorIf(counts.lines != lines || counts.letters != letters || lines != 20000);
+
+  // Chunks cover the whole file, in order, and only split after newlines.
+  const File::View contents = f.Contents();
+  const char* expected = contents.begin();
+  const size_t chunks = File::ParallelForEachChunk(f, size_t(0),
+    [](size_t& count, const File::View& chunk) { count += (chunk[chunk.Size() - 1] == '\n'); },
+    [](size_t& total, const size_t& count) { total += count; });
+  ErrorIf(chunks == 0 || chunks > File::ThreadPool::Default().Threads() * File::ChunksPerThread);
+
+  const std::vector<File::View> pieces = File::SplitChunks(contents, 7, '\n');
+  for(size_t i = 0; i < pieces.size(); ++i)
+  {
+    ErrorIf(pieces[i].begin() != expected || pieces[i][pieces[i].Size() - 1] != '\n');
+    expected = pieces[i].end();
+  }
+  ErrorIf(expected != contents.end());
+
+  // Only works when the whole file is in memory.
+  f.Close();
+  File::File streamed("test44.txt", flags(File::MODE_READ | File::MODE_STREAM));
+  try
+  {
+    File::ParallelForEachChunk(streamed, 0, [](int&, const File::View&) {}, [](int&, const int&) {});
+  }
+  catch(File::File_Exception e)
+  {
+    printf("Caught expected exception.\n%s\n", e.what());
+    return;
+  }
+
+  ErrorIf(true);
+}
+
+// Test searching for patterns, against the obvious way of doing it
+void test45(void)
+{
+  // A small alphabet, so the ends of patterns match all the time and
+  // Horspool gets used as well.
+  char text[2000];
+  unsigned seed = 12345;
+  for(size_t i = 0; i < sizeof(text); ++i)
+  {
+    seed = seed * 1103515245 + 12345;
+    text[i] = "ab "[(seed >> 16) % 3];
+  }
+
+  for(size_t length = 1; length <= 12; ++length)
+  {
+    for(size_t from = 0; from + length <= sizeof(text); from += 37)
+    {
+      const File::Pattern pattern(&text[from], length);
+      const size_t expected = std::search(text, text + sizeof(text), &text[from], &text[from] + length) - text;
+      ErrorIf(pattern.Find(text, sizeof(text)) != expected);
+    }
+  }
+
+  File::File f("test45.txt", flags(File::MODE_READ));
+  ErrorIf(f.Find("needle") != 4 || f.Find("needle", 6, 5) != 23 || f.Find("missing") != File::NotFound);
+
+  // Walking through the matches.
+  unsigned found = 0;
+  for(File::Position at; (at = f.FindNext("needle")) != File::NotFound; ++found)
+    ErrorIf(f.GetPos() != at + 6);
+  ErrorIf(found != 3);
+
+  // Overlapping ones count.
+  const std::vector<File::Position> all = f.FindAll("aa");
+  printf("\"aa\" found %u times\n", static_cast<unsigned>(all.size()));
+  ErrorIf(all.size() != 3 || all[0] != 18 || all[2] != 20 || f.Count("aa") != 3);
+
+  // Across the seams of a streamed file.
+  File::File streamed("test45.txt", flags(File::MODE_READ | File::MODE_STREAM));
+  streamed.SetWindowSize(5);
+  ErrorIf(streamed.FindAll("needle") != f.FindAll("needle") || streamed.Find("aaaa") != 18);
+
+  // A single byte has no seam to look across.
+  ErrorIf(streamed.Find("k") != 34 || streamed.Find(".") != 43 || streamed.Find("z") != File::NotFound || streamed.Count("e") != f.Count("e"));
+
+  // A file large enough to be searched on every core.
+  File::File large("test45b.txt", flags(File::MODE_WRITE | File::MODE_CLEAR));
+  std::vector<char> block(1024 * 1024, 'x');
+  for(size_t i = 0; i < block.size(); i += 4093)
+    std::memcpy(&block[i], "ab", 2);
+  for(int i = 0; i < 10; ++i)
+    large.Write(&block[0], block.size() - 1);
+
+  const File::View contents = large.Contents();
+  size_t expected = 0;
+  for(const char* at = contents.begin(); (at = std::search(at, contents.end(), "xab", "xab" + 3)) != contents.end(); ++at)
+    ++expected;
+
+  const File::Position count = large.Count("xab");
+  ErrorIf(count != expected || large.FindAll("xab").size() != expected);
+  large.Close(false);
+  std::remove("test45b.txt");
+}
+
+void test46(void)
+{
+  struct Header
+  {
+    char tag[4];
+    int version;
+    double scale;
+  };
+
+  File::File f("test46.txt", flags(File::MODE_WRITE | File::MODE_CLEAR));
+  const Header header = {{'O', 'O', 'F', '1'}, 3, 0.25};
+  f.Write(header);
+  f.Write<File::BigEndian>(0x01020304);
+  f.Write<File::LittleEndian>(static_cast<short>(-2));
+
+  // Odd counts, so both the 16 byte swaps and the ones after get used.
+  unsigned short shorts[37];
+  unsigned ints[37];
+  double doubles[37];
+  for(unsigned i = 0; i < 37; ++i)
+  {
+    shorts[i] = static_cast<unsigned short>(i * 0x0101 + 1);
+    ints[i] = i * 0x01010101u + 0x00010203u;
+    doubles[i] = i * 1.5 - 7;
+  }
+  f.WriteArray<File::BigEndian>(shorts, 37);
+  f.WriteArray<File::BigEndian>(ints, 37);
+  f.WriteArray<File::BigEndian>(doubles, 37);
+
+  // Big endian puts the most significant byte first.
+  unsigned char bytes[4];
+  f.SetPos(sizeof(Header));
+  f.Read(bytes, 4);
+  ErrorIf(bytes[0] != 1 || bytes[1] != 2 || bytes[2] != 3 || bytes[3] != 4);
+  f.SetPos(sizeof(Header) + 6);
+  f.Read(bytes, 2);
+  ErrorIf(bytes[0] != 0x00 || bytes[1] != 0x01);
+
+  Header readHeader;
+  int number;
+  short small;
+  f.SetPos(0);
+  ErrorIf(!f.Read(readHeader) || std::memcmp(readHeader.tag, "OOF1", 4) || readHeader.version != 3 || readHeader.scale != 0.25);
+  ErrorIf(!f.Read<File::BigEndian>(number) || number != 0x01020304);
+  ErrorIf(!f.Read<File::LittleEndian>(small) || small != -2);
+
+  unsigned short readShorts[37];
+  unsigned readInts[37];
+  double readDoubles[40];
+  ErrorIf(f.ReadArray<File::BigEndian>(readShorts, 37) != 37 || std::memcmp(readShorts, shorts, sizeof(shorts)));
+  ErrorIf(f.ReadArray<File::BigEndian>(readInts, 37) != 37 || std::memcmp(readInts, ints, sizeof(ints)));
+  ErrorIf(f.ReadArray<File::BigEndian>(readDoubles, 40) != 37 || std::memcmp(readDoubles, doubles, sizeof(doubles)));
+
+  // Nothing's read unless there's a whole value left.
+  const File::Position end = sizeof(Header) + 6 + sizeof(shorts) + sizeof(ints) + sizeof(doubles);
+  ErrorIf(!f.EndOfFile() || f.GetPos() != end);
+  f.SetPos(end - 3);
+  ErrorIf(f.Read(number) || f.GetPos() != end - 3 || f.ReadArray(readShorts, 5) != 1);
+
+  // Streamed files swap as they go.
+  f.Close();
+  File::File streamed("test46.txt", flags(File::MODE_READ | File::MODE_WRITE | File::MODE_STREAM));
+  streamed.SetWindowSize(64);
+  streamed.SetPos(end);
+  streamed.WriteArray<File::BigEndian>(ints, 37);
+  streamed.SetPos(end);
+  ErrorIf(streamed.ReadArray<File::BigEndian>(readInts, 37) != 37 || std::memcmp(readInts, ints, sizeof(ints)));
+  streamed.Close(false);
+}
+
+void test47(void)
+{
+  // Numbers, checked against printf.
+  char expected[64], output[File::Text::MaxNumberLength];
+  const long long integers[] = {0, 7, -7, 10, 99, 100, -12345, 1000000007LL, -9223372036854775807LL - 1, 9223372036854775807LL};
+  for(size_t i = 0; i < sizeof(integers) / sizeof(integers[0]); ++i)
+  {
+    std::sprintf(expected, "%lld", integers[i]);
+    ErrorIf(std::strncmp(output, expected, File::Text::Integer(output, integers[i])) || std::strlen(expected) != File::Text::Integer(output, integers[i]));
+  }
+  ErrorIf(File::Text::Integer(output, 18446744073709551615ULL) != 20 || std::strncmp(output, "18446744073709551615", 20));
+
+  const double floats[] = {0.1, -2.5, 1e300, 3, -0.0, 1.0 / 3, 123456789012345678.0, 5e-324};
+  for(size_t i = 0; i < sizeof(floats) / sizeof(floats[0]); ++i)
+  {
+    const size_t length = File::Text::Float(output, floats[i]);
+    output[length] = 0;
+    printf("%s ", output);
+    ErrorIf(std::strtod(output, NULL) != floats[i] || length > 24);
+  }
+  printf("\n");
+
+  File::File f("test47.txt", flags(File::MODE_WRITE | File::MODE_CLEAR));
+  f.Printf("%d-%s-%.2f\n", 42, "text", 2.5);
+  f.Format("Total: ", 1234567u, " (", -8, "%) ", 0.1, ' ', true, '\n');
+
+  // Too long to fit the room left in the buffer, or on the stack.
+  char long_[2001];
+  std::memset(long_, 'z', 2000);
+  long_[2000] = 0;
+  f.Printf("[%s]", long_);
+  f.Format(long_, "!");
+
+  // Overwriting the middle doesn't leave a null behind.
+  f.SetPos(0);
+  f.Printf("%02d", 7);
+
+  const File::View contents = f.Contents();
+  ErrorIf(contents.Size() != 43 + 2002 + 2001);
+  ErrorIf(std::strncmp(contents.Data(), "07-text-2.50\nTotal: 1234567 (-8%) 0.1 true\n[z", 45));
+  ErrorIf(contents[4045] != '!' || contents[2044] != ']' || contents[2045] != 'z');
+
+  // Streamed files too.
+  f.Flush();
+  File::File streamed("test47.txt", flags(File::MODE_READ | File::MODE_WRITE | File::MODE_STREAM));
+  streamed.SetWindowSize(64);
+  streamed.SetPos(10);
+  streamed.Printf("%s", "XY");
+  streamed.Format(File::View("AB", 2), 3.0f);
+  streamed.SetPos(10);
+  char check[6];
+  ErrorIf(streamed.Read(check, 6) != 6 || std::strncmp(check, "XYAB3t", 6));
+  streamed.Close(false);
+
+  try
+  {
+    File::File readOnly("test47.txt", flags(File::MODE_READ));
+    readOnly.Printf("%d", 1);
+  }
+  catch(File::File_Exception e)
+  {
+    printf("Caught expected exception.\n%s\n", e.what());
+    f.Close(false);
+    return;
+  }
+
+  ErrorIf(true);
+}
+
+void test48(void)
+{
+  File::File f("test48.txt", flags(File::MODE_READ | File::MODE_TEXT));
+
+  int small;
+  unsigned long long large;
+  long long smallest;
+  double real;
+  char token[8];
+  ErrorIf(f.ReadInt(small) != File::PARSE_OK || small != 42);
+  ErrorIf(f.ReadInt(small) != File::PARSE_OK || small != -17);
+  ErrorIf(f.ReadDouble(real) != File::PARSE_OK || real != 3.25);
+  ErrorIf(f.ReadDouble(real) != File::PARSE_OK || real != 1000);
+
+  // Not a number, so nothing moves.
+  ErrorIf(f.ReadInt(small) != File::PARSE_INVALID || f.ReadUInt(large) != File::PARSE_INVALID);
+  ErrorIf(f.ReadToken(token, sizeof(token)) != File::PARSE_OK || std::strcmp(token, "word"));
+
+  // Too large, so it's skipped.
+  ErrorIf(f.ReadUInt(large) != File::PARSE_OUTOFRANGE);
+  ErrorIf(f.ReadInt(smallest) != File::PARSE_OK || smallest != -9223372036854775807LL - 1);
+
+  double tenth, infinity, notANumber;
+  ErrorIf(f.Scan(tenth, infinity, notANumber, large) != 4 || tenth != 0.1 || infinity <= 1e308 || notANumber == notANumber);
+  ErrorIf(large != 123456789012345678ULL);
+  ErrorIf(f.Scan(token, small) != 1 || std::strcmp(token, "x,"));
+  ErrorIf(f.ReadToken(token, 4) != File::PARSE_OUTOFRANGE || std::strcmp(token, "lon"));
+  ErrorIf(f.ReadToken(token, sizeof(token)) != File::PARSE_OK || std::strcmp(token, "gtoken"));
+  ErrorIf(f.ReadInt(small) != File::PARSE_ENDOFFILE);
+
+  // Binary mode doesn't skip whitespace.
+  File::File binary("test48.txt", flags(File::MODE_READ | File::MODE_BINARY));
+  ErrorIf(binary.ReadInt(small) != File::PARSE_INVALID || binary.GetChar() != ' ');
+  binary.SetPos(2);
+  ErrorIf(binary.ReadInt(small) != File::PARSE_OK || small != 42 || binary.ReadInt(small) != File::PARSE_INVALID);
+
+  // Floats against strtod.
+  unsigned seed = 4321;
+  char text[64];
+  for(unsigned i = 0; i < 20000; ++i)
+  {
+    seed = seed * 1103515245 + 12345;
+    const double value = std::ldexp(static_cast<double>(seed >> 8), static_cast<int>(seed % 200) - 100);
+    std::sprintf(text, i % 3 == 0 ? "%.17g" : i % 3 == 1 ? "%.6e" : "%.3f", value * (i & 1 ? 1 : -1));
+
+    const char* at = text;
+    ErrorIf(File::Parse::Number(at, text + std::strlen(text), real) != File::PARSE_OK || real != std::strtod(text, NULL) || *at != 0);
+  }
+
+  // Integers against sprintf, including the ones 8 digits at a time.
+  for(unsigned i = 0; i < 20000; ++i)
+  {
+    seed = seed * 1103515245 + 12345;
+    const long long value = static_cast<long long>((static_cast<unsigned long long>(seed) << 32 | seed * 7u) >> (seed % 64)) * (i & 1 ? 1 : -1);
+    std::sprintf(text, "%lld", value);
+
+    const char* at = text;
+    ErrorIf(File::Parse::Number(at, text + std::strlen(text), smallest) != File::PARSE_OK || smallest != value || *at != 0);
+  }
+
+  // Whole blocks of numbers, in memory and streamed.
+  File::File numbers("test48b.txt", flags(File::MODE_WRITE | File::MODE_CLEAR));
+  for(int i = 0; i < 200000; ++i)
+    numbers.Format(i * 37 - 1000000, i % 10 ? ' ' : '\n');
+  numbers.Close();
+
+  std::vector<int> values(200001);
+  File::File inMemory("test48b.txt", flags(File::MODE_READ | File::MODE_TEXT));
+  const File::Position read = inMemory.ReadInts(&values[0], values.size());
+  ErrorIf(read != 200000 || values[0] != -1000000 || values[199999] != 199999 * 37 - 1000000);
+
+  File::File streamed("test48b.txt", flags(File::MODE_READ | File::MODE_TEXT | File::MODE_STREAM));
+  streamed.SetWindowSize(100);
+  std::vector<long long> wide(200000);
+  ErrorIf(streamed.ReadInts(&wide[0], wide.size()) != 200000);
+  for(int i = 0; i < 200000; ++i)
+    ErrorIf(wide[i] != i * 37 - 1000000);
+
+  streamed.Close(false);
+  std::remove("test48b.txt");
+}
+
+void test49(void)
+{
+  File::File f("test49.txt", flags(File::MODE_WRITE | File::MODE_APPEND));
+  f.Insert("!", 1);
+  f.Insert(5, " there", 6);
+  ErrorIf(f.GetPos() != 11);
+  f.Erase(0, 1);
+  f.Insert(0, "Oh, h", 5);
+  ErrorIf(std::strncmp(f.Contents().Data(), "Oh, hello there!", 16) || f.Contents().Size() != 16);
+
+  // The original contents are protected.
+  File::File protectedFile("test49.txt", flags(File::MODE_WRITE | File::MODE_APPEND | File::MODE_PROTECT));
+  protectedFile.Insert(" world", 6);
+  try
+  {
+    protectedFile.Insert(2, "x", 1);
+    ErrorIf(true);
+  }
+  catch(File::File_Exception e)
+  {
+    printf("Caught expected exception.\n%s\n", e.what());
+  }
+  protectedFile.SetPos(2);
+  ErrorIf(protectedFile.GetChar() != 'l');
+  protectedFile.Close(false);
+
+  // Random edits against a copy kept in a vector, with reads in between
+  // now and then from wherever the gap happens to be.
+  std::vector<char> expected(f.Contents().begin(), f.Contents().end());
+  unsigned seed = 777;
+  for(unsigned i = 0; i < 20000; ++i)
+  {
+    seed = seed * 1103515245 + 12345;
+    const File::Position position = (seed >> 8) % (expected.size() + 1);
+    const unsigned length = (seed >> 4) % 9;
+
+    if(seed % 3)
+    {
+      const char text[] = "abcdefghi";
+      f.Insert(position, text, length);
+      expected.insert(expected.begin() + static_cast<size_t>(position), text, text + length);
+    }
+    else
+    {
+      f.Erase(position, length);
+      const size_t end = std::min(expected.size(), static_cast<size_t>(position + length));
+      expected.erase(expected.begin() + static_cast<size_t>(position), expected.begin() + end);
+    }
+
+    ErrorIf(f.GetPos() != position + (seed % 3 ? length : 0));
+
+    if(i % 1000 == 0)
+    {
+      f.SetPos(0);
+      ErrorIf(f.GetChar() != expected[0]);
+    }
+  }
+
+  // Inserting part of the file itself.
+  f.Insert(0, f.Contents().Data() + 5, 10);
+  const std::vector<char> part(expected.begin() + 5, expected.begin() + 15);
+  expected.insert(expected.begin(), part.begin(), part.end());
+
+  const File::View contents = f.Contents();
+  ErrorIf(contents.Size() != expected.size() || !std::equal(contents.begin(), contents.end(), expected.begin()));
+
+  // Saves just like anything else.
+  f.Close();
+  File::File saved("test49.txt", flags(File::MODE_READ));
+  ErrorIf(saved.Contents().Size() != expected.size() || !std::equal(expected.begin(), expected.end(), saved.Contents().begin()));
+  saved.Close();
+
+  // Erasing what was just written on the end of a file that isn't cleared,
+  // so only the changes are saved. None of it should reach the disk.
+  File::File appended("test49.txt", flags(File::MODE_WRITE | File::MODE_APPEND));
+  appended.Write("XXXXXXXXXX", 10);
+  appended.Erase(expected.size(), 10);
+  appended.Close();
+
+  File::File reread("test49.txt", flags(File::MODE_READ));
+  ErrorIf(reread.Contents().Size() != expected.size() || !std::equal(expected.begin(), expected.end(), reread.Contents().begin()));
+  reread.Close();
+
+  // Closing the gap moves what's after it, so a view taken past the gap
+  // is gone once a read runs into it, even though nothing was written.
+  File::File gapped("test49b.txt", flags(File::MODE_WRITE | File::MODE_CLEAR));
+  for(unsigned i = 0; i < 100; ++i)
+    gapped.PutChar(static_cast<char>('a' + i % 26));
+  gapped.Insert(0, "XY", 2);
+  gapped.SetPos(50);
+  const File::View past = gapped.ReadView(5);
+  ErrorIf(past.Size() != 5 || std::strncmp(past.Data(), "wxyza", 5));
+  gapped.SetPos(0);
+  ErrorIf(gapped.ReadView(60).Size() != 60);
+#ifdef FILE_CHECK_VIEWS
+  ErrorIf(!past.Stale());
+#endif
+  gapped.SetPos(50);
+  ErrorIf(std::strncmp(gapped.ReadView(5).Data(), "wxyza", 5));
+
+  // Reading up to the gap, finding across it and writing over it all leave
+  // it where it is, so a view past it stays good.
+  gapped.Insert(10, "--", 2);
+  gapped.SetPos(20);
+  const File::View after = gapped.ReadView(5);
+  gapped.SetPos(4);
+  const File::View before = gapped.ReadView(8);
+  ErrorIf(before.Size() != 8 || std::strncmp(before.Data(), "cdefgh--", 8));
+  ErrorIf(gapped.Find("h--ij") != 9 || gapped.Find("ijk") != 12);
+  gapped.SetPos(10);
+  gapped.Write("==ZZ", 4);
+  char straddled[8];
+  gapped.SetPos(8);
+  ErrorIf(gapped.Read(straddled, 8) != 8 || std::strncmp(straddled, "gh==ZZkl", 8));
+  ErrorIf(gapped.Find("h==ZZk") != 9 || gapped.Find("-") != File::NotFound);
+#ifdef FILE_CHECK_VIEWS
+  ErrorIf(after.Stale());
+#endif
+  ErrorIf(std::strncmp(after.Data(), "qrstu", 5));
+  gapped.Close(false);
+  std::remove("test49b.txt");
+
+  try
+  {
+    File::File streamed("test49.txt", flags(File::MODE_WRITE | File::MODE_STREAM));
+    streamed.Erase(0, 1);
+  }
+  catch(File::File_Exception e)
+  {
+    printf("Caught expected exception.\n%s\n", e.what());
+    return;
+  }
+
+  ErrorIf(true);
+}
+
+void test50(void)
+{
+  // A file a good few windows long, patched all over.
+  std::vector<char> expected(300000);
+  for(size_t i = 0; i < expected.size(); ++i)
+    expected[i] = static_cast<char>('a' + i % 26);
+
+  File::File original("test50.txt", flags(File::MODE_WRITE | File::MODE_CLEAR));
+  original.Write(&expected[0], expected.size());
+  original.Close();
+
+  File::File f("test50.txt", flags(File::MODE_WRITE | File::MODE_PIECES));
+  f.SetWindowSize(4096);
+
+  unsigned seed = 50;
+  for(unsigned i = 0; i < 3000; ++i)
+  {
+    seed = seed * 1103515245 + 12345;
+    const File::Position position = (seed >> 8) % (expected.size() + 1);
+    const unsigned length = (seed >> 4) % 200;
+    const char text[] = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ"
+                        "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ";
+
+    switch(seed % 4)
+    {
+    case 0:
+      f.Insert(position, text, length);
+      expected.insert(expected.begin() + static_cast<size_t>(position), text, text + length);
+      break;
+
+    case 1:
+    {
+      f.Erase(position, length);
+      const size_t end = std::min(expected.size(), static_cast<size_t>(position + length));
+      expected.erase(expected.begin() + static_cast<size_t>(position), expected.begin() + end);
+      break;
+    }
+
+    case 2:
+    {
+      f.SetPos(position);
+      f.Write(text, length);
+      const size_t end = static_cast<size_t>(position + length);
+      if(end > expected.size())
+        expected.resize(end);
+      std::copy(text, text + length, expected.begin() + static_cast<size_t>(position));
+      break;
+    }
+
+    default:
+    {
+      char read[200];
+      f.SetPos(position);
+      const File::Position count = f.Read(read, length);
+      ErrorIf(count != std::min<File::Position>(length, expected.size() - position));
+      ErrorIf(!std::equal(read, read + count, expected.begin() + static_cast<size_t>(position)));
+    }
+    }
+  }
+
+  f.SetPos(expected.size());
+  ErrorIf(!f.EndOfFile());
+
+  // A copy gets edits of its own.
+  File::File copy(f);
+  copy.Insert(0, "copy", 4);
+  char start[8];
+  copy.SetPos(0);
+  copy.Read(start, 8);
+  ErrorIf(std::strncmp(start, "copy", 4) || !std::equal(start + 4, start + 8, expected.begin()));
+  copy.Close(false);
+
+  f.WriteFile("test50b.txt");
+  f.Close();
+
+  File::File saved("test50.txt", flags(File::MODE_READ));
+  ErrorIf(saved.Contents().Size() != expected.size() || !std::equal(expected.begin(), expected.end(), saved.Contents().begin()));
+  saved.Close();
+
+  File::File written("test50b.txt", flags(File::MODE_READ));
+  ErrorIf(written.Contents().Size() != expected.size() || !std::equal(expected.begin(), expected.end(), written.Contents().begin()));
+  written.Close();
+  std::remove("test50b.txt");
+
+  // Edited again after a save, on top of the file that replaced it.
+  File::File again("test50.txt", flags(File::MODE_WRITE | File::MODE_PIECES));
+  again.Insert(0, "[", 1);
+  again.Flush();
+  again.Insert(expected.size() + 1, "]", 1);
+  again.Close();
+
+  File::File reread("test50.txt", flags(File::MODE_READ));
+  ErrorIf(reread.Contents().Size() != expected.size() + 2 || reread.Contents().Data()[0] != '[' || reread.Contents().Data()[expected.size() + 1] != ']');
+  reread.Close();
+
+  try
+  {
+    File::File readOnly("test50.txt", flags(File::MODE_READ | File::MODE_PIECES));
+    readOnly.Insert(0, "x", 1);
+  }
+  catch(File::File_Exception e)
+  {
+    printf("Caught expected exception.\n%s\n", e.what());
+    return;
+  }
+
+  ErrorIf(true);
+}
+
+// Makes random edits in and out of nested transactions, rolling back to
+// copies of what the file was when each one began.
+void EditInTransactions(File::File& f, std::vector<char>& expected, bool canInsert)
+{
+  std::vector<std::vector<char> > savepoints;
+  unsigned seed = 51;
+
+  for(unsigned i = 0; i < 4000; ++i)
+  {
+    seed = seed * 1103515245 + 12345;
+    const File::Position position = (seed >> 8) % (expected.size() + 1);
+    const unsigned length = (seed >> 4) % 50;
+    const char text[] = "abcdefghijklmnopqrstuvwxyzabcdefghijklmnopqrstuvwxyz";
+
+    switch(seed % 8)
+    {
+    case 0:
+      f.BeginTransaction();
+      savepoints.push_back(expected);
+      break;
+
+    case 1:
+      if(savepoints.empty())
+        break;
+      f.Commit();
+      savepoints.pop_back();
+      break;
+
+    case 2:
+      if(savepoints.empty())
+        break;
+      f.Rollback();
+      expected.swap(savepoints.back());
+      savepoints.pop_back();
+      break;
+
+    case 3:
+    case 4:
+    {
+      f.SetPos(position);
+      f.Write(text, length);
+      const size_t end = static_cast<size_t>(position + length);
+      if(end > expected.size())
+        expected.resize(end);
+      std::copy(text, text + length, expected.begin() + static_cast<size_t>(position));
+      break;
+    }
+
+    case 5:
+      f.SetPos(position);
+      for(unsigned j = 0; j < length; ++j)
+        f.PutChar('#');
+      if(position + length > expected.size())
+        expected.resize(static_cast<size_t>(position + length));
+      std::fill(expected.begin() + static_cast<size_t>(position), expected.begin() + static_cast<size_t>(position + length), '#');
+      break;
+
+    case 6:
+      if(!canInsert)
+        break;
+      f.Insert(position, text, length);
+      expected.insert(expected.begin() + static_cast<size_t>(position), text, text + length);
+      break;
+
+    default:
+    {
+      if(!canInsert)
+        break;
+      f.Erase(position, length);
+      const size_t end = std::min(expected.size(), static_cast<size_t>(position + length));
+      expected.erase(expected.begin() + static_cast<size_t>(position), expected.begin() + end);
+    }
+    }
+
+    ErrorIf(f.TransactionDepth() != savepoints.size());
+  }
+
+  while(!savepoints.empty())
+  {
+    f.Rollback();
+    expected.swap(savepoints.back());
+    savepoints.pop_back();
+  }
+}
+
+void test51(void)
+{
+  File::File f("test51.txt", flags(File::MODE_WRITE));
+  f.BeginTransaction();
+  f.Write("Hello world", 11);
+  f.Insert(5, ",", 1);
+  f.BeginTransaction();
+  f.SetPos(7);
+  f.Write("there, everyone", 15);
+  f.Erase(0, 1);
+  ErrorIf(std::strncmp(f.Contents().Data(), "ello, there, everyone", 21) || f.Contents().Size() != 21);
+
+  // Only the inner transaction is undone, and the file pointer goes back.
+  f.Rollback();
+  ErrorIf(std::strncmp(f.Contents().Data(), "Hello, world", 12) || f.Contents().Size() != 12 || f.GetPos() != 6);
+  f.Rollback();
+  ErrorIf(f.Contents().Size() != 0 || f.TransactionDepth() != 0);
+
+  try
+  {
+    f.Commit();
+    ErrorIf(true);
+  }
+  catch(File::File_Exception e)
+  {
+    printf("Caught expected exception.\n%s\n", e.what());
+  }
+
+  // Committed edits stay, and get saved.
+  f.BeginTransaction();
+  f.Write("kept", 4);
+  f.Commit();
+  f.Close();
+
+  File::File kept("test51.txt", flags(File::MODE_READ));
+  ErrorIf(kept.Contents().Size() != 4 || std::strncmp(kept.Contents().Data(), "kept", 4));
+  kept.Close();
+
+  // In memory, with inserting and erasing.
+  std::vector<char> original(20000);
+  for(size_t i = 0; i < original.size(); ++i)
+    original[i] = static_cast<char>('A' + i % 26);
+
+  File::File memory("test51.txt", flags(File::MODE_WRITE | File::MODE_CLEAR));
+  memory.Write(&original[0], original.size());
+  std::vector<char> expected = original;
+  EditInTransactions(memory, expected, true);
+  ErrorIf(memory.Contents().Size() != expected.size() || !std::equal(expected.begin(), expected.end(), memory.Contents().begin()));
+  memory.Close();
+
+  // Streamed, with the windows written out in the middle of transactions.
+  File::File streamed("test51.txt", flags(File::MODE_WRITE | File::MODE_STREAM));
+  streamed.SetWindowSize(1024);
+  EditInTransactions(streamed, expected, false);
+  streamed.Close();
+
+  File::File reread("test51.txt", flags(File::MODE_READ));
+  ErrorIf(reread.Contents().Size() != expected.size() || !std::equal(expected.begin(), expected.end(), reread.Contents().begin()));
+  reread.Close();
+
+  // In pieces.
+  File::File pieces("test51.txt", flags(File::MODE_WRITE | File::MODE_PIECES));
+  pieces.SetWindowSize(1024);
+  EditInTransactions(pieces, expected, true);
+  pieces.Close();
+
+  File::File pieced("test51.txt", flags(File::MODE_READ));
+  ErrorIf(pieced.Contents().Size() != expected.size() || !std::equal(expected.begin(), expected.end(), pieced.Contents().begin()));
+  pieced.Close();
+
+  // An append that's rolled back mustn't reach the file when it's saved over what was there,
+  // even when it ran on from the last few bytes.
+  File::File appended("test51.txt", flags(File::MODE_WRITE | File::MODE_APPEND));
+  appended.BeginTransaction();
+  appended.SetPos(expected.size() - 5);
+  appended.Write("XXXXXXXXXXXXXXX", 15);
+  appended.Insert(expected.size(), "YYYYY", 5);
+  appended.Rollback();
+  ErrorIf(appended.Contents().Size() != expected.size() || appended.GetPos() != expected.size());
+  appended.Close();
+
+  File::File unappended("test51.txt", flags(File::MODE_READ));
+  ErrorIf(unappended.Contents().Size() != expected.size() || !std::equal(expected.begin(), expected.end(), unappended.Contents().begin()));
+}
+
+void test52(void)
+{
+  // Lines of text a few blocks long, which pack down well.
+  std::vector<char> expected;
+  for(unsigned i = 0; expected.size() < 1000000; ++i)
+  {
+    char line[64];
+    const int length = std::sprintf(line, "Line %u of the compressed file\n", i);
+    expected.insert(expected.end(), line, line + length);
+  }
+
+  File::File f("test52.txt", flags(File::MODE_WRITE | File::MODE_CLEAR | File::MODE_COMPRESSED));
+  f.Write(&expected[0], expected.size());
+  f.Close();
+
+  File::File raw("test52.txt", flags(File::MODE_READ));
+  ErrorIf(raw.Contents().Size() == 0 || raw.Contents().Size() > expected.size() / 4);
+  raw.Close();
+
+  // Read from the middle, then a line running across the end of the first block.
+  File::File packed("test52.txt", flags(File::MODE_READ | File::MODE_COMPRESSED));
+  char middle[100];
+  packed.SetPos(600000);
+  ErrorIf(packed.Read(middle, 100) != 100 || !std::equal(middle, middle + 100, expected.begin() + 600000));
+
+  const size_t lineStart = std::find(expected.rbegin() + (expected.size() - 256 * 1024), expected.rend(), '\n').base() - expected.begin();
+  const size_t lineEnd   = std::find(expected.begin() + lineStart, expected.end(), '\n') - expected.begin();
+  packed.SetPos(lineStart);
+  File::View line = packed.GetLineView();
+  ErrorIf(line.Size() != lineEnd - lineStart || !std::equal(line.begin(), line.end(), expected.begin() + lineStart));
+
+  packed.SetPos(expected.size());
+  ErrorIf(!packed.EndOfFile());
+  ErrorIf(packed.Contents().Size() != expected.size() || !std::equal(expected.begin(), expected.end(), packed.Contents().begin()));
+  packed.Close();
+
+  // Writing over a few bytes of one block.
+  File::File edited("test52.txt", flags(File::MODE_WRITE | File::MODE_COMPRESSED));
+  edited.SetPos(700000);
+  edited.Write("EDITED", 6);
+  std::copy("EDITED", "EDITED" + 6, expected.begin() + 700000);
+  edited.Insert(0, "Start\n", 6);
+  expected.insert(expected.begin(), "Start\n", "Start\n" + 6);
+  edited.Close();
+
+  File::File reread("test52.txt", flags(File::MODE_READ | File::MODE_COMPRESSED));
+  ErrorIf(reread.Contents().Size() != expected.size() || !std::equal(expected.begin(), expected.end(), reread.Contents().begin()));
+  reread.Close();
+
+  // Bytes that don't pack down at all still come back the same.
+  std::vector<char> noise(300000);
+  unsigned seed = 52;
+  for(size_t i = 0; i < noise.size(); ++i)
+  {
+    seed = seed * 1103515245 + 12345;
+    noise[i] = static_cast<char>(seed >> 16);
+  }
+
+  File::File random("test52.txt", flags(File::MODE_WRITE | File::MODE_CLEAR | File::MODE_COMPRESSED));
+  random.Write(&noise[0], noise.size());
+  random.Close();
+
+  File::File unpacked("test52.txt", flags(File::MODE_READ | File::MODE_COMPRESSED));
+  ErrorIf(unpacked.Contents().Size() != noise.size() || !std::equal(noise.begin(), noise.end(), unpacked.Contents().begin()));
+  unpacked.Close();
+
+  try
+  {
+    File::File streamed("test52.txt", flags(File::MODE_READ | File::MODE_STREAM | File::MODE_COMPRESSED));
+    ErrorIf(true);
+  }
+  catch(File::File_Exception e)
+  {
+    printf("Caught expected exception.\n%s\n", e.what());
+  }
+
+  try
+  {
+    File::File plain("testfile.txt", flags(File::MODE_READ | File::MODE_COMPRESSED));
+  }
+  catch(File::File_Exception e)
+  {
+    printf("Caught expected exception.\n%s\n", e.what());
+    return;
+  }
+
+  ErrorIf(true);
+}
+
 void (*tests[])(void) = {
   test1,
   test2,
@@ -590,7 +2348,34 @@ void (*tests[])(void) = {
   test22,
   test23,
   test24,
-  test25
+  test25,
+  test26,
+  test27,
+  test28,
+  test29,
+  test30,
+  test31,
+  test32,
+  test33,
+  test34,
+  test35,
+  test36,
+  test37,
+  test38,
+  test39,
+  test40,
+  test41,
+  test42,
+  test43,
+  test44,
+  test45,
+  test46,
+  test47,
+  test48,
+  test49,
+  test50,
+  test51,
+  test52
 };
 
 void WriteToFile(const char* filename, const char* data)
@@ -613,8 +2398,35 @@ void SetupFiles(void)
   WriteToFile("test23.txt", "Line 1\nLine 2\nLine 3");
   WriteToFile("test24.txt", "");
   WriteToFile("test25.txt", "");
+  WriteToFile("test27.txt", "");
+  WriteToFile("test28.txt", "");
+  WriteToFile("test30.txt", "First line of the file\nSecond line\nThird line");
+  WriteToFile("test32.txt", "0123456789");
+  WriteToFile("test33.txt", "The original, longer contents");
+  WriteToFile("test34.txt", "Original");
+  WriteToFile("test35a.txt", "Some");
+  WriteToFile("test35b.txt", "Second");
+  WriteToFile("test36.txt", "Recycled");
+  WriteToFile("test39.txt", "Alpha\n\n  Gamma\nDelta\n");
+  WriteToFile("test40.txt", "key=value\nsecond line\n\nlast");
+  WriteToFile("test43.txt", "Background");
+  WriteToFile("test44.txt", "");
+  WriteToFile("test45.txt", "The needle in the aaaa needle stack, needle.");
+  WriteToFile("test45b.txt", "");
+  WriteToFile("test46.txt", "");
+  WriteToFile("test47.txt", "");
+  WriteToFile("test48.txt", "  42\t-17 3.25\n1e3 word 99999999999999999999 -9223372036854775808\n0.1 inf nan(1) 123456789012345678 x, longtoken");
+  WriteToFile("test48b.txt", "");
+  WriteToFile("test49.txt", "hello");
+  WriteToFile("test49b.txt", "");
+  WriteToFile("test50.txt", "");
+  WriteToFile("test51.txt", "");
+  WriteToFile("test52.txt", "");
 }
 
+// Benchmark.cpp
+void RunBenchmarks(void);
+
 int main(int argc, char** argv)
 {
   unsigned currentTest;
@@ -622,7 +2434,12 @@ int main(int argc, char** argv)
   SetupFiles();
 
   try{
-    if(argc > 1)
+    // Timings, rather than tests.
+    if(argc > 1 && std::strcmp(argv[1], "bench") == 0)
+    {
+      RunBenchmarks();
+    }
+    else if(argc > 1)
     {
       int which = std::atoi(argv[1]);
 
@@ -669,5 +2486,7 @@ int main(int argc, char** argv)
     int i = 0;
   }
 
+  // The default pool keeps memory around on purpose. Don't report it as a leak.
+  File::Allocator::Default().Trim();
   _CrtDumpMemoryLeaks();
 }
\ No newline at end of file